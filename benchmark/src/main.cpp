@@ -0,0 +1,309 @@
+#include "raylib.h"
+
+#include "scene.h"
+#include "scene_loader.h"
+
+#include "occlusion_benchmark.h"
+#include "synthetic_gltf.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Headless loader benchmark
+// generates synthetic glTF scenes, loads each one several times and writes the timings as json
+// every scene is also loaded the way a dedicated server would, positions only and without textures
+// then loads all scenario files back to back and as one concurrent batch, and times the occlusion culler on a generated dungeon
+//
+// usage: benchmark [--iterations N] [--out results.json] [--data dir]
+//                  [--nodes N --depth N --triangles N --duplicates R --textures N]
+// passing any scene parameter runs a single custom scenario instead of the built in suite
+
+struct BenchmarkResult
+{
+    SyntheticSceneSettings Settings;
+    int FileSize = 0;
+    size_t MeshNodes = 0;
+    std::vector<double> TotalTimes;
+    double PhaseTimes[size_t(LoadPhase::Count)] = { 0 };
+    LoadStats LastStats;
+
+    double ServerMinTime = 0;
+    LoadStats ServerStats;
+};
+
+struct ConcurrentResult
+{
+    size_t Files = 0;
+    double SequentialMs = 0;
+    double ConcurrentMs = 0;
+};
+
+static std::vector<SyntheticSceneSettings> GetDefaultSuite()
+{
+    std::vector<SyntheticSceneSettings> suite;
+
+    SyntheticSceneSettings baseline;
+    baseline.Name = "baseline";
+    suite.push_back(baseline);
+
+    SyntheticSceneSettings wide;
+    wide.Name = "wide";
+    wide.NodeCount = 10000;
+    wide.HierarchyDepth = 1;
+    wide.TrianglesPerPrimitive = 128;
+    wide.DuplicateRatio = 0.9f;
+    suite.push_back(wide);
+
+    SyntheticSceneSettings deep;
+    deep.Name = "deep";
+    deep.NodeCount = 2000;
+    deep.HierarchyDepth = 32;
+    deep.TrianglesPerPrimitive = 128;
+    suite.push_back(deep);
+
+    SyntheticSceneSettings heavy;
+    heavy.Name = "heavy";
+    heavy.NodeCount = 200;
+    heavy.HierarchyDepth = 2;
+    heavy.TrianglesPerPrimitive = 20000;
+    heavy.DuplicateRatio = 0.0f;
+    suite.push_back(heavy);
+
+    SyntheticSceneSettings textured;
+    textured.Name = "textured";
+    textured.TextureCount = 64;
+    textured.TextureSize = 256;
+    suite.push_back(textured);
+
+    return suite;
+}
+
+static BenchmarkResult RunScenario(const SyntheticSceneSettings& settings, const std::string& dataDir, int iterations)
+{
+    BenchmarkResult result;
+    result.Settings = settings;
+
+    std::string fileName = dataDir + "/" + settings.Name + ".glb";
+    if (!WriteSyntheticGLB(settings, fileName.c_str()))
+    {
+        TraceLog(LOG_ERROR, "BENCHMARK: unable to write %s", fileName.c_str());
+        return result;
+    }
+
+    int size = 0;
+    unsigned char* data = LoadFileData(fileName.c_str(), &size);
+    UnloadFileData(data);
+    result.FileSize = size;
+
+    for (int i = 0; i < iterations; i++)
+    {
+        Scene scene;
+        LoadStats stats;
+
+        auto start = std::chrono::steady_clock::now();
+        LoadSceneFromGLTF(fileName, scene, &stats);
+        double total = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        result.TotalTimes.push_back(total);
+        for (size_t p = 0; p < size_t(LoadPhase::Count); p++)
+            result.PhaseTimes[p] += stats.PhaseSeconds[p] / iterations;
+
+        result.LastStats = stats;
+        result.MeshNodes = scene.Meshes.size();
+
+        UnloadScene(scene);
+    }
+
+    SceneLoaderOptions serverOptions;
+    serverOptions.Headless = true;
+    serverOptions.Content.Attributes = MeshAttributePositionsOnly;
+    serverOptions.Content.Textures = TextureLoadMode::Skip;
+
+    SceneLoader serverLoader(serverOptions);
+
+    for (int i = 0; i < iterations; i++)
+    {
+        Scene scene;
+        LoadStats stats;
+
+        serverLoader.Load(fileName, scene, &stats);
+
+        if (i == 0 || stats.TotalSeconds < result.ServerMinTime)
+            result.ServerMinTime = stats.TotalSeconds;
+
+        result.ServerStats = stats;
+
+        UnloadScene(scene);
+    }
+
+    return result;
+}
+
+// the same files loaded one after another and by SceneLoader::LoadScenes, like a level and the sublevels streamed in with it
+static ConcurrentResult RunConcurrentLoad(const std::vector<SyntheticSceneSettings>& suite, const std::string& dataDir, int iterations)
+{
+    ConcurrentResult result;
+    result.Files = suite.size();
+
+    SceneLoaderOptions options;
+    options.Headless = true;
+
+    for (int i = 0; i < iterations; i++)
+    {
+        std::vector<Scene> scenes(suite.size());
+
+        auto start = std::chrono::steady_clock::now();
+        for (size_t f = 0; f < suite.size(); f++)
+            LoadSceneFromGLTF(dataDir + "/" + suite[f].Name + ".glb", scenes[f]);
+        result.SequentialMs += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() * 1000.0 / iterations;
+
+        for (Scene& scene : scenes)
+            UnloadScene(scene);
+
+        // a fresh loader each time so no images are cached from the previous iteration
+        SceneLoader loader(options);
+
+        std::vector<SceneLoadRequest> requests(suite.size());
+        for (size_t f = 0; f < suite.size(); f++)
+        {
+            requests[f].FileName = dataDir + "/" + suite[f].Name + ".glb";
+            requests[f].OutScene = &scenes[f];
+        }
+
+        start = std::chrono::steady_clock::now();
+        loader.LoadScenes(requests);
+        result.ConcurrentMs += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() * 1000.0 / iterations;
+
+        for (Scene& scene : scenes)
+            UnloadScene(scene);
+    }
+
+    return result;
+}
+
+static void WriteResults(FILE* out, const std::vector<BenchmarkResult>& results, const ConcurrentResult& concurrent, const std::vector<OcclusionBenchmarkResult>& occlusion, int iterations)
+{
+    fprintf(out, "{\n  \"benchmark\": \"rlSceneLib loader\",\n  \"iterations\": %d,\n  \"results\": [\n", iterations);
+
+    for (size_t r = 0; r < results.size(); r++)
+    {
+        const BenchmarkResult& result = results[r];
+
+        double minTime = result.TotalTimes.empty() ? 0 : *std::min_element(result.TotalTimes.begin(), result.TotalTimes.end());
+        double meanTime = 0;
+        for (double time : result.TotalTimes)
+            meanTime += time / result.TotalTimes.size();
+
+        fprintf(out, "    {\n");
+        fprintf(out, "      \"scenario\": \"%s\",\n", result.Settings.Name.c_str());
+        fprintf(out, "      \"nodes\": %d,\n", result.Settings.NodeCount);
+        fprintf(out, "      \"depth\": %d,\n", result.Settings.HierarchyDepth);
+        fprintf(out, "      \"triangles_per_primitive\": %d,\n", result.Settings.TrianglesPerPrimitive);
+        fprintf(out, "      \"duplicate_ratio\": %.3f,\n", result.Settings.DuplicateRatio);
+        fprintf(out, "      \"textures\": %d,\n", result.Settings.TextureCount);
+        fprintf(out, "      \"file_bytes\": %d,\n", result.FileSize);
+        fprintf(out, "      \"mesh_nodes\": %zu,\n", result.MeshNodes);
+        fprintf(out, "      \"primitives\": %zu,\n", result.LastStats.PrimitiveCount);
+        fprintf(out, "      \"unique_meshes\": %zu,\n", result.LastStats.UniqueMeshes);
+        fprintf(out, "      \"mesh_cache_hits\": %zu,\n", result.LastStats.MeshCacheHits);
+        fprintf(out, "      \"texture_cache_hits\": %zu,\n", result.LastStats.TextureCacheHits);
+        fprintf(out, "      \"texture_cache_misses\": %zu,\n", result.LastStats.TextureCacheMisses);
+        fprintf(out, "      \"allocations\": %zu,\n", result.LastStats.AllocationCount);
+        fprintf(out, "      \"allocated_bytes\": %zu,\n", result.LastStats.AllocatedBytes);
+        fprintf(out, "      \"mesh_data_bytes\": %zu,\n", result.LastStats.MeshDataBytes);
+        fprintf(out, "      \"peak_resident_bytes\": %zu,\n", result.LastStats.PeakResidentBytes);
+        fprintf(out, "      \"total_ms\": { \"min\": %.3f, \"mean\": %.3f },\n", minTime * 1000.0, meanTime * 1000.0);
+        fprintf(out, "      \"phases_ms\": {");
+        for (size_t p = 0; p < size_t(LoadPhase::Count); p++)
+            fprintf(out, "%s \"%s\": %.3f", p == 0 ? "" : ",", GetLoadPhaseName(LoadPhase(p)), result.PhaseTimes[p] * 1000.0);
+        fprintf(out, " },\n");
+        fprintf(out, "      \"server\": { \"min_ms\": %.3f, \"mesh_data_bytes\": %zu, \"peak_resident_bytes\": %zu }\n",
+            result.ServerMinTime * 1000.0, result.ServerStats.MeshDataBytes, result.ServerStats.PeakResidentBytes);
+        fprintf(out, "    }%s\n", r + 1 < results.size() ? "," : "");
+    }
+
+    fprintf(out, "  ],\n  \"concurrent\": { \"files\": %zu, \"sequential_ms\": %.3f, \"concurrent_ms\": %.3f },\n", concurrent.Files, concurrent.SequentialMs, concurrent.ConcurrentMs);
+    fprintf(out, "  \"occlusion\": ");
+    WriteOcclusionResults(out, occlusion);
+    fprintf(out, "\n}\n");
+}
+
+int main(int argc, char* argv[])
+{
+    int iterations = 5;
+    std::string outFile;
+    std::string dataDir = "bench_data";
+
+    SyntheticSceneSettings custom;
+    custom.Name = "custom";
+    bool useCustom = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char* arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        if (!value)
+            break;
+
+        if (strcmp(arg, "--iterations") == 0)
+            iterations = std::max(1, atoi(value));
+        else if (strcmp(arg, "--out") == 0)
+            outFile = value;
+        else if (strcmp(arg, "--data") == 0)
+            dataDir = value;
+        else if (strcmp(arg, "--nodes") == 0)
+            custom.NodeCount = atoi(value), useCustom = true;
+        else if (strcmp(arg, "--depth") == 0)
+            custom.HierarchyDepth = atoi(value), useCustom = true;
+        else if (strcmp(arg, "--triangles") == 0)
+            custom.TrianglesPerPrimitive = atoi(value), useCustom = true;
+        else if (strcmp(arg, "--duplicates") == 0)
+            custom.DuplicateRatio = float(atof(value)), useCustom = true;
+        else if (strcmp(arg, "--textures") == 0)
+            custom.TextureCount = atoi(value), useCustom = true;
+        else
+            continue;
+
+        i++;
+    }
+
+    SetTraceLogLevel(LOG_WARNING);
+
+    // only the CPU side of loading is measured, so no GL context is needed
+    SetHeadlessLoading(true);
+
+    MakeDirectory(dataDir.c_str());
+
+    std::vector<SyntheticSceneSettings> suite = useCustom ? std::vector<SyntheticSceneSettings>{ custom } : GetDefaultSuite();
+
+    std::vector<BenchmarkResult> results;
+    for (const SyntheticSceneSettings& settings : suite)
+        results.push_back(RunScenario(settings, dataDir, iterations));
+
+    ConcurrentResult concurrent = RunConcurrentLoad(suite, dataDir, iterations);
+
+    std::vector<OcclusionBenchmarkResult> occlusion = RunOcclusionBenchmark(iterations);
+
+    FILE* out = stdout;
+    if (!outFile.empty())
+    {
+        out = fopen(outFile.c_str(), "w");
+        if (!out)
+        {
+            TraceLog(LOG_ERROR, "BENCHMARK: unable to open %s", outFile.c_str());
+            out = stdout;
+        }
+    }
+
+    WriteResults(out, results, concurrent, occlusion, iterations);
+
+    if (out != stdout)
+        fclose(out);
+
+    return 0;
+}
@@ -0,0 +1,239 @@
+#include "occlusion_benchmark.h"
+
+#include "raylib.h"
+#include "raymath.h"
+
+#include "scene.h"
+#include "scene_occlusion.h"
+
+#include <chrono>
+#include <random>
+
+namespace
+{
+    constexpr int RoomCount = 16;           // rooms per side
+    constexpr float RoomSize = 10.0f;
+    constexpr float WallHeight = 4.0f;
+    constexpr float WallThickness = 0.4f;
+    constexpr float DoorWidth = 2.0f;
+    constexpr int PropsPerRoom = 24;
+
+    // unit cube around the origin, only what the culler needs, so it can be built without a GL context
+    std::shared_ptr<Mesh> MakeBoxMesh()
+    {
+        // normal, then two axes whose cross product is the normal so the corners wind counter clockwise from outside
+        static const Vector3 faces[6][3] = {
+            { {  1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } },
+            { { -1, 0, 0 }, { 0, 0, 1 }, { 0, 1, 0 } },
+            { { 0,  1, 0 }, { 0, 0, 1 }, { 1, 0, 0 } },
+            { { 0, -1, 0 }, { 1, 0, 0 }, { 0, 0, 1 } },
+            { { 0, 0,  1 }, { 1, 0, 0 }, { 0, 1, 0 } },
+            { { 0, 0, -1 }, { 0, 1, 0 }, { 1, 0, 0 } },
+        };
+
+        auto mesh = std::make_shared<Mesh>();
+        *mesh = Mesh{ 0 };
+        mesh->vertexCount = 24;
+        mesh->triangleCount = 12;
+        mesh->vertices = (float*)MemAlloc(sizeof(float) * 3 * 24);
+        mesh->normals = (float*)MemAlloc(sizeof(float) * 3 * 24);
+        mesh->indices = (unsigned short*)MemAlloc(sizeof(unsigned short) * 36);
+
+        static const float corners[4][2] = { { -1, -1 }, { 1, -1 }, { 1, 1 }, { -1, 1 } };
+
+        for (int f = 0; f < 6; f++)
+        {
+            for (int c = 0; c < 4; c++)
+            {
+                Vector3 position = Vector3Scale(Vector3Add(faces[f][0], Vector3Add(Vector3Scale(faces[f][1], corners[c][0]), Vector3Scale(faces[f][2], corners[c][1]))), 0.5f);
+
+                int v = f * 4 + c;
+                mesh->vertices[v * 3 + 0] = position.x;
+                mesh->vertices[v * 3 + 1] = position.y;
+                mesh->vertices[v * 3 + 2] = position.z;
+                mesh->normals[v * 3 + 0] = faces[f][0].x;
+                mesh->normals[v * 3 + 1] = faces[f][0].y;
+                mesh->normals[v * 3 + 2] = faces[f][0].z;
+            }
+
+            unsigned short first = (unsigned short)(f * 4);
+            unsigned short quad[6] = { 0, 1, 2, 0, 2, 3 };
+            for (int i = 0; i < 6; i++)
+                mesh->indices[f * 6 + i] = first + quad[i];
+        }
+
+        return mesh;
+    }
+
+    void AddBox(Scene& scene, const std::shared_ptr<Mesh>& mesh, const char* name, Vector3 center, Vector3 size)
+    {
+        auto node = std::make_unique<MeshSceneObject>();
+        node->Name = scene.Strings.Intern(name);
+        node->Transform.position = center;
+        node->Transform.scale = size;
+        node->CacheTransform();
+        node->Bounds = BoundingBox{ Vector3{ -0.5f, -0.5f, -0.5f }, Vector3{ 0.5f, 0.5f, 0.5f } };
+
+        MeshSceneObject::MeshInstanceData instance;
+        instance.MaterialData = Material{ 0 };
+        instance.MeshData = mesh;
+        instance.MeshHash = 1;
+        node->Meshes.push_back(instance);
+
+        scene.Meshes.push_back(node.get());
+        scene.RootObjects.push_back(std::move(node));
+    }
+
+    // a wall along one grid line of a room, split around a doorway at a random spot
+    void AddWall(Scene& scene, const std::shared_ptr<Mesh>& mesh, Vector3 start, bool alongX, std::mt19937& rng)
+    {
+        std::uniform_real_distribution<float> doorRange(1.0f, RoomSize - DoorWidth - 1.0f);
+        float door = doorRange(rng);
+
+        float segments[2][2] = { { 0, door }, { door + DoorWidth, RoomSize } };
+        for (auto& segment : segments)
+        {
+            float length = segment[1] - segment[0];
+            float middle = (segment[0] + segment[1]) * 0.5f;
+
+            Vector3 center = alongX ? Vector3{ start.x + middle, WallHeight * 0.5f, start.z } : Vector3{ start.x, WallHeight * 0.5f, start.z + middle };
+            Vector3 size = alongX ? Vector3{ length, WallHeight, WallThickness } : Vector3{ WallThickness, WallHeight, length };
+            AddBox(scene, mesh, "wall", center, size);
+        }
+    }
+
+    void BuildDungeon(Scene& scene)
+    {
+        std::shared_ptr<Mesh> box = MakeBoxMesh();
+        scene.MeshCache[1] = box;
+
+        std::mt19937 rng(1);
+        std::uniform_real_distribution<float> propPosition(1.0f, RoomSize - 1.0f);
+        std::uniform_real_distribution<float> propSize(0.3f, 0.9f);
+
+        for (int z = 0; z < RoomCount; z++)
+        {
+            for (int x = 0; x < RoomCount; x++)
+            {
+                Vector3 corner = { x * RoomSize, 0, z * RoomSize };
+
+                AddBox(scene, box, "floor", Vector3{ corner.x + RoomSize * 0.5f, -0.1f, corner.z + RoomSize * 0.5f }, Vector3{ RoomSize, 0.2f, RoomSize });
+
+                // every room owns its low x and z walls, the far edges of the grid get closed separately
+                AddWall(scene, box, corner, true, rng);
+                AddWall(scene, box, corner, false, rng);
+
+                for (int p = 0; p < PropsPerRoom; p++)
+                {
+                    float size = propSize(rng);
+                    AddBox(scene, box, "prop", Vector3{ corner.x + propPosition(rng), size * 0.5f, corner.z + propPosition(rng) }, Vector3{ size, size, size });
+                }
+            }
+
+            AddWall(scene, box, Vector3{ RoomCount * RoomSize, 0, z * RoomSize }, false, rng);
+            AddWall(scene, box, Vector3{ z * RoomSize, 0, RoomCount * RoomSize }, true, rng);
+        }
+    }
+
+    Camera3D GetView(int view)
+    {
+        float middle = RoomCount * RoomSize * 0.5f + RoomSize * 0.5f;
+
+        Camera3D camera = { 0 };
+        camera.up = Vector3{ 0, 1, 0 };
+        camera.fovy = 60.0f;
+        camera.projection = CAMERA_PERSPECTIVE;
+
+        switch (view)
+        {
+        case 0:         // standing in a room looking at a wall
+            camera.position = Vector3{ middle - 3.0f, 1.7f, middle };
+            camera.target = Vector3{ middle + 5.0f, 1.7f, middle + 0.5f };
+            break;
+
+        case 1:         // standing in a room corner looking across the level
+            camera.position = Vector3{ middle - 4.0f, 1.7f, middle - 4.0f };
+            camera.target = Vector3{ middle + 20.0f, 1.5f, middle + 20.0f };
+            break;
+
+        default:        // above the walls looking down, very little is hidden
+            camera.position = Vector3{ middle, 40.0f, middle - 40.0f };
+            camera.target = Vector3{ middle, 0.0f, middle };
+            break;
+        }
+
+        return camera;
+    }
+
+    const char* ViewNames[] = { "interior", "interior_diagonal", "overview" };
+}
+
+std::vector<OcclusionBenchmarkResult> RunOcclusionBenchmark(int iterations)
+{
+    Scene scene;
+    BuildDungeon(scene);
+
+    OcclusionCuller culler;
+    SelectOccluders(culler, scene);
+
+    std::vector<OcclusionBenchmarkResult> results;
+    std::vector<MeshSceneObject*> visible;
+
+    for (int view = 0; view < 3; view++)
+    {
+        OcclusionBenchmarkResult result;
+        result.View = ViewNames[view];
+        result.MeshNodes = scene.Meshes.size();
+        result.Occluders = culler.Occluders.size();
+
+        Camera3D camera = GetView(view);
+        float aspect = float(culler.Settings.Width) / float(culler.Settings.Height);
+
+        for (int i = 0; i < iterations; i++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            RenderOccluders(culler, camera, aspect);
+            auto rendered = std::chrono::steady_clock::now();
+            CullSceneMeshes(culler, scene, visible);
+            auto culled = std::chrono::steady_clock::now();
+
+            result.RenderMs += std::chrono::duration<double>(rendered - start).count() * 1000.0 / iterations;
+            result.CullMs += std::chrono::duration<double>(culled - rendered).count() * 1000.0 / iterations;
+        }
+
+        result.OccludersDrawn = culler.Stats.OccludersDrawn;
+        result.OccluderTriangles = culler.Stats.OccluderTriangles;
+        result.Visible = visible.size();
+        result.FrustumCulled = culler.Stats.FrustumCulled;
+        result.OcclusionCulled = culler.Stats.OcclusionCulled;
+        results.push_back(result);
+    }
+
+    UnloadScene(scene);
+    return results;
+}
+
+void WriteOcclusionResults(FILE* out, const std::vector<OcclusionBenchmarkResult>& results)
+{
+    fprintf(out, "[\n");
+
+    for (size_t r = 0; r < results.size(); r++)
+    {
+        const OcclusionBenchmarkResult& result = results[r];
+
+        fprintf(out, "    {\n");
+        fprintf(out, "      \"view\": \"%s\",\n", result.View.c_str());
+        fprintf(out, "      \"mesh_nodes\": %zu,\n", result.MeshNodes);
+        fprintf(out, "      \"occluders\": %zu,\n", result.Occluders);
+        fprintf(out, "      \"occluders_drawn\": %zu,\n", result.OccludersDrawn);
+        fprintf(out, "      \"occluder_triangles\": %zu,\n", result.OccluderTriangles);
+        fprintf(out, "      \"visible\": %zu,\n", result.Visible);
+        fprintf(out, "      \"frustum_culled\": %zu,\n", result.FrustumCulled);
+        fprintf(out, "      \"occlusion_culled\": %zu,\n", result.OcclusionCulled);
+        fprintf(out, "      \"render_ms\": %.3f,\n", result.RenderMs);
+        fprintf(out, "      \"cull_ms\": %.3f\n", result.CullMs);
+        fprintf(out, "    }%s\n", r + 1 < results.size() ? "," : "");
+    }
+
+    fprintf(out, "  ]");
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// timings and draw counts of the occlusion culler for one camera view of a generated dungeon
+struct OcclusionBenchmarkResult
+{
+    std::string View;
+    size_t MeshNodes = 0;
+    size_t Occluders = 0;
+    size_t OccludersDrawn = 0;
+    size_t OccluderTriangles = 0;
+    size_t Visible = 0;
+    size_t FrustumCulled = 0;
+    size_t OcclusionCulled = 0;
+    double RenderMs = 0;                    // mean RenderOccluders time
+    double CullMs = 0;                      // mean CullSceneMeshes time
+};
+
+// builds a grid of walled rooms filled with props in memory and culls it from a few fixed views
+std::vector<OcclusionBenchmarkResult> RunOcclusionBenchmark(int iterations);
+
+// writes the results as a json array
+void WriteOcclusionResults(FILE* out, const std::vector<OcclusionBenchmarkResult>& results);
@@ -0,0 +1,298 @@
+#include "synthetic_gltf.h"
+
+#include "raylib.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+    constexpr int ComponentFloat = 5126;
+    constexpr int ComponentUnsignedShort = 5123;
+    constexpr int TargetArrayBuffer = 34962;
+    constexpr int TargetElementArrayBuffer = 34963;
+
+    void AppendFormat(std::string& out, const char* format, ...)
+    {
+        char buffer[512];
+
+        va_list args;
+        va_start(args, format);
+        vsnprintf(buffer, sizeof(buffer), format, args);
+        va_end(args);
+
+        out += buffer;
+    }
+
+    void AppendSeparator(std::string& out)
+    {
+        if (!out.empty())
+            out += ",";
+    }
+
+    // accumulates the binary chunk and the json arrays that describe it
+    struct GLBBuilder
+    {
+        std::vector<unsigned char> Bin;
+
+        std::string BufferViews;
+        std::string Accessors;
+        std::string Meshes;
+        std::string Materials;
+        std::string Textures;
+        std::string Images;
+        std::string Nodes;
+
+        int BufferViewCount = 0;
+        int AccessorCount = 0;
+
+        int AddBufferView(const void* data, size_t size, int target)
+        {
+            while (Bin.size() % 4 != 0)
+                Bin.push_back(0);
+
+            size_t offset = Bin.size();
+            Bin.insert(Bin.end(), (const unsigned char*)data, (const unsigned char*)data + size);
+
+            AppendSeparator(BufferViews);
+            if (target != 0)
+                AppendFormat(BufferViews, "{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu,\"target\":%d}", offset, size, target);
+            else
+                AppendFormat(BufferViews, "{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu}", offset, size);
+
+            return BufferViewCount++;
+        }
+
+        int AddAccessor(int bufferView, int componentType, size_t count, const char* type, const float* min = nullptr, const float* max = nullptr)
+        {
+            AppendSeparator(Accessors);
+            AppendFormat(Accessors, "{\"bufferView\":%d,\"componentType\":%d,\"count\":%zu,\"type\":\"%s\"", bufferView, componentType, count, type);
+            if (min && max)
+                AppendFormat(Accessors, ",\"min\":[%f,%f,%f],\"max\":[%f,%f,%f]", min[0], min[1], min[2], max[0], max[1], max[2]);
+            Accessors += "}";
+
+            return AccessorCount++;
+        }
+    };
+
+    // a displaced grid patch, the variant changes the displacement so every variant hashes differently
+    void AddGridMesh(GLBBuilder& builder, int triangles, int variant, int material)
+    {
+        int side = std::max(1, int(sqrtf(triangles / 2.0f)));
+        side = std::min(side, 254);
+
+        int rowVerts = side + 1;
+        size_t vertexCount = size_t(rowVerts) * rowVerts;
+
+        std::vector<float> positions(vertexCount * 3);
+        std::vector<float> normals(vertexCount * 3);
+        std::vector<float> texcoords(vertexCount * 2);
+        std::vector<uint16_t> indices;
+        indices.reserve(size_t(side) * side * 6);
+
+        float min[3] = { INFINITY, INFINITY, INFINITY };
+        float max[3] = { -INFINITY, -INFINITY, -INFINITY };
+
+        for (int y = 0; y < rowVerts; y++)
+        {
+            for (int x = 0; x < rowVerts; x++)
+            {
+                size_t v = size_t(y) * rowVerts + x;
+                float u = float(x) / side;
+                float w = float(y) / side;
+
+                float height = 0.1f * sinf(u * 6.2831f + variant * 0.37f) * cosf(w * 6.2831f + variant * 0.11f);
+
+                positions[v * 3 + 0] = u - 0.5f;
+                positions[v * 3 + 1] = height;
+                positions[v * 3 + 2] = w - 0.5f;
+
+                normals[v * 3 + 0] = 0;
+                normals[v * 3 + 1] = 1;
+                normals[v * 3 + 2] = 0;
+
+                texcoords[v * 2 + 0] = u;
+                texcoords[v * 2 + 1] = w;
+
+                for (int c = 0; c < 3; c++)
+                {
+                    min[c] = fminf(min[c], positions[v * 3 + c]);
+                    max[c] = fmaxf(max[c], positions[v * 3 + c]);
+                }
+            }
+        }
+
+        for (int y = 0; y < side; y++)
+        {
+            for (int x = 0; x < side; x++)
+            {
+                uint16_t a = uint16_t(y * rowVerts + x);
+                uint16_t b = uint16_t(a + rowVerts);
+
+                indices.insert(indices.end(), { a, b, uint16_t(a + 1), uint16_t(a + 1), b, uint16_t(b + 1) });
+            }
+        }
+
+        int positionView = builder.AddBufferView(positions.data(), positions.size() * sizeof(float), TargetArrayBuffer);
+        int normalView = builder.AddBufferView(normals.data(), normals.size() * sizeof(float), TargetArrayBuffer);
+        int texcoordView = builder.AddBufferView(texcoords.data(), texcoords.size() * sizeof(float), TargetArrayBuffer);
+        int indexView = builder.AddBufferView(indices.data(), indices.size() * sizeof(uint16_t), TargetElementArrayBuffer);
+
+        int positionAccessor = builder.AddAccessor(positionView, ComponentFloat, vertexCount, "VEC3", min, max);
+        int normalAccessor = builder.AddAccessor(normalView, ComponentFloat, vertexCount, "VEC3");
+        int texcoordAccessor = builder.AddAccessor(texcoordView, ComponentFloat, vertexCount, "VEC2");
+        int indexAccessor = builder.AddAccessor(indexView, ComponentUnsignedShort, indices.size(), "SCALAR");
+
+        AppendSeparator(builder.Meshes);
+        AppendFormat(builder.Meshes, "{\"name\":\"mesh_%d\",\"primitives\":[{\"attributes\":{\"POSITION\":%d,\"NORMAL\":%d,\"TEXCOORD_0\":%d},\"indices\":%d,\"material\":%d}]}",
+            variant, positionAccessor, normalAccessor, texcoordAccessor, indexAccessor, material);
+    }
+
+    void AddTexture(GLBBuilder& builder, int index, int size)
+    {
+        Color colorA = Color{ (unsigned char)(index * 37), (unsigned char)(index * 91), (unsigned char)(index * 53), 255 };
+        Image image = GenImageChecked(size, size, std::max(1, size / 8), std::max(1, size / 8), colorA, WHITE);
+
+        int pngSize = 0;
+        unsigned char* png = ExportImageToMemory(image, ".png", &pngSize);
+        UnloadImage(image);
+
+        int view = builder.AddBufferView(png, size_t(pngSize), 0);
+        MemFree(png);
+
+        AppendSeparator(builder.Images);
+        AppendFormat(builder.Images, "{\"name\":\"texture_%d\",\"bufferView\":%d,\"mimeType\":\"image/png\"}", index, view);
+
+        AppendSeparator(builder.Textures);
+        AppendFormat(builder.Textures, "{\"source\":%d}", index);
+    }
+
+    void AddMaterial(GLBBuilder& builder, int index, bool textured)
+    {
+        float r = float((index * 37) % 255) / 255.0f;
+        float g = float((index * 91) % 255) / 255.0f;
+
+        AppendSeparator(builder.Materials);
+        if (textured)
+            AppendFormat(builder.Materials, "{\"name\":\"material_%d\",\"pbrMetallicRoughness\":{\"baseColorFactor\":[%f,%f,1,1],\"baseColorTexture\":{\"index\":%d}}}", index, r, g, index);
+        else
+            AppendFormat(builder.Materials, "{\"name\":\"material_%d\",\"pbrMetallicRoughness\":{\"baseColorFactor\":[%f,%f,1,1]}}", index, r, g);
+    }
+}
+
+bool WriteSyntheticGLB(const SyntheticSceneSettings& settings, const char* fileName)
+{
+    GLBBuilder builder;
+    std::mt19937 random(settings.Seed);
+
+    int nodeCount = std::max(1, settings.NodeCount);
+    int depth = std::max(1, settings.HierarchyDepth);
+    int uniqueMeshes = std::max(1, int(roundf(nodeCount * (1.0f - settings.DuplicateRatio))));
+    int materialCount = std::max(1, settings.TextureCount);
+
+    for (int t = 0; t < settings.TextureCount; t++)
+        AddTexture(builder, t, settings.TextureSize);
+
+    for (int m = 0; m < materialCount; m++)
+        AddMaterial(builder, m, settings.TextureCount > 0);
+
+    for (int m = 0; m < uniqueMeshes; m++)
+        AddGridMesh(builder, settings.TrianglesPerPrimitive, m, m % materialCount);
+
+    // spread the nodes evenly over the levels, every node picks a parent on the level above
+    int nodesPerLevel = (nodeCount + depth - 1) / depth;
+    std::vector<std::vector<int>> children(nodeCount);
+    std::string roots;
+
+    for (int n = 0; n < nodeCount; n++)
+    {
+        int level = n / nodesPerLevel;
+        if (level == 0)
+        {
+            AppendSeparator(roots);
+            AppendFormat(roots, "%d", n);
+        }
+        else
+        {
+            int levelStart = (level - 1) * nodesPerLevel;
+            int parent = levelStart + int(random() % uint32_t(nodesPerLevel));
+            children[size_t(parent)].push_back(n);
+        }
+    }
+
+    std::uniform_real_distribution<float> spread(-50.0f, 50.0f);
+    std::uniform_real_distribution<float> offset(-2.0f, 2.0f);
+
+    for (int n = 0; n < nodeCount; n++)
+    {
+        int mesh = n < uniqueMeshes ? n : int(random() % uint32_t(uniqueMeshes));
+        bool root = n < nodesPerLevel;
+
+        AppendSeparator(builder.Nodes);
+        AppendFormat(builder.Nodes, "{\"name\":\"node_%d\",\"mesh\":%d,\"translation\":[%f,%f,%f]", n, mesh,
+            root ? spread(random) : offset(random), root ? 0.0f : offset(random), root ? spread(random) : offset(random));
+
+        if (!children[size_t(n)].empty())
+        {
+            std::string childList;
+            for (int child : children[size_t(n)])
+            {
+                AppendSeparator(childList);
+                AppendFormat(childList, "%d", child);
+            }
+            builder.Nodes += ",\"children\":[" + childList + "]";
+        }
+        builder.Nodes += "}";
+    }
+
+    while (builder.Bin.size() % 4 != 0)
+        builder.Bin.push_back(0);
+
+    std::string json = "{\"asset\":{\"version\":\"2.0\",\"generator\":\"rlSceneLib benchmark\"},\"scene\":0";
+    json += ",\"scenes\":[{\"nodes\":[" + roots + "]}]";
+    json += ",\"nodes\":[" + builder.Nodes + "]";
+    json += ",\"meshes\":[" + builder.Meshes + "]";
+    json += ",\"materials\":[" + builder.Materials + "]";
+    if (settings.TextureCount > 0)
+    {
+        json += ",\"textures\":[" + builder.Textures + "]";
+        json += ",\"images\":[" + builder.Images + "]";
+    }
+    json += ",\"accessors\":[" + builder.Accessors + "]";
+    json += ",\"bufferViews\":[" + builder.BufferViews + "]";
+    AppendFormat(json, ",\"buffers\":[{\"byteLength\":%zu}]}", builder.Bin.size());
+
+    while (json.size() % 4 != 0)
+        json += ' ';
+
+    uint32_t totalSize = uint32_t(12 + 8 + json.size() + 8 + builder.Bin.size());
+
+    std::vector<unsigned char> glb;
+    glb.reserve(totalSize);
+
+    auto writeU32 = [&glb](uint32_t value)
+        {
+            unsigned char bytes[4];
+            memcpy(bytes, &value, 4);
+            glb.insert(glb.end(), bytes, bytes + 4);
+        };
+
+    writeU32(0x46546C67); // "glTF"
+    writeU32(2);
+    writeU32(totalSize);
+
+    writeU32(uint32_t(json.size()));
+    writeU32(0x4E4F534A); // "JSON"
+    glb.insert(glb.end(), json.begin(), json.end());
+
+    writeU32(uint32_t(builder.Bin.size()));
+    writeU32(0x004E4942); // "BIN"
+    glb.insert(glb.end(), builder.Bin.begin(), builder.Bin.end());
+
+    return SaveFileData(fileName, glb.data(), int(glb.size()));
+}
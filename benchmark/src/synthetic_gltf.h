@@ -0,0 +1,20 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+// description of a generated benchmark scene
+struct SyntheticSceneSettings
+{
+    std::string Name = "default";
+    int NodeCount = 1000;                   // total number of nodes
+    int HierarchyDepth = 4;                 // number of node levels, nodes are spread evenly over the levels
+    int TrianglesPerPrimitive = 512;        // every mesh node has one primitive of this size
+    float DuplicateRatio = 0.5f;            // fraction of mesh nodes that reuse an already generated mesh
+    int TextureCount = 0;                   // number of embedded png textures, materials use them round robin
+    int TextureSize = 64;
+    uint32_t Seed = 1;
+};
+
+// writes a .glb file for the settings, returns false if the file could not be written
+bool WriteSyntheticGLB(const SyntheticSceneSettings& settings, const char* fileName);
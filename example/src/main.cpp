@@ -4,11 +4,15 @@
 
 #include "scene.h"  
 #include "scene_loader.h"
+#include "scene_reload.h"
+#include "scene_light_clusters.h"
+#include "scene_batching.h"
+#include "scene_debug.h"
 
-#define RLIGHTS_IMPLEMENTATION
-#include "rlights.h"
+#include <algorithm>
 
 Scene TestScene;
+SceneFileWatcher TestSceneWatcher;
 
 Camera3D ViewCamera = { 0 };
 bool RegenerateTransforms = false;
@@ -17,8 +21,80 @@ Material DefaultMat = { 0 };
 
 Shader LightShader = { 0 };
 
+// the cluster textures are bound through material maps the lighting shader does not otherwise use
+LightClusterGrid LightClusters;
+LightClusterTextures LightClusterData;
+LightSceneObject FallbackLight;
+
+StaticBatchSet StaticBatches;
+DebugGeometry NodeDebugGeometry;
+
+int ClusterTilesLoc = -1;
+int ClusterScaleLoc = -1;
+int ClusterBiasLoc = -1;
+int DirectionalCountLoc = -1;
+int ScreenSizeLoc = -1;
+
+void ApplyLightShader()
+{
+    for (auto& meshNode : TestScene.Meshes)
+    {
+        for (auto& subMesh : meshNode->Meshes)
+        {
+            subMesh.MaterialData.shader = LightShader;
+            subMesh.MaterialData.maps[MATERIAL_MAP_OCCLUSION].texture = LightClusterData.Lights;
+            subMesh.MaterialData.maps[MATERIAL_MAP_EMISSION].texture = LightClusterData.Clusters;
+            subMesh.MaterialData.maps[MATERIAL_MAP_HEIGHT].texture = LightClusterData.Indices;
+        }
+    }
+
+    for (auto& batch : StaticBatches.Batches)
+    {
+        batch.MaterialData.shader = LightShader;
+        batch.MaterialData.maps[MATERIAL_MAP_OCCLUSION].texture = LightClusterData.Lights;
+        batch.MaterialData.maps[MATERIAL_MAP_EMISSION].texture = LightClusterData.Clusters;
+        batch.MaterialData.maps[MATERIAL_MAP_HEIGHT].texture = LightClusterData.Indices;
+    }
+}
+
+// the level does not move, so every mesh node is merged into a few large meshes
+void RebuildStaticBatches()
+{
+    BuildStaticBatches(TestScene, StaticBatches);
+    UploadStaticBatches(TestScene, StaticBatches);
+}
+
+void UpdateLights()
+{
+    float aspect = float(GetRenderWidth()) / float(std::max(1, GetRenderHeight()));
+
+    unsigned int textureIds[3] = { LightClusterData.Lights.id, LightClusterData.Clusters.id, LightClusterData.Indices.id };
+
+    BuildLightClusters(LightClusters, TestScene.Lights.empty() ? std::vector<LightSceneObject*>{ &FallbackLight } : TestScene.Lights, ViewCamera, aspect);
+    UpdateLightClusterTextures(LightClusters, LightClusterData);
+
+    // the textures are recreated when they grow
+    if (textureIds[0] != LightClusterData.Lights.id || textureIds[1] != LightClusterData.Clusters.id || textureIds[2] != LightClusterData.Indices.id)
+        ApplyLightShader();
+
+    int tiles[3] = { LightClusters.Settings.TilesX, LightClusters.Settings.TilesY, LightClusters.Settings.Slices };
+    float screenSize[2] = { float(GetRenderWidth()), float(GetRenderHeight()) };
+
+    SetShaderValue(LightShader, ClusterTilesLoc, tiles, SHADER_UNIFORM_IVEC3);
+    SetShaderValue(LightShader, ClusterScaleLoc, &LightClusters.SliceScale, SHADER_UNIFORM_FLOAT);
+    SetShaderValue(LightShader, ClusterBiasLoc, &LightClusters.SliceBias, SHADER_UNIFORM_FLOAT);
+    SetShaderValue(LightShader, DirectionalCountLoc, &LightClusters.DirectionalCount, SHADER_UNIFORM_INT);
+    SetShaderValue(LightShader, ScreenSizeLoc, screenSize, SHADER_UNIFORM_VEC2);
+}
+
 void GameInit()
 {
+    // decode the scene before the window exists, it is uploaded once there is a GL context
+    SetHeadlessLoading(true);
+    SetMeshStorageLayout(MeshStorageLayout::SingleBlock);
+    //LoadSceneFromGLTF("resources/normal.glb", TestScene);
+    LoadSceneFromGLTF("resources/DungeonScene.glb", TestScene);
+
     SetConfigFlags(FLAG_VSYNC_HINT | FLAG_WINDOW_RESIZABLE | FLAG_WINDOW_HIGHDPI | FLAG_MSAA_4X_HINT);
     InitWindow(1280, 800, "Example");
     SetTargetFPS(144);
@@ -30,7 +106,7 @@ void GameInit()
     ViewCamera.target = { 0, 0, 0 };
     ViewCamera.position = { 0, 5, -10 };
 
-    LightShader = LoadShader("resources/lighting.vs", "resources/lighting.fs");
+    LightShader = LoadShader("resources/clustered.vs", "resources/clustered.fs");
 
     LightShader.locs[SHADER_LOC_VECTOR_VIEW] = GetShaderLocation(LightShader, "viewPos");
 	// NOTE: "matModel" location name is automatically assigned on shader loading,
@@ -42,11 +118,18 @@ void GameInit()
 
     float ambient[4] = { 0.1f, 0.1f, 0.1f, 1.0f };
 	SetShaderValue(LightShader, ambientLoc, ambient, SHADER_UNIFORM_VEC4);
-    
-    //LoadSceneFromGLTF("resources/normal.glb", TestScene);
 
- 
-    LoadSceneFromGLTF("resources/DungeonScene.glb", TestScene);
+    LightShader.locs[SHADER_LOC_MAP_OCCLUSION] = GetShaderLocation(LightShader, "lightData");
+    LightShader.locs[SHADER_LOC_MAP_EMISSION] = GetShaderLocation(LightShader, "clusterData");
+    LightShader.locs[SHADER_LOC_MAP_HEIGHT] = GetShaderLocation(LightShader, "lightIndices");
+
+    ClusterTilesLoc = GetShaderLocation(LightShader, "clusterTiles");
+    ClusterScaleLoc = GetShaderLocation(LightShader, "clusterScale");
+    ClusterBiasLoc = GetShaderLocation(LightShader, "clusterBias");
+    DirectionalCountLoc = GetShaderLocation(LightShader, "directionalCount");
+    ScreenSizeLoc = GetShaderLocation(LightShader, "screenSize");
+
+    UploadScene(TestScene);
 
 	for (auto* camera : TestScene.Cameras)
 	{
@@ -56,74 +139,21 @@ void GameInit()
 		ViewCamera.target = Vector3Transform(Vector3UnitZ, camera->WorldMatrix) - ViewCamera.position;
 	}
 
-    for (auto& meshNode : TestScene.Meshes)
-    {
-        for (auto& subMesh : meshNode->Meshes)
-		{
-            subMesh.MaterialData.shader = LightShader;
-		}
-    }
+    // used when the scene has no lights of its own
+    FallbackLight.LightType = LightSceneObject::LightTypes::Directional;
+    FallbackLight.WorldMatrix = MatrixInvert(MatrixLookAt(Vector3{ -2, 1, -2 }, Vector3Zeros, Vector3UnitY));
 
-	int lightCount = 0;
-	for (auto& lightNode : TestScene.Lights)
-	{
-		if (lightCount < 4)
-		{
- 			int lightType = LIGHT_POINT;
- 			switch (lightNode->LightType)
- 			{
- 			case LightSceneObject::LightTypes::Directional:
- 				lightType = LIGHT_DIRECTIONAL;
- 				break;
- 			case LightSceneObject::LightTypes::Spot:
- 				lightType = LIGHT_POINT;
- 				break;
- 			case LightSceneObject::LightTypes::Point:
- 				lightType = LIGHT_POINT;
- 				break;
- 			default:
- 				lightType = LIGHT_POINT;
- 				break;
- 			}
-
-			Vector3 lightPos = Vector3Transform(Vector3Zeros, lightNode->WorldMatrix);
-			Vector3 lightTarget = Vector3Transform(Vector3UnitZ, lightNode->WorldMatrix);
-		    CreateLight(lightType, lightPos, lightTarget, lightNode->EmissiveColor, LightShader);
-		}
-
-		lightCount++;
-	}
+    RebuildStaticBatches();
 
-    if (lightCount == 0)
-    {
-		CreateLight(LIGHT_DIRECTIONAL, Vector3{ -2, 1, -2 }, Vector3Zeros, WHITE, LightShader);
-    }
+    UpdateLights();
+    ApplyLightShader();
 
-    for (auto& [hash, mesh] : TestScene.MeshCache)
-    {
-        UploadMesh(mesh.get(), false);
+    // batched meshes keep their vertices so the batches can be rebuilt when the file changes
+    std::unordered_set<size_t> batchMeshes = GetStaticBatchMeshes(StaticBatches);
+    UnloadSceneMeshData(TestScene, &batchMeshes);
 
-        if (mesh->vertices)
-        {
-            MemFree(mesh->vertices);
-            mesh->vertices = nullptr;
-        }
-        if (mesh->texcoords)
-        {
-            MemFree(mesh->texcoords);
-            mesh->texcoords = nullptr;
-        }
-        if (mesh->normals)
-        {
-            MemFree(mesh->normals);
-            mesh->normals = nullptr;
-        }
-        if (mesh->colors)
-        {
-            MemFree(mesh->colors);
-            mesh->colors = nullptr;
-        }
-    }
+    // re-exporting the file updates the running scene
+    TestSceneWatcher.Watch("resources/DungeonScene.glb", TestScene);
 
     DefaultMat = LoadMaterialDefault();
 }
@@ -131,15 +161,9 @@ void GameInit()
 void GameCleanup()
 {
     // unload resources
-    for (auto& [hash, mesh] : TestScene.MeshCache)
-    {
-        UnloadMesh(*mesh.get());
-    }
-
-    for (auto& [hash, texture] : TestScene.TextureCache)
-    {
-        UnloadTexture(texture);
-    }
+    UnloadLightClusterTextures(LightClusterData);
+    UnloadStaticBatches(StaticBatches);
+    UnloadScene(TestScene);
     CloseWindow();
 }
 
@@ -188,92 +212,30 @@ bool GameUpdate()
 
     RegenerateTransforms = false;
 
-    if (IsKeyPressed(KEY_F1))
-        RegenerateTransforms = true;
-    return true;
-}
-
-void DrawNode(SceneObject* node)
-{
-    if (RegenerateTransforms)
-        node->CacheTransform();
-
-    rlPushMatrix();
-    rlMultMatrixf(MatrixToFloat(node->WorldMatrix));
-
-    auto inverseScale = Vector3Invert(node->Transform.scale);
-
-    DrawLine3D(Vector3{ inverseScale.x,0,0 }, Vector3{ -inverseScale.x,0,0 }, RED);
-    DrawLine3D(Vector3{ 0,inverseScale.y,0 }, Vector3{ 0,-inverseScale.y,0 }, GREEN);
-    DrawLine3D(Vector3{ 0,0,inverseScale.z }, Vector3{ 0,0,-inverseScale.z }, BLUE);
-
-    switch (node->GetType())
+    if (TestSceneWatcher.Update())
     {
-    case SceneObjectType::GenericObject:
-        break;
-
-    case SceneObjectType::MeshObject:
-    {
-        MeshSceneObject* mesh = dynamic_cast<MeshSceneObject*>(node);
-
-//         for (auto& subMesh : mesh->Meshes)
-//         {
-//             DrawMesh(*subMesh.MeshData.get(), subMesh.MaterialData, MatrixIdentity());
-//         }
-
-        DrawBoundingBox(mesh->Bounds, GREEN);
-
-        break;
-    }
-
-    case SceneObjectType::LightObject:
-    {
-        LightSceneObject* light = dynamic_cast<LightSceneObject*>(node);
-        switch (light->LightType)
-        {
-        case LightSceneObject::LightTypes::Directional:
-            //	rlRotatef(-45, 1, 0, 0);
-            DrawCylinderWires(Vector3{ 0,-1.0f, 0 }, 0.1f, 2.0f, 0.5F, 10, light->EmissiveColor);
-            break;
+        UploadScene(TestScene);
+        RebuildStaticBatches();
+        ApplyLightShader();
 
-        case LightSceneObject::LightTypes::Spot:
-            rlRotatef(90, 1, 0, 0);
-            DrawCylinderWires(Vector3{ 0,-light->Range, 0 }, 0.125f, light->Range * tanf(light->MaxCone), light->Range, 12, light->EmissiveColor);
-            break;
-
-        case LightSceneObject::LightTypes::Point:
-            rlRotatef(90, 1, 0, 0);
-            DrawSphere(Vector3Zeros, 0.5f, light->EmissiveColor);
-            DrawCylinder(Vector3{ 0,0.4f,0 }, 0.20f, 0.25f, 0.4f, 10, GRAY);
-
-            DrawSphereWires(Vector3Zeros, light->Range, 8,8, ColorAlpha(light->EmissiveColor, 0.25f));
-            break;
-
-        default:
-            break;
-        }
-
-        break;
+        std::unordered_set<size_t> batchMeshes = GetStaticBatchMeshes(StaticBatches);
+        UnloadSceneMeshData(TestScene, &batchMeshes);
+        NodeDebugGeometry.Dirty = true;
     }
 
-    case SceneObjectType::CameraObject:
-    {
-        rlRotatef(90, 1, 0, 0);
-        DrawCylinderWires(Vector3{ 0,-0.5f,0 }, 0.25f, 0.5F, 0.5f, 10, BLACK);
-        DrawCubeWires(Vector3{ 0,1.0f,0 }, 0.75f, 2, 1.0f, BLACK);
-        break;
-    }
+    UpdateLights();
 
-    default:
-        break;
-    }
+    if (IsKeyPressed(KEY_F1))
+        RegenerateTransforms = true;
+    return true;
+}
 
-    rlPopMatrix();
+void RegenerateNodeTransforms(SceneObject* node)
+{
+    node->CacheTransform();
 
     for (auto& child : node->Children)
-    {
-        DrawNode(child.get());
-    }
+        RegenerateNodeTransforms(child.get());
 }
 
 void GameDraw()
@@ -288,8 +250,13 @@ void GameDraw()
     DrawLine3D(Vector3{ 0,0.01f,100 }, Vector3{ 0, 0.01f, -100 }, BLUE);
 
     // draw the meshes
+    DrawStaticBatches(StaticBatches);
+
     for (auto& meshNode : TestScene.Meshes)
     {
+        if (StaticBatches.BatchedNodes.contains(meshNode))
+            continue;
+
         for (auto& subMesh : meshNode->Meshes)
         {
             DrawMesh(*subMesh.MeshData.get(), subMesh.MaterialData, meshNode->WorldMatrix);
@@ -297,16 +264,29 @@ void GameDraw()
     }
     rlDrawRenderBatchActive();
  //   rlDisableDepthTest();
-    for (auto& node : TestScene.RootObjects)
-        DrawNode(node.get());
+    if (RegenerateTransforms)
+    {
+        for (auto& node : TestScene.RootObjects)
+            RegenerateNodeTransforms(node.get());
+
+        UpdateSceneWorldBounds(TestScene);
+
+        // the batches hold world space copies of the vertices
+        RebuildStaticBatches();
+        ApplyLightShader();
+    }
+
+    UpdateDebugGeometry(TestScene, NodeDebugGeometry);
+    DrawDebugGeometry(NodeDebugGeometry);
     rlDrawRenderBatchActive();
    // rlEnableDepthTest();
 
     EndMode3D();
 
     DrawFPS(5, 0);
-    DrawText(TextFormat("Unique Meshes %d", TestScene.MeshCache.size()), 5, 20, 20, BLACK);
-    DrawText(TextFormat("Mesh Nodes %d", TestScene.Meshes.size()), 5, 40, 20, BLACK);
+    DrawText(TextFormat("Unique Meshes %d", int(TestScene.MeshCache.size())), 5, 20, 20, BLACK);
+    DrawText(TextFormat("Mesh Nodes %d", int(TestScene.Meshes.size())), 5, 40, 20, BLACK);
+    DrawText(TextFormat("Static Batches %d", int(StaticBatches.Batches.size())), 5, 60, 20, BLACK);
     EndDrawing();
 }
 
@@ -0,0 +1,105 @@
+#version 330
+
+// Input vertex attributes (from vertex shader)
+in vec3 fragPosition;
+in vec2 fragTexCoord;
+in vec4 fragColor;
+in vec3 fragNormal;
+in float fragViewDepth;
+
+// Input uniform values
+uniform sampler2D texture0;
+uniform vec4 colDiffuse;
+
+// Output fragment color
+out vec4 finalColor;
+
+#define     LIGHT_POINT             0
+#define     LIGHT_DIRECTIONAL       1
+#define     LIGHT_SPOT              2
+
+#define     INDEX_TEXTURE_WIDTH     1024
+
+// cluster data written by UpdateLightClusterTextures
+uniform sampler2D lightData;        // 4 texels per light
+uniform sampler2D clusterData;      // offset and count per cluster
+uniform sampler2D lightIndices;     // light indices for all clusters
+
+uniform ivec3 clusterTiles;         // tiles x, tiles y, slices
+uniform float clusterScale;
+uniform float clusterBias;
+uniform int directionalCount;
+uniform vec2 screenSize;
+
+uniform vec4 ambient;
+uniform vec3 viewPos;
+
+vec3 ShadeLight(int index, vec3 normal, vec3 viewD, inout vec3 specular)
+{
+    vec4 positionRange = texelFetch(lightData, ivec2(0, index), 0);
+    vec4 colorIntensity = texelFetch(lightData, ivec2(1, index), 0);
+    vec4 directionCone = texelFetch(lightData, ivec2(2, index), 0);
+    vec4 coneType = texelFetch(lightData, ivec2(3, index), 0);
+
+    int type = int(coneType.y + 0.5);
+
+    vec3 light = -directionCone.xyz;
+    float attenuation = 1.0;
+
+    if (type != LIGHT_DIRECTIONAL)
+    {
+        vec3 toLight = positionRange.xyz - fragPosition;
+        float distance = length(toLight);
+        light = toLight/max(distance, 0.0001);
+
+        // inverse square with a window that reaches zero at the range, lights without a range are not windowed
+        float falloff = 1.0;
+        if (positionRange.w > 0.0) falloff = clamp(1.0 - pow(distance/positionRange.w, 4.0), 0.0, 1.0);
+        attenuation = falloff*falloff/(distance*distance + 1.0);
+
+        if (type == LIGHT_SPOT)
+            attenuation *= smoothstep(directionCone.w, coneType.x, dot(-light, directionCone.xyz));
+    }
+
+    float NdotL = max(dot(normal, light), 0.0);
+
+    if (NdotL > 0.0) specular += pow(max(0.0, dot(viewD, reflect(-light, normal))), 16.0)*attenuation;
+
+    return colorIntensity.rgb*colorIntensity.a*NdotL*attenuation;
+}
+
+void main()
+{
+    // Texel color fetching from texture sampler
+    vec4 texelColor = texture(texture0, fragTexCoord);
+    vec3 lightDot = vec3(0.0);
+    vec3 normal = normalize(fragNormal);
+    vec3 viewD = normalize(viewPos - fragPosition);
+    vec3 specular = vec3(0.0);
+
+    vec4 tint = colDiffuse*fragColor;
+
+    for (int i = 0; i < directionalCount; i++)
+        lightDot += ShadeLight(i, normal, viewD, specular);
+
+    // find the cluster this pixel is in
+    ivec2 tile = clamp(ivec2(gl_FragCoord.xy/screenSize*vec2(clusterTiles.xy)), ivec2(0), clusterTiles.xy - 1);
+    int slice = clamp(int(floor(log(max(fragViewDepth, 0.0001))*clusterScale - clusterBias)), 0, clusterTiles.z - 1);
+
+    vec4 cluster = texelFetch(clusterData, ivec2(tile.x + tile.y*clusterTiles.x, slice), 0);
+    int offset = int(cluster.x);
+    int count = int(cluster.y);
+
+    for (int i = 0; i < count; i++)
+    {
+        int n = offset + i;
+        int index = int(texelFetch(lightIndices, ivec2(n%INDEX_TEXTURE_WIDTH, n/INDEX_TEXTURE_WIDTH), 0).r);
+        lightDot += ShadeLight(index, normal, viewD, specular);
+    }
+
+    finalColor = (texelColor*((tint + vec4(specular, 1.0))*vec4(lightDot, 1.0)));
+    finalColor += texelColor*(ambient/10.0)*tint;
+
+    // Gamma correction
+    finalColor = pow(finalColor, vec4(1.0/2.2));
+}
@@ -6,7 +6,9 @@
 #include <memory>
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
 #include <string>
+#include <string_view>
 
 enum class SceneObjectType
 {
@@ -16,6 +18,25 @@ enum class SceneObjectType
     CameraObject
 };
 
+// stores every distinct string once, the returned views stay valid as long as the pool does
+class StringPool
+{
+public:
+    std::string_view Intern(std::string_view text);
+
+    size_t Size() const { return Strings.size(); }
+    void Clear() { Strings.clear(); }
+
+private:
+    struct Hash
+    {
+        using is_transparent = void;
+        size_t operator()(std::string_view text) const { return std::hash<std::string_view>()(text); }
+    };
+
+    std::unordered_set<std::string, Hash, std::equal_to<>> Strings;
+};
+
 struct PQSTransform
 {
     Vector3 position = Vector3Zeros;               // Position in 3D space
@@ -30,6 +51,19 @@ struct PQSTransform
     }
 };
 
+struct BoundingSphere
+{
+    Vector3 Center = Vector3Zeros;
+    float Radius = 0;
+};
+
+// local bounds of a cached mesh, computed once when the mesh is cached
+struct MeshBounds
+{
+    BoundingBox Box = { 0 };
+    BoundingSphere Sphere;
+};
+
 struct SceneObject
 {
 protected:
@@ -38,10 +72,11 @@ protected:
 public:
     SceneObjectType GetType() const { return Type; }
 
-    std::string Name;
+    std::string_view Name;                          // interned in Scene::Strings
     PQSTransform Transform;
 
     Matrix WorldMatrix;
+    bool BoundsDirty = true;                        // set by CacheTransform, UpdateSceneWorldBounds refreshes mesh nodes that have it
 
     SceneObject* Parent = nullptr;
     std::vector<std::unique_ptr<SceneObject>> Children;
@@ -52,12 +87,17 @@ public:
 
 struct MeshSceneObject : public SceneObject
 {
-    BoundingBox Bounds = { 0 };
+    BoundingBox Bounds = { 0 };                     // mesh space, all instances
+    BoundingSphere Sphere;                          // mesh space, all instances
+    BoundingBox WorldBounds = { 0 };                // world space box around Bounds, kept by UpdateSceneWorldBounds
 
     struct MeshInstanceData
     {
         Material MaterialData;
         std::shared_ptr<Mesh> MeshData = nullptr;
+        size_t MeshHash = 0;                        // key of MeshData in Scene::MeshCache
+        size_t TextureHash = 0;                     // key of the albedo texture in Scene::TextureCache, 0 when untextured
+        bool SharedMaterial = false;                // MaterialData.maps belongs to Scene::PrefabMeshes, not to this instance
     };
 
     std::vector<MeshInstanceData> Meshes;
@@ -101,14 +141,110 @@ struct LightSceneObject : public SceneObject
     }
 };
 
+enum class MeshStorageLayout
+{
+    Separate,                                       // one allocation per attribute, the mesh can be freed with UnloadMesh
+    SingleBlock,                                    // all attributes and indices share one allocation owned by the scene
+    Interleaved                                     // SingleBlock plus an interleaved position/normal/uv stream for CPU passes
+};
+
+struct InterleavedVertex
+{
+    Vector3 Position;
+    Vector3 Normal;
+    Vector2 Texcoord;
+};
+
+// CPU storage of a mesh that was allocated as one block, the mesh arrays point into Data
+struct MeshBlock
+{
+    void* Data = nullptr;
+    InterleavedVertex* Vertices = nullptr;          // only set for MeshStorageLayout::Interleaved
+};
+
+// A simplified version of a cached mesh
+struct MeshLOD
+{
+    std::shared_ptr<Mesh> MeshData = nullptr;
+    float Error = 0;                                // geometric error of the LOD in mesh space units
+    float ScreenError = 1.0f;                       // max projected error in pixels before this LOD is rejected
+};
+
 struct Scene
 {
     std::unordered_map<size_t, Texture> TextureCache;
+    std::unordered_map<size_t, Image> ImageCache;                   // decoded textures waiting for UploadScene, headless loads only
     std::unordered_map<size_t, std::shared_ptr<Mesh>> MeshCache;
+    std::unordered_map<size_t, std::vector<MeshLOD>> MeshLODs;     // LOD chains for MeshCache entries, finest first
+    std::unordered_map<size_t, MeshBlock> MeshBlocks;               // storage of MeshCache entries that use a single block
+    std::unordered_map<size_t, MeshBounds> MeshBoundsCache;         // local bounds of MeshCache entries, so instances never rescan vertices
     std::vector<std::unique_ptr<SceneObject>> RootObjects;
+    std::vector<MeshSceneObject::MeshInstanceData> PrefabMeshes;    // mesh instances of prefabs made for this scene, their instances share the material maps
+
+    StringPool Strings;                                             // node names and prefab paths
+    StringPool Paths;                                               // keys of PathIndex, cleared when the index is rebuilt
+    std::unordered_multimap<std::string_view, SceneObject*> NameIndex;
+    std::unordered_multimap<std::string_view, SceneObject*> PathIndex;  // names from the root joined with '/'
 
     std::vector<CameraSceneObject*> Cameras;
     std::vector<LightSceneObject*> Lights;
     std::vector<MeshSceneObject*> Meshes;
 };
 
+void PQSTransformToMatrix(const PQSTransform& transform, Matrix& out_matrix);
+
+// box and sphere around the vertices of a mesh, zero when it has no CPU vertices
+MeshBounds ComputeMeshBounds(const Mesh& mesh);
+
+// smallest sphere around both spheres
+BoundingSphere MergeBoundingSpheres(const BoundingSphere& a, const BoundingSphere& b);
+
+// world axis aligned box around a transformed local box
+BoundingBox TransformBoundingBox(const BoundingBox& local, const Matrix& world);
+
+// recomputes WorldBounds of the mesh nodes whose BoundsDirty is set, or of all of them, in one batched pass
+// call it once after adding or moving nodes, the loader and reload call it themselves, returns the number of nodes updated
+size_t UpdateSceneWorldBounds(Scene& scene, bool all = false);
+
+// rebuilds the name and path index, the loader does this, call it again after nodes are added, moved or renamed
+void BuildSceneNameIndex(Scene& scene);
+
+// returns the first node with the name, or nullptr
+SceneObject* FindSceneObject(const Scene& scene, std::string_view name);
+
+// returns every node with the name
+std::vector<SceneObject*> FindSceneObjects(const Scene& scene, std::string_view name);
+
+// returns the first node with the path (names from the root joined with '/'), or nullptr
+SceneObject* FindSceneObjectByPath(const Scene& scene, std::string_view path);
+
+// appends a name to a path the way the index does, nodes below a node with an empty path get no leading '/'
+std::string JoinScenePath(std::string_view parentPath, std::string_view name);
+
+// builds the path of a node by walking up its parents
+std::string GetSceneObjectPath(const SceneObject& object);
+
+// removes a node and its children from the scene, the index and the mesh, light and camera lists
+// cached meshes and textures stay loaded since other nodes may use them
+void DestroySceneObject(Scene& scene, SceneObject* object);
+
+// unloads all GPU and CPU data owned by the scene caches and clears the scene
+void UnloadScene(Scene& scene);
+
+// unloads cached meshes, LODs and textures that no node or prefab uses anymore
+void UnloadUnusedSceneData(Scene& scene);
+
+// uploads textures and meshes that were loaded headless, then points the materials at the uploaded data
+// maxUploads limits how many textures and meshes are uploaded per call (0 for all) so the work can be spread over frames
+// returns true once everything is uploaded, requires a GL context
+bool UploadScene(Scene& scene, int maxUploads = 0);
+
+// frees the CPU vertex data of all cached meshes once they are uploaded, indices are kept since DrawMesh needs them
+// meshes whose hash is in keepMeshes keep their CPU data, for passes that run again after a reload
+void UnloadSceneMeshData(Scene& scene, const std::unordered_set<size_t>* keepMeshes = nullptr);
+
+// copies the position, normal and uv arrays of a mesh into an interleaved stream
+void FillInterleavedVertices(const Mesh& mesh, InterleavedVertex* vertices);
+
+// rebuilds the interleaved streams after the mesh arrays were modified in place
+void UpdateInterleavedVertices(Scene& scene);
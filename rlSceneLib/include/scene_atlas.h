@@ -0,0 +1,30 @@
+#pragma once
+
+#include "scene.h"
+
+// Texture atlasing
+// small base color textures are packed into shared atlases so the materials that use them bind the same texture
+// and can be batched together, the texcoords of their meshes are remapped into the atlas
+// packing only depends on the images and settings, so the same scene always gives the same atlases
+
+struct TextureAtlasSettings
+{
+    int MaxTextureSize = 256;                       // textures with a larger side are left alone
+    int AtlasSize = 2048;                           // atlas width and largest height, the height shrinks to what is used
+    int Padding = 4;                                // border of repeated edge pixels around every texture
+    bool Mipmaps = true;                            // the padding keeps the finer levels from bleeding into neighbours
+};
+
+struct TextureAtlasStats
+{
+    size_t Atlases = 0;
+    size_t PackedTextures = 0;
+    size_t RemappedMeshes = 0;
+    size_t SkippedTextures = 0;                     // small textures that could not be packed, see AtlasSceneTextures
+};
+
+// packs the small images of Scene::ImageCache, so the scene must be loaded headless and not be uploaded yet
+// a texture is skipped when one of its meshes has no CPU texcoords, uses texcoords outside 0-1 for tiling
+// or is shared with a material that uses another texture, since its texcoords can only be remapped once
+// remapped meshes are stored under a new hash, so reloading the file does not reuse them with the original texture
+TextureAtlasStats AtlasSceneTextures(Scene& scene, const TextureAtlasSettings& settings = TextureAtlasSettings());
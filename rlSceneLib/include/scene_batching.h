@@ -0,0 +1,62 @@
+#pragma once
+
+#include "scene.h"
+
+#include <cstdint>
+#include <functional>
+#include <unordered_set>
+
+// Static batching
+// the meshes of nodes that never move are transformed into world space and merged per material, so a level of small
+// environment pieces draws with a few large meshes, every batch stays under 65535 vertices for 16 bit indices
+
+struct StaticBatchSettings
+{
+    std::function<bool(const MeshSceneObject&)> IsStatic;   // nodes to batch, every mesh node when not set
+    int MaxVertices = 65535;                                // vertex limit per batch, lower it to get smaller batches for culling
+};
+
+// the triangles of one source mesh instance inside a batch
+struct StaticBatchSource
+{
+    const MeshSceneObject* Node = nullptr;
+    size_t MeshIndex = 0;                                   // index into Node->Meshes
+    uint32_t FirstTriangle = 0;
+    uint32_t TriangleCount = 0;
+};
+
+struct StaticBatch
+{
+    Material MaterialData = { 0 };                          // owns its maps, the textures belong to the scene
+    size_t TextureHash = 0;
+    std::shared_ptr<Mesh> MeshData;                         // world space vertices
+    BoundingBox Bounds = { 0 };                             // world space
+    std::vector<StaticBatchSource> Sources;                 // sorted by FirstTriangle
+};
+
+struct StaticBatchSet
+{
+    std::vector<StaticBatch> Batches;
+    std::unordered_set<const MeshSceneObject*> BatchedNodes;   // nodes drawn by the batches, skip these when drawing the scene
+};
+
+// merges the static nodes of the scene, the meshes must still have CPU side data, so call it before UnloadSceneMeshData
+// nodes are only batched when all their mesh instances can be, the batch vertex data is kept on the CPU for picking
+void BuildStaticBatches(const Scene& scene, StaticBatchSet& batches, const StaticBatchSettings& settings = StaticBatchSettings());
+
+// uploads the batch meshes and points their materials at the uploaded scene textures, call it after UploadScene
+void UploadStaticBatches(const Scene& scene, StaticBatchSet& batches);
+
+void DrawStaticBatches(const StaticBatchSet& batches);
+
+// returns the source of a triangle of a batch, or nullptr when the index is out of range
+const StaticBatchSource* GetStaticBatchSource(const StaticBatch& batch, uint32_t triangle);
+
+// casts a ray against the batch triangles and returns the source node of the closest hit, or nullptr
+const MeshSceneObject* PickStaticBatches(const StaticBatchSet& batches, const Ray& ray, RayCollision* collision = nullptr);
+
+// hashes of the cached meshes the batches were built from, pass them to UnloadSceneMeshData
+// so the batches can be built again after a reload, reused meshes would otherwise have no vertices to merge
+std::unordered_set<size_t> GetStaticBatchMeshes(const StaticBatchSet& batches);
+
+void UnloadStaticBatches(StaticBatchSet& batches);
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "scene.h"
+
+#include <cstdint>
+
+// Debug geometry
+// node axes, mesh bounds, light ranges and camera frusta are built as world space line and triangle lists in one pass
+// over the scene, the lists are kept until a transform changes and drawn as one rlgl batch instead of a matrix push
+// and a handful of shape calls per node
+
+enum DebugGeometryFlags : uint32_t
+{
+    DebugGeometryAxes = 1 << 0,
+    DebugGeometryBounds = 1 << 1,
+    DebugGeometryLights = 1 << 2,
+    DebugGeometryCameras = 1 << 3,
+    DebugGeometryAll = 0xFFFFFFFF,
+};
+
+struct DebugGeometrySettings
+{
+    uint32_t Categories = DebugGeometryAll;         // DebugGeometryFlags to build
+    float AxisLength = 1.0f;                        // world space, the node scale does not change it
+    float LightSize = 0.5f;                         // size of the light markers
+    float CameraAspect = 16.0f / 9.0f;              // scene cameras have no aspect of their own
+    float CameraNear = 0.1f;
+    float CameraFar = 2.0f;                         // frusta are only drawn this deep
+    int CircleSegments = 24;                        // segments of the range and cone circles
+};
+
+struct DebugVertex
+{
+    Vector3 Position;
+    Color Tint;
+};
+
+struct DebugGeometry
+{
+    DebugGeometrySettings Settings;
+
+    std::vector<DebugVertex> Lines;                 // two vertices per line
+    std::vector<DebugVertex> Triangles;             // three vertices per triangle
+
+    bool Dirty = true;                              // set it after changing the settings, a light or a camera, moved nodes are found on their own
+
+    std::vector<Matrix> NodeMatrices;               // world matrices the lists were built from, in tree order
+};
+
+// rebuilds the lists from the world matrices of the scene, CacheTransform must have been called on moved nodes
+void BuildDebugGeometry(const Scene& scene, DebugGeometry& geometry);
+
+// rebuilds the lists only when a node moved, the node count changed, or Dirty is set, returns true if it rebuilt them
+bool UpdateDebugGeometry(const Scene& scene, DebugGeometry& geometry);
+
+// draws the lists with the current rlgl state, call it inside BeginMode3D
+void DrawDebugGeometry(const DebugGeometry& geometry);
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "scene.h"
+
+#include <string_view>
+
+struct SceneExportSettings
+{
+    bool QuantizeNormals = true;                    // normals and tangents as normalized 8 bit values, uses KHR_mesh_quantization
+    bool QuantizeTexcoords = true;                  // texcoords as normalized 16 bit values when they all fit in 0-1
+    bool EmbedTextures = true;                      // albedo textures are written as png into the binary chunk
+};
+
+// writes the scene hierarchy, cached meshes, materials, lights and cameras to a .glb file
+// meshes shared through the mesh cache are written once and need their CPU data
+// textures come from Scene::ImageCache, or are read back from the GPU when the scene was uploaded
+bool ExportSceneToGLB(const Scene& scene, std::string_view filename, const SceneExportSettings& settings = SceneExportSettings());
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "scene.h"
+
+#include <cstdint>
+#include <vector>
+
+// Clustered light culling
+// the view frustum is split into a grid of froxels, screen tiles by exponential depth slices, and every froxel gets the list of
+// point and spot lights that reach it, so a shader only evaluates the lights near each pixel
+// directional lights reach everything and are kept out of the grid
+
+struct LightClusterSettings
+{
+    int TilesX = 16;
+    int TilesY = 9;
+    int Slices = 24;
+    float NearDepth = 0.1f;                         // first slice starts here, closer pixels use slice 0
+    float FarDepth = 500.0f;                        // last slice ends here, pixels further away use the last slice
+    int MaxLightsPerCluster = 64;
+    float CutoffIntensity = 1.0f / 256.0f;          // lights without a range end where their light falls below this
+    int ThreadCount = 0;                            // 0 uses all cores
+};
+
+// one light as 4 vec4s, the same layout the shader reads
+struct ClusterLight
+{
+    float Position[3];                              // world space
+    float Range;                                    // lights without a range get the distance where they reach CutoffIntensity
+    float Color[3];                                 // linear 0-1
+    float Intensity;
+    float Direction[3];                             // world space direction the light points in, spot and directional only
+    float CosOuter;                                 // cosine of MaxCone, spot only
+    float CosInner;                                 // cosine of MinCone, spot only
+    float Type;                                     // LightSceneObject::LightTypes as a float
+    float Padding[2];
+};
+
+struct LightClusterGrid
+{
+    LightClusterSettings Settings;
+
+    std::vector<ClusterLight> Lights;               // directional lights first, then every light in the grid
+    int DirectionalCount = 0;
+
+    std::vector<uint32_t> ClusterRanges;            // offset into LightIndices and count per cluster, x fastest, then y, then slice
+    std::vector<uint32_t> LightIndices;             // indices into Lights
+
+    // slice = log(viewDepth) * SliceScale - SliceBias
+    float SliceScale = 0;
+    float SliceBias = 0;
+};
+
+// rebuilds the cluster lists for a camera, aspect is the width of the render target divided by its height
+// lights are assumed to point down their local -Z axis like glTF lights do
+void BuildLightClusters(LightClusterGrid& grid, const std::vector<LightSceneObject*>& lights, const Camera3D& camera, float aspect);
+
+// the grid as float textures so GL 3.3 shaders can read it with texelFetch
+//  Lights:   4 x light count RGBA32F, one row per light
+//  Clusters: TilesX * TilesY x Slices RGBA32F, offset and count in r and g
+//  Indices:  LightClusterIndexTextureWidth wide R32F, light index n is at (n % width, n / width)
+constexpr int LightClusterIndexTextureWidth = 1024;
+
+struct LightClusterTextures
+{
+    Texture Lights = { 0 };
+    Texture Clusters = { 0 };
+    Texture Indices = { 0 };
+};
+
+// creates or updates the textures, requires a GL context
+void UpdateLightClusterTextures(const LightClusterGrid& grid, LightClusterTextures& textures);
+void UnloadLightClusterTextures(LightClusterTextures& textures);
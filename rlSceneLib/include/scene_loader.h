@@ -1,13 +1,204 @@
 #pragma once
 
 #include "scene.h"
+#include "scene_atlas.h"
 
+#include <string>
 #include <string_view>
 #include <functional>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// set to 0 to compile out the load timers and statistics
+#ifndef SCENE_LOAD_STATS
+#define SCENE_LOAD_STATS 1
+#endif
 
 using ResolveTextureCallback = std::function < Image(std::string_view scenePath, std::string_view imageURL, size_t& hash)>;
 
+enum class LoadPhase
+{
+    Parse,                                          // reading the file and parsing the glTF json
+    BufferLoad,                                     // loading the binary buffers
+    Decompress,                                     // decoding EXT_meshopt_compression buffer views
+    Hash,                                           // hashing primitives for the mesh cache
+    Convert,                                        // converting attributes into meshes
+    Bounds,                                         // computing mesh bounds
+    Material,                                       // materials and textures
+    Tangents,                                       // generating missing tangents
+    Transform,                                      // node transforms
+    Count
+};
+
+// what a single load did and what it cost, all zero when SCENE_LOAD_STATS is 0
+struct LoadStats
+{
+    double TotalSeconds = 0;
+    double PhaseSeconds[size_t(LoadPhase::Count)] = { 0 };
+
+    size_t BytesRead = 0;                           // glTF file and external buffers
+
+    size_t PrimitiveCount = 0;                      // primitives seen in the file
+    size_t UniqueMeshes = 0;                        // primitives converted into new cached meshes
+    size_t MeshCacheHits = 0;                       // primitives that reused a mesh from the cache
+
+    size_t TextureCacheHits = 0;
+    size_t TextureCacheMisses = 0;
+
+    size_t GeneratedTangents = 0;                   // meshes that had no TANGENT attribute and got generated tangents
+
+    size_t SkippedNodes = 0;                        // nodes left out by the LoadOptions filters, children included
+
+    size_t AllocationCount = 0;                     // parser and mesh data allocations
+    size_t AllocatedBytes = 0;
+
+    size_t MeshDataBytes = 0;                       // CPU mesh data held by the scene after the load
+    size_t PeakResidentBytes = 0;                   // peak of source buffers plus mesh data during the load
+};
+
+// mesh attributes converted by the loader, positions and indices are always loaded
+enum MeshAttributeFlags : uint32_t
+{
+    MeshAttributeNormals = 1 << 0,
+    MeshAttributeTexcoords = 1 << 1,
+    MeshAttributeTexcoords2 = 1 << 2,
+    MeshAttributeTangents = 1 << 3,                 // read or generated, see TangentGeneration
+    MeshAttributeColors = 1 << 4,
+
+    MeshAttributePositionsOnly = 0,
+    MeshAttributeAll = 0xFFFFFFFF
+};
+
+enum class TextureLoadMode
+{
+    Load,                                           // decode every base color texture
+    Skip,                                           // materials keep their colors but get no texture
+    Placeholder                                     // every textured material shares one small checker texture
+};
+
+// which meshes without a TANGENT attribute get generated tangents, they need normals and texcoords
+// the tangents are generated after the file is converted, spread over the unique meshes on worker threads
+enum class TangentGeneration
+{
+    None,
+    NormalMapped,                                   // meshes used by a material with a normal texture
+    All                                             // every mesh, for tools that bake the tangents into their output
+};
+
+// what a load reads from the file, the defaults load everything
+// collision extraction or a dedicated server can skip most of a level, skipped data is never converted or allocated
+struct LoadOptions
+{
+    uint32_t Attributes = MeshAttributeAll;         // MeshAttributeFlags
+    TextureLoadMode Textures = TextureLoadMode::Load;
+    TangentGeneration Tangents = TangentGeneration::NormalMapped;
+
+    std::vector<std::string> SkipNamePrefixes;      // nodes whose name starts with one of these are skipped with their children
+    std::function<bool(std::string_view name)> NodeFilter;  // return false to skip a node and its children
+
+    int MaxDepth = -1;                              // deepest node level loaded, 0 loads only the roots, -1 loads all
+
+    // packs small base color textures into atlases once the file is loaded, see AtlasSceneTextures
+    // the images are decoded headless for that and uploaded afterwards when the load is not headless
+    bool AtlasTextures = false;
+    TextureAtlasSettings Atlas;
+};
+
+// called once per phase at the end of every load with the total time spent in that phase
+using LoadPhaseCallback = std::function<void(LoadPhase phase, double seconds)>;
+
 
 void SetTextureResolver(ResolveTextureCallback resolver);
 
-bool LoadSceneFromGLTF(std::string_view filename, Scene& outScene);
\ No newline at end of file
+// sets how the CPU data of meshes loaded after this call is allocated
+void SetMeshStorageLayout(MeshStorageLayout layout);
+
+// when enabled the loader never touches the GPU, textures stay in Scene::ImageCache and meshes stay on the CPU
+// until UploadScene is called, so scenes can be loaded before a window exists or without one at all
+void SetHeadlessLoading(bool headless);
+bool IsHeadlessLoading();
+
+// sets which parts of a file loads after this call read
+void SetLoadOptions(const LoadOptions& options);
+
+// sets a callback that receives per phase timings, phases are only timed when a callback is set or stats are requested
+void SetLoadPhaseCallback(LoadPhaseCallback callback);
+
+const char* GetLoadPhaseName(LoadPhase phase);
+
+// stats are optional, they are reset and filled in when provided
+// uses the options set with the functions above, a SceneLoader can be used instead to load with other options
+bool LoadSceneFromGLTF(std::string_view filename, Scene& outScene, LoadStats* stats = nullptr);
+
+struct SceneLoaderOptions
+{
+    MeshStorageLayout StorageLayout = MeshStorageLayout::Separate;
+    bool Headless = false;                          // see SetHeadlessLoading
+    ResolveTextureCallback TextureResolver;         // loads images the file references by uri
+    LoadPhaseCallback PhaseCallback;                // called from the loading thread, so from worker threads in LoadScenes
+    LoadOptions Content;                            // attributes, textures and nodes to load
+    bool CacheImages = true;                        // keep decoded images so files that embed the same image decode it once
+    int ThreadCount = 0;                            // files loaded at the same time by LoadScenes, or tangent workers of a single load, 0 uses all cores
+};
+
+// decoded images keyed by a hash of their encoded data, safe to use from several loads at once
+class SharedImageCache
+{
+public:
+    ~SharedImageCache() { Clear(); }
+
+    // fills image with a copy of the cached image, the copy belongs to the caller
+    bool Find(size_t hash, Image& image);
+
+    // keeps a copy of image, when another load added the same hash first nothing changes
+    void Add(size_t hash, const Image& image);
+
+    void Clear();
+    size_t GetCount() const;
+
+private:
+    mutable std::mutex Mutex;
+    std::unordered_map<size_t, Image> Images;
+};
+
+// one file of a LoadScenes batch
+struct SceneLoadRequest
+{
+    std::string FileName;
+    Scene* OutScene = nullptr;
+    LoadStats* Stats = nullptr;                     // optional
+    bool Loaded = false;                            // set by LoadScenes
+};
+
+// a loader with its own options and caches, separate loaders and the loads of one loader can run on any thread at the same time
+// the options must not change while a load is running
+class SceneLoader
+{
+public:
+    SceneLoader() = default;
+    SceneLoader(const SceneLoaderOptions& options) : Options(options) {}
+
+    SceneLoader(const SceneLoader&) = delete;
+    SceneLoader& operator=(const SceneLoader&) = delete;
+
+    SceneLoaderOptions Options;
+
+    bool Load(std::string_view filename, Scene& outScene, LoadStats* stats = nullptr);
+
+    // loads every request on a pool of worker threads, files that share images decode them once
+    // workers load headless, without the Headless option the scenes are uploaded on the calling thread once all are loaded
+    // returns the number of files that loaded
+    size_t LoadScenes(std::vector<SceneLoadRequest>& requests);
+
+    SharedImageCache& GetImageCache() { return Images; }
+
+    // frees the cached images, scenes that were loaded keep their own copies
+    void ClearCache() { Images.Clear(); }
+
+private:
+    bool LoadFile(std::string_view filename, Scene& outScene, LoadStats* stats, bool headless, size_t threadCount);
+
+    SharedImageCache Images;
+};
\ No newline at end of file
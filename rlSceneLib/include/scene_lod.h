@@ -0,0 +1,28 @@
+#pragma once
+
+#include "scene.h"
+
+struct LODSettings
+{
+    std::vector<float> TargetRatios = { 0.5f, 0.25f, 0.125f };  // fraction of the source triangles to keep, one entry per LOD
+    std::vector<float> ScreenErrors;                            // optional pixel error threshold per LOD, defaults to PixelError
+    float MaxError = 0.05f;                                     // largest allowed error relative to the mesh extents
+    float PixelError = 1.0f;                                    // projected error in pixels that is considered invisible
+    size_t MinTriangles = 64;                                   // meshes with fewer triangles do not get LODs
+    bool LockSeams = true;                                      // keep normal/uv seams intact, otherwise seams collapse to the nearest attributes
+};
+
+// generates a chain of simplified meshes using quadric error edge collapse
+// the source mesh must still have CPU side vertex data
+std::vector<MeshLOD> GenerateMeshLODs(const Mesh& mesh, const LODSettings& settings);
+
+// generates LOD chains for every entry in the scene mesh cache that does not have one
+// call this after loading and before the mesh data is uploaded and freed
+void GenerateSceneLODs(Scene& scene, const LODSettings& settings = LODSettings());
+
+// picks the LOD index from a chain, 0 is the full resolution mesh and N is lods[N-1]
+// distance and worldScale are in world units, pixelsPerUnit is the projected size of one unit at distance 1
+int SelectLODIndex(const std::vector<MeshLOD>& lods, float distance, float worldScale, float pixelsPerUnit);
+
+// returns the mesh that should be drawn for a mesh instance of a node from the camera point of view
+const Mesh& SelectMeshLOD(const Scene& scene, const MeshSceneObject& node, size_t meshIndex, const Camera3D& camera, float screenHeight);
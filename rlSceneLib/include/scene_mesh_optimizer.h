@@ -0,0 +1,39 @@
+#pragma once
+
+#include "scene.h"
+
+// post transform vertex cache efficiency of an index buffer
+struct VertexCacheStats
+{
+    size_t TriangleCount = 0;
+    size_t VertexCount = 0;                         // unique vertices referenced by the index buffer
+    size_t TransformedVertices = 0;                 // simulated cache misses
+    float ACMR = 0;                                 // average cache miss ratio, transformed vertices per triangle (0.5 - 3.0)
+    float ATVR = 0;                                 // average transformed vertex ratio, transformed vertices per vertex (1.0 is optimal)
+};
+
+struct MeshOptimizeSettings
+{
+    bool OptimizeVertexCache = true;                // reorder triangles for post transform cache hits (Tipsify)
+    bool OptimizeOverdraw = true;                   // reorder triangle clusters so outward facing geometry draws first
+    bool OptimizeVertexFetch = true;                // reorder vertices in first use order
+    unsigned int CacheSize = 16;                    // simulated FIFO cache size
+    float OverdrawThreshold = 1.05f;                // how much ACMR the overdraw pass may give up
+};
+
+struct MeshOptimizeStats
+{
+    size_t MeshCount = 0;
+    VertexCacheStats Before;
+    VertexCacheStats After;
+};
+
+// simulates a FIFO post transform cache over the mesh indices, all on the CPU
+VertexCacheStats AnalyzeVertexCache(const Mesh& mesh, unsigned int cacheSize = 16);
+
+// optimizes an indexed mesh in place, non indexed meshes are left untouched
+// the mesh must still have CPU side data
+void OptimizeMesh(Mesh& mesh, const MeshOptimizeSettings& settings = MeshOptimizeSettings(), MeshOptimizeStats* stats = nullptr);
+
+// optimizes every unique mesh and LOD in the scene caches, stats are accumulated over all meshes
+void OptimizeSceneMeshes(Scene& scene, const MeshOptimizeSettings& settings = MeshOptimizeSettings(), MeshOptimizeStats* stats = nullptr);
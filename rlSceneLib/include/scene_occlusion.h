@@ -0,0 +1,77 @@
+#pragma once
+
+#include "scene.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Software occlusion culling
+// a few large occluders are rasterized into a small CPU depth buffer, then the world bounds of every mesh node are tested
+// against a depth pyramid built from it, everything runs on the CPU so it works headless
+
+struct OcclusionSettings
+{
+    int Width = 256;                                // depth buffer size, small is fine since only large occluders are drawn
+    int Height = 144;
+    int MaxOccluders = 64;                          // occluders drawn per frame, the ones that look largest from the camera first
+    float MinOccluderSize = 2.0f;                   // smallest bounds diagonal in world units for an auto selected occluder
+    int MaxOccluderTriangles = 2048;                // meshes with more triangles use their finest LOD under this, or are skipped
+    int ThreadCount = 0;                            // 0 uses all cores
+};
+
+// triangles of an occluder in mesh space
+struct OccluderMesh
+{
+    std::vector<Vector3> Vertices;
+    std::vector<uint32_t> Indices;
+    BoundingBox Bounds = { 0 };
+};
+
+struct Occluder
+{
+    const MeshSceneObject* Node = nullptr;          // the occluder is drawn with this node's world matrix
+    std::shared_ptr<OccluderMesh> Geometry;
+};
+
+struct OcclusionStats
+{
+    size_t OccludersDrawn = 0;
+    size_t OccluderTriangles = 0;                   // triangles that reached the rasterizer
+    size_t Tested = 0;                              // nodes in the frustum
+    size_t FrustumCulled = 0;
+    size_t OcclusionCulled = 0;
+};
+
+struct OcclusionCuller
+{
+    OcclusionSettings Settings;
+    std::vector<Occluder> Occluders;
+
+    // Pyramid[0] is the depth buffer, every next level keeps the farthest value of a 2x2 block
+    // depth is flipped so larger values are closer, 1 at the near plane and 0 where nothing was drawn
+    std::vector<std::vector<float>> Pyramid;
+    std::vector<int> PyramidWidths;
+    std::vector<int> PyramidHeights;
+
+    Matrix ViewProjection = { 0 };
+
+    OcclusionStats Stats;
+};
+
+// makes every large mesh node an occluder and copies its triangles, meshes need CPU vertex data, so call this before UnloadSceneMeshData
+// occluders added with AddOccluder are kept
+void SelectOccluders(OcclusionCuller& culler, const Scene& scene);
+
+// uses a simplified mesh as the occluder for a node, the mesh must not be larger than the node's visible surface
+void AddOccluder(OcclusionCuller& culler, const MeshSceneObject& node, const Mesh& occluderMesh);
+
+// clears the depth buffer, draws the occluders that cover the most of the view and builds the depth pyramid
+// aspect is the width divided by the height
+void RenderOccluders(OcclusionCuller& culler, const Camera3D& camera, float aspect);
+
+// tests a world space box against the last rendered depth, returns false when the box is hidden
+bool IsBoxVisible(const OcclusionCuller& culler, const BoundingBox& worldBounds);
+
+// frustum and occlusion tests every mesh node of the scene and fills visible with the ones that have to be drawn
+void CullSceneMeshes(OcclusionCuller& culler, const Scene& scene, std::vector<MeshSceneObject*>& visible);
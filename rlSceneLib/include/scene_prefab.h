@@ -0,0 +1,56 @@
+#pragma once
+
+#include "scene.h"
+
+#include <string_view>
+#include <vector>
+
+// Prefabs
+// a prefab is a flattened copy of a node tree that belongs to one scene
+// instantiating it only creates nodes, meshes, textures and materials are shared with the scene caches so nothing is loaded or copied per instance
+
+struct PrefabNode
+{
+    SceneObjectType Type = SceneObjectType::GenericObject;
+    int Parent = -1;                                // index of the parent in Prefab::Nodes, -1 for the root
+    int ChildCount = 0;
+    std::string_view Name;                          // interned in the scene strings
+    std::string_view Path;                          // path below the prefab root, interned in the scene strings
+    PQSTransform Transform;
+    Matrix LocalMatrix = MatrixIdentity();          // relative to the parent, taken from the world matrices so matrix nodes work too
+
+    // mesh nodes
+    BoundingBox Bounds = { 0 };
+    BoundingSphere Sphere;
+    size_t FirstMesh = 0;                           // range in Scene::PrefabMeshes
+    size_t MeshCount = 0;
+
+    // light nodes
+    Color EmissiveColor = WHITE;
+    float Intensity = 1.0f;
+    float Range = 100.0f;
+    float MinCone = 0;
+    float MaxCone = 0;
+    LightSceneObject::LightTypes LightType = LightSceneObject::LightTypes::Point;
+
+    // camera nodes
+    float FOV = 45.0f;
+};
+
+struct Prefab
+{
+    Scene* Owner = nullptr;                         // scene whose caches the prefab uses, instances are added to it
+    std::vector<PrefabNode> Nodes;                  // parents come before their children, Nodes[0] is the root
+};
+
+// loads a glTF file as a prefab of scene, the meshes and textures go into the scene caches and are shared with what is already there
+// no nodes are added to the scene, files with several root nodes get a generic root named after the file
+bool LoadPrefabFromGLTF(std::string_view filename, Scene& scene, Prefab& outPrefab);
+
+// makes a prefab of a node of scene and its children, the node stays in the scene
+void CreatePrefab(Scene& scene, const SceneObject& root, Prefab& outPrefab);
+
+// adds a copy of the prefab to its scene under parent (nullptr for a root node), transform replaces the transform of the prefab root
+// the nodes are indexed by name and path and added to the mesh, light and camera lists, remove them with DestroySceneObject
+// prefabs become invalid when their scene is unloaded
+SceneObject* Instantiate(const Prefab& prefab, SceneObject* parent, const PQSTransform& transform);
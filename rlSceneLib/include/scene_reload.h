@@ -0,0 +1,50 @@
+#pragma once
+
+#include "scene.h"
+
+#include <string>
+#include <string_view>
+
+// Hot reload
+// reparses a glTF file and applies only what changed to a scene that was loaded from it
+// meshes are matched by content hash and textures by their cache key, so unchanged ones are neither converted, decoded nor uploaded again
+// nodes are matched by path, matched nodes are updated in place, new nodes are added and missing nodes are destroyed
+
+struct ReloadStats
+{
+    size_t NodesAdded = 0;
+    size_t NodesRemoved = 0;
+    size_t NodesUpdated = 0;                        // transform, meshes, material or light/camera settings changed
+
+    size_t MeshesAdded = 0;
+    size_t MeshesRemoved = 0;
+    size_t TexturesAdded = 0;
+    size_t TexturesRemoved = 0;
+};
+
+// the scene should only hold what was loaded from filename, other nodes have no match in the file and are destroyed
+// textures are keyed by their encoded data or by path and modification time, so edited images are reloaded even when they keep their name
+// shaders assigned to changed mesh instances are kept, added nodes get the material from the file
+// with headless loading new meshes and textures need an UploadScene call afterwards, like after a normal load
+bool ReloadSceneFromGLTF(std::string_view filename, Scene& scene, ReloadStats* stats = nullptr);
+
+// polls the modification time of a scene file and reloads the scene when it changed
+// a change is only applied once the time was stable for one poll, so files that are still being written are not read
+class SceneFileWatcher
+{
+public:
+    void Watch(std::string_view filename, Scene& scene, double pollInterval = 0.5);
+    void Stop();
+
+    // call once per frame, returns true when the scene was reloaded
+    bool Update(ReloadStats* stats = nullptr);
+
+private:
+    std::string FileName;
+    Scene* WatchedScene = nullptr;
+
+    double PollInterval = 0.5;
+    double NextPoll = 0;
+    long LoadedModTime = 0;
+    long PendingModTime = 0;
+};
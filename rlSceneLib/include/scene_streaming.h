@@ -0,0 +1,110 @@
+#pragma once
+
+#include "scene.h"
+#include "scene_exporter.h"
+#include "scene_loader.h"
+
+#include <future>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Spatial streaming
+// a large scene is split offline into a grid of cells on the XZ plane, every cell is its own .glb
+// at runtime a SceneStreamer loads the cells around a focus point on worker threads and evicts them again
+// meshes and textures shared between cells are reference counted so they are only resident once
+
+// splits a loaded scene into grid cells and writes them plus a cells.txt manifest into folder
+// nodes are assigned by the center of their world bounds and written flattened with their world transform
+// the scene needs CPU mesh data, load it headless
+bool PartitionSceneToCells(const Scene& scene, std::string_view folder, float cellSize, const SceneExportSettings& exportSettings = SceneExportSettings());
+
+struct StreamingSettings
+{
+    float LoadRadius = 100.0f;                      // cells closer than this to the focus are loaded
+    float UnloadRadius = 125.0f;                    // loaded cells are kept until they are this far away
+    size_t MemoryBudget = 256 * 1024 * 1024;        // ceiling for mesh and texture data of resident cells in bytes
+    int MaxLoadsInFlight = 2;                       // cells loading on worker threads at the same time
+    int MaxCellsPerUpdate = 2;                      // loaded cells uploaded per Update call
+};
+
+enum class CellState
+{
+    Unloaded,
+    Loading,
+    Loaded
+};
+
+struct StreamingCell
+{
+    int X = 0;
+    int Z = 0;
+    BoundingBox Bounds = { 0 };
+    size_t EstimatedBytes = 0;                      // from the manifest, used to plan loads against the budget
+    std::string FileName;
+
+    CellState State = CellState::Unloaded;
+    std::unique_ptr<Scene> CellScene;               // set while loaded, its meshes and textures belong to the streamer
+    std::future<std::unique_ptr<Scene>> PendingLoad;
+
+    std::vector<size_t> MeshHashes;                 // shared meshes referenced by the loaded cell
+    std::vector<size_t> TextureHashes;              // shared textures referenced by the loaded cell
+};
+
+class SceneStreamer
+{
+public:
+    SceneStreamer() = default;
+    ~SceneStreamer();
+
+    SceneStreamer(const SceneStreamer&) = delete;
+    SceneStreamer& operator=(const SceneStreamer&) = delete;
+
+    // reads a manifest written by PartitionSceneToCells, no cells are loaded yet
+    bool Open(std::string_view manifestFile, const StreamingSettings& settings = StreamingSettings());
+
+    // waits for pending loads and unloads every cell
+    void Close();
+
+    // call once per frame on the thread that owns the GL context
+    // finishes cells that are done loading, evicts cells that are too far or over budget and starts new loads
+    void Update(Vector3 focus);
+
+    const std::vector<StreamingCell>& GetCells() const { return Cells; }
+
+    // scenes of all loaded cells, ready to draw
+    std::vector<const Scene*> GetLoadedScenes() const;
+
+    // mesh and texture bytes of the shared caches
+    size_t GetResidentBytes() const { return ResidentBytes; }
+
+private:
+    struct SharedMesh
+    {
+        std::shared_ptr<Mesh> MeshData;
+        MeshBlock Block;
+        size_t Bytes = 0;
+        int RefCount = 0;
+    };
+
+    struct SharedTexture
+    {
+        Texture TextureData = { 0 };
+        size_t Bytes = 0;
+        int RefCount = 0;
+    };
+
+    void FinishLoad(StreamingCell& cell);
+    void EvictCell(StreamingCell& cell);
+    void ReleaseMesh(size_t hash);
+    void ReleaseTexture(size_t hash);
+
+    StreamingSettings Settings;
+    SceneLoader Loader;                             // headless, cells load on worker threads
+    std::string Folder;
+    std::vector<StreamingCell> Cells;
+
+    std::unordered_map<size_t, SharedMesh> Meshes;
+    std::unordered_map<size_t, SharedTexture> Textures;
+    size_t ResidentBytes = 0;
+};
@@ -0,0 +1,258 @@
+#include "mesh_utils.h"
+
+#include "raymath.h"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+
+std::vector<uint32_t> GetMeshIndices(const Mesh& mesh)
+{
+    std::vector<uint32_t> indices;
+
+    if (mesh.indices)
+    {
+        indices.resize(size_t(mesh.triangleCount) * 3);
+        for (size_t i = 0; i < indices.size(); i++)
+            indices[i] = mesh.indices[i];
+    }
+    else
+    {
+        indices.resize(size_t(mesh.vertexCount / 3) * 3);
+        for (size_t i = 0; i < indices.size(); i++)
+            indices[i] = uint32_t(i);
+    }
+
+    return indices;
+}
+
+namespace
+{
+    struct VertexStream
+    {
+        const unsigned char* Data = nullptr;
+        size_t Stride = 0;
+    };
+
+    struct VertexStreams
+    {
+        VertexStream Streams[6];
+        size_t Count = 0;
+
+        VertexStreams(const Mesh& mesh, bool positionsOnly)
+        {
+            Add(mesh.vertices, sizeof(float) * 3);
+            if (positionsOnly)
+                return;
+
+            Add(mesh.normals, sizeof(float) * 3);
+            Add(mesh.texcoords, sizeof(float) * 2);
+            Add(mesh.texcoords2, sizeof(float) * 2);
+            Add(mesh.tangents, sizeof(float) * 4);
+            Add(mesh.colors, 4);
+        }
+
+        void Add(const void* data, size_t stride)
+        {
+            if (data)
+                Streams[Count++] = VertexStream{ (const unsigned char*)data, stride };
+        }
+    };
+
+    struct VertexHasher
+    {
+        const VertexStreams* Streams;
+
+        size_t operator()(uint32_t vertex) const
+        {
+            size_t hash = 2166136261U; // FNV_offset_basis
+            for (size_t s = 0; s < Streams->Count; s++)
+            {
+                const unsigned char* data = Streams->Streams[s].Data + vertex * Streams->Streams[s].Stride;
+                for (size_t b = 0; b < Streams->Streams[s].Stride; b++)
+                {
+                    hash ^= data[b];
+                    hash *= 16777619U; // FNV_prime
+                }
+            }
+            return hash;
+        }
+    };
+
+    struct VertexEqual
+    {
+        const VertexStreams* Streams;
+
+        bool operator()(uint32_t lhs, uint32_t rhs) const
+        {
+            for (size_t s = 0; s < Streams->Count; s++)
+            {
+                size_t stride = Streams->Streams[s].Stride;
+                if (memcmp(Streams->Streams[s].Data + lhs * stride, Streams->Streams[s].Data + rhs * stride, stride) != 0)
+                    return false;
+            }
+            return true;
+        }
+    };
+}
+
+std::vector<uint32_t> GenerateVertexRemap(const Mesh& mesh, bool positionsOnly, size_t& uniqueCount)
+{
+    VertexStreams streams(mesh, positionsOnly);
+
+    std::unordered_map<uint32_t, uint32_t, VertexHasher, VertexEqual> firstVertex(size_t(mesh.vertexCount), VertexHasher{ &streams }, VertexEqual{ &streams });
+
+    std::vector<uint32_t> remap(size_t(mesh.vertexCount));
+    uniqueCount = 0;
+
+    for (uint32_t v = 0; v < uint32_t(mesh.vertexCount); v++)
+    {
+        auto [itr, inserted] = firstVertex.try_emplace(v, v);
+        remap[v] = itr->second;
+        if (inserted)
+            uniqueCount++;
+    }
+
+    return remap;
+}
+
+template<class T>
+static T* CopyVertexAttribute(const T* source, int components, const std::vector<uint32_t>& vertices)
+{
+    if (!source)
+        return nullptr;
+
+    T* dest = (T*)MemAlloc((unsigned int)(vertices.size() * components * sizeof(T)));
+    for (size_t v = 0; v < vertices.size(); v++)
+        memcpy(dest + v * components, source + size_t(vertices[v]) * components, components * sizeof(T));
+
+    return dest;
+}
+
+std::shared_ptr<Mesh> BuildMeshFromIndices(const Mesh& source, const std::vector<uint32_t>& indices)
+{
+    std::vector<uint32_t> newIndex(size_t(source.vertexCount), UINT32_MAX);
+    std::vector<uint32_t> usedVertices;
+
+    for (uint32_t index : indices)
+    {
+        if (newIndex[index] == UINT32_MAX)
+        {
+            newIndex[index] = uint32_t(usedVertices.size());
+            usedVertices.push_back(index);
+        }
+    }
+
+    if (usedVertices.size() > std::numeric_limits<unsigned short>::max())
+    {
+        TraceLog(LOG_WARNING, "MESH: %zu vertices do not fit 16 bit indices, mesh not built", usedVertices.size());
+        return nullptr;
+    }
+
+    std::shared_ptr<Mesh> newMesh = std::make_shared<Mesh>();
+    memset(newMesh.get(), 0, sizeof(Mesh));
+
+    newMesh->vertexCount = int(usedVertices.size());
+    newMesh->triangleCount = int(indices.size() / 3);
+
+    newMesh->vertices = CopyVertexAttribute(source.vertices, 3, usedVertices);
+    newMesh->normals = CopyVertexAttribute(source.normals, 3, usedVertices);
+    newMesh->texcoords = CopyVertexAttribute(source.texcoords, 2, usedVertices);
+    newMesh->texcoords2 = CopyVertexAttribute(source.texcoords2, 2, usedVertices);
+    newMesh->tangents = CopyVertexAttribute(source.tangents, 4, usedVertices);
+    newMesh->colors = CopyVertexAttribute(source.colors, 4, usedVertices);
+
+    newMesh->indices = (unsigned short*)MemAlloc((unsigned int)(indices.size() * sizeof(unsigned short)));
+    for (size_t i = 0; i < indices.size(); i++)
+        newMesh->indices[i] = (unsigned short)newIndex[indices[i]];
+
+    return newMesh;
+}
+
+void GenerateMeshTangents(Mesh& mesh)
+{
+    if (!mesh.tangents || !mesh.vertices || !mesh.normals || !mesh.texcoords)
+        return;
+
+    // split vertices of the same corner share their tangent, other attributes do not keep them apart
+    Mesh weldMesh = { 0 };
+    weldMesh.vertexCount = mesh.vertexCount;
+    weldMesh.vertices = mesh.vertices;
+    weldMesh.normals = mesh.normals;
+    weldMesh.texcoords = mesh.texcoords;
+
+    size_t uniqueCount = 0;
+    std::vector<uint32_t> weld = GenerateVertexRemap(weldMesh, false, uniqueCount);
+
+    std::vector<Vector3> tangents(size_t(mesh.vertexCount), Vector3Zeros);
+    std::vector<Vector3> bitangents(size_t(mesh.vertexCount), Vector3Zeros);
+
+    auto position = [&](uint32_t v) { return Vector3{ mesh.vertices[v * 3 + 0], mesh.vertices[v * 3 + 1], mesh.vertices[v * 3 + 2] }; };
+    auto normal = [&](uint32_t v) { return Vector3{ mesh.normals[v * 3 + 0], mesh.normals[v * 3 + 1], mesh.normals[v * 3 + 2] }; };
+    auto texcoord = [&](uint32_t v) { return Vector2{ mesh.texcoords[v * 2 + 0], mesh.texcoords[v * 2 + 1] }; };
+
+    std::vector<uint32_t> indices = GetMeshIndices(mesh);
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        uint32_t corners[3] = { indices[i], indices[i + 1], indices[i + 2] };
+        Vector3 positions[3] = { position(corners[0]), position(corners[1]), position(corners[2]) };
+
+        Vector3 edge1 = Vector3Subtract(positions[1], positions[0]);
+        Vector3 edge2 = Vector3Subtract(positions[2], positions[0]);
+        Vector2 uv0 = texcoord(corners[0]);
+        Vector2 delta1 = Vector2{ texcoord(corners[1]).x - uv0.x, texcoord(corners[1]).y - uv0.y };
+        Vector2 delta2 = Vector2{ texcoord(corners[2]).x - uv0.x, texcoord(corners[2]).y - uv0.y };
+
+        // triangles without texture space direction add nothing
+        float determinant = delta1.x * delta2.y - delta2.x * delta1.y;
+        if (fabsf(determinant) < 1e-20f)
+            continue;
+
+        float scale = 1.0f / determinant;
+        Vector3 faceTangent = Vector3Normalize(Vector3Scale(Vector3Subtract(Vector3Scale(edge1, delta2.y), Vector3Scale(edge2, delta1.y)), scale));
+        Vector3 faceBitangent = Vector3Normalize(Vector3Scale(Vector3Subtract(Vector3Scale(edge2, delta1.x), Vector3Scale(edge1, delta2.x)), scale));
+
+        for (int c = 0; c < 3; c++)
+        {
+            uint32_t vertex = weld[corners[c]];
+
+            float angle = Vector3Angle(Vector3Subtract(positions[(c + 1) % 3], positions[c]), Vector3Subtract(positions[(c + 2) % 3], positions[c]));
+
+            // the face tangent is projected into the plane of the vertex normal before it is added
+            Vector3 vertexNormal = normal(vertex);
+            Vector3 tangent = Vector3Normalize(Vector3Subtract(faceTangent, Vector3Scale(vertexNormal, Vector3DotProduct(vertexNormal, faceTangent))));
+
+            tangents[vertex] = Vector3Add(tangents[vertex], Vector3Scale(tangent, angle));
+            bitangents[vertex] = Vector3Add(bitangents[vertex], Vector3Scale(faceBitangent, angle));
+        }
+    }
+
+    for (uint32_t v = 0; v < uint32_t(mesh.vertexCount); v++)
+    {
+        uint32_t vertex = weld[v];
+        Vector3 vertexNormal = normal(v);
+
+        Vector3 tangent = Vector3Subtract(tangents[vertex], Vector3Scale(vertexNormal, Vector3DotProduct(vertexNormal, tangents[vertex])));
+        if (Vector3LengthSqr(tangent) < 1e-12f)
+            tangent = Vector3Perpendicular(vertexNormal);
+        tangent = Vector3Normalize(tangent);
+
+        // glTF rebuilds the bitangent as cross(normal, tangent) * w
+        float handedness = Vector3DotProduct(Vector3CrossProduct(vertexNormal, tangent), bitangents[vertex]) < 0 ? -1.0f : 1.0f;
+
+        mesh.tangents[v * 4 + 0] = tangent.x;
+        mesh.tangents[v * 4 + 1] = tangent.y;
+        mesh.tangents[v * 4 + 2] = tangent.z;
+        mesh.tangents[v * 4 + 3] = handedness;
+    }
+}
+
+float GetMeshExtent(const Mesh& mesh)
+{
+    if (!mesh.vertices || mesh.vertexCount == 0)
+        return 0;
+
+    BoundingBox bounds = GetMeshBoundingBox(mesh);
+    return fmaxf(bounds.max.x - bounds.min.x, fmaxf(bounds.max.y - bounds.min.y, bounds.max.z - bounds.min.z));
+}
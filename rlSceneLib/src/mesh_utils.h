@@ -0,0 +1,32 @@
+#pragma once
+
+#include "raylib.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Internal helpers shared by the mesh processing passes
+
+// raylib keeps this in config.h, LoadMaterialDefault allocates and UnloadMaterial frees this many maps
+#ifndef MAX_MATERIAL_MAPS
+#define MAX_MATERIAL_MAPS 12
+#endif
+
+// returns the triangle list of a mesh as 32 bit indices, non indexed meshes get a sequential list
+std::vector<uint32_t> GetMeshIndices(const Mesh& mesh);
+
+// builds a remap table that maps each vertex to the first vertex with identical data
+// when positionsOnly is set only the positions are compared, otherwise all attributes are
+std::vector<uint32_t> GenerateVertexRemap(const Mesh& mesh, bool positionsOnly, size_t& uniqueCount);
+
+// creates a new mesh that contains only the vertices referenced by indices, in first use order
+// returns nullptr when more than 65535 vertices are referenced, raylib meshes only have 16 bit indices
+std::shared_ptr<Mesh> BuildMeshFromIndices(const Mesh& source, const std::vector<uint32_t>& indices);
+
+// fills mesh.tangents, which must already be allocated, from the normals and texcoords following MikkTSpace
+// face tangents are weighted by the corner angle and vertices with the same position, normal and texcoord are welded
+void GenerateMeshTangents(Mesh& mesh);
+
+// returns the length of the largest side of the mesh bounding box
+float GetMeshExtent(const Mesh& mesh);
@@ -0,0 +1,482 @@
+#include "meshopt_decoder.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace
+{
+    constexpr unsigned char VertexHeader = 0xa0;
+    constexpr unsigned char IndexHeader = 0xe0;
+    constexpr unsigned char SequenceHeader = 0xd0;
+
+    constexpr size_t VertexBlockSizeBytes = 8192;
+    constexpr size_t VertexBlockMaxSize = 256;
+    constexpr size_t ByteGroupSize = 16;
+    constexpr size_t ByteGroupDecodeLimit = 24;
+    constexpr size_t TailMaxSize = 32;
+
+    size_t GetVertexBlockSize(size_t stride)
+    {
+        size_t result = VertexBlockSizeBytes / stride;
+        result &= ~(ByteGroupSize - 1);
+        return result < VertexBlockMaxSize ? result : VertexBlockMaxSize;
+    }
+
+    unsigned char Unzigzag8(unsigned char v)
+    {
+        return (unsigned char)(-(v & 1) ^ (v >> 1));
+    }
+
+    // a group of 16 bytes stored with 0, 2, 4 or 8 bits each, values that do not fit follow the packed bits
+    const unsigned char* DecodeBytesGroup(const unsigned char* data, unsigned char* buffer, int bitsLog2)
+    {
+        switch (bitsLog2)
+        {
+        case 0:
+            memset(buffer, 0, ByteGroupSize);
+            return data;
+
+        case 3:
+            memcpy(buffer, data, ByteGroupSize);
+            return data + ByteGroupSize;
+
+        default:
+        {
+            int bits = 1 << bitsLog2;
+            int perByte = 8 / bits;
+            unsigned char escape = (unsigned char)((1 << bits) - 1);
+
+            const unsigned char* extra = data + ByteGroupSize / perByte;
+            for (size_t i = 0; i < ByteGroupSize; i++)
+            {
+                unsigned char packed = data[i / perByte];
+                unsigned char value = (unsigned char)((packed >> (8 - bits * (int(i % perByte) + 1))) & escape);
+
+                buffer[i] = value == escape ? *extra++ : value;
+            }
+            return extra;
+        }
+        }
+    }
+
+    const unsigned char* DecodeBytes(const unsigned char* data, const unsigned char* dataEnd, unsigned char* buffer, size_t bufferSize)
+    {
+        const unsigned char* header = data;
+
+        // 2 bits of header per group
+        size_t headerSize = (bufferSize / ByteGroupSize + 3) / 4;
+        if (size_t(dataEnd - data) < headerSize)
+            return nullptr;
+
+        data += headerSize;
+
+        for (size_t i = 0; i < bufferSize; i += ByteGroupSize)
+        {
+            // the tail guarantees a full group can always be read
+            if (size_t(dataEnd - data) < ByteGroupDecodeLimit)
+                return nullptr;
+
+            size_t group = i / ByteGroupSize;
+            int bitsLog2 = (header[group / 4] >> ((group % 4) * 2)) & 3;
+
+            data = DecodeBytesGroup(data, buffer + i, bitsLog2);
+        }
+
+        return data;
+    }
+
+    // each byte of the vertex is stored as its own stream of zigzag deltas to the previous vertex
+    const unsigned char* DecodeVertexBlock(const unsigned char* data, const unsigned char* dataEnd, unsigned char* vertexData, size_t count, size_t stride, unsigned char* lastVertex)
+    {
+        unsigned char buffer[VertexBlockMaxSize];
+        unsigned char transposed[VertexBlockSizeBytes];
+
+        size_t countAligned = (count + ByteGroupSize - 1) & ~(ByteGroupSize - 1);
+
+        for (size_t k = 0; k < stride; k++)
+        {
+            data = DecodeBytes(data, dataEnd, buffer, countAligned);
+            if (!data)
+                return nullptr;
+
+            unsigned char previous = lastVertex[k];
+            for (size_t i = 0; i < count; i++)
+            {
+                unsigned char value = (unsigned char)(Unzigzag8(buffer[i]) + previous);
+                transposed[i * stride + k] = value;
+                previous = value;
+            }
+        }
+
+        memcpy(vertexData, transposed, count * stride);
+        memcpy(lastVertex, transposed + stride * (count - 1), stride);
+
+        return data;
+    }
+
+    void WriteIndex(void* destination, size_t offset, size_t stride, unsigned int index)
+    {
+        if (stride == 2)
+            ((uint16_t*)destination)[offset] = (uint16_t)index;
+        else
+            ((uint32_t*)destination)[offset] = index;
+    }
+
+    unsigned int DecodeVByte(const unsigned char*& data)
+    {
+        unsigned char lead = *data++;
+        if (lead < 128)
+            return lead;
+
+        unsigned int result = lead & 127;
+        unsigned int shift = 7;
+
+        for (int i = 0; i < 4; i++)
+        {
+            unsigned char group = *data++;
+            result |= unsigned(group & 127) << shift;
+            shift += 7;
+
+            if (group < 128)
+                break;
+        }
+
+        return result;
+    }
+
+    unsigned int DecodeIndex(const unsigned char*& data, unsigned int last)
+    {
+        unsigned int v = DecodeVByte(data);
+        unsigned int delta = (v >> 1) ^ unsigned(-int(v & 1));
+        return last + delta;
+    }
+
+    struct IndexFifos
+    {
+        unsigned int Edges[16][2];
+        unsigned int Vertices[16];
+        size_t EdgeOffset = 0;
+        size_t VertexOffset = 0;
+
+        IndexFifos()
+        {
+            memset(Edges, -1, sizeof(Edges));
+            memset(Vertices, -1, sizeof(Vertices));
+        }
+
+        void PushEdge(unsigned int a, unsigned int b)
+        {
+            Edges[EdgeOffset][0] = a;
+            Edges[EdgeOffset][1] = b;
+            EdgeOffset = (EdgeOffset + 1) & 15;
+        }
+
+        void PushVertex(unsigned int v, bool push = true)
+        {
+            Vertices[VertexOffset] = v;
+            VertexOffset = (VertexOffset + (push ? 1 : 0)) & 15;
+        }
+
+        unsigned int Vertex(size_t back) const
+        {
+            return Vertices[(VertexOffset - back) & 15];
+        }
+    };
+
+    template<class T>
+    void DecodeOctahedral(T* data, size_t count)
+    {
+        const float maxValue = float((1 << (sizeof(T) * 8 - 1)) - 1);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            // z is stored as the sum of the absolute components, so it can be rebuilt before normalizing
+            float x = float(data[i * 4 + 0]);
+            float y = float(data[i * 4 + 1]);
+            float z = float(data[i * 4 + 2]) - fabsf(x) - fabsf(y);
+
+            float t = z < 0 ? z : 0;
+            x += x >= 0 ? t : -t;
+            y += y >= 0 ? t : -t;
+
+            float scale = maxValue / sqrtf(x * x + y * y + z * z);
+
+            data[i * 4 + 0] = T(int(x * scale + (x >= 0 ? 0.5f : -0.5f)));
+            data[i * 4 + 1] = T(int(y * scale + (y >= 0 ? 0.5f : -0.5f)));
+            data[i * 4 + 2] = T(int(z * scale + (z >= 0 ? 0.5f : -0.5f)));
+        }
+    }
+}
+
+bool DecodeMeshoptVertexBuffer(void* destination, size_t count, size_t stride, const unsigned char* buffer, size_t bufferSize)
+{
+    if (stride == 0 || stride > 256 || stride % 4 != 0)
+        return false;
+
+    const unsigned char* data = buffer;
+    const unsigned char* dataEnd = buffer + bufferSize;
+
+    if (bufferSize < 1 + stride)
+        return false;
+
+    unsigned char header = *data++;
+    if ((header & 0xf0) != VertexHeader || (header & 0x0f) != 0)
+        return false;
+
+    // the last bytes hold the first vertex, which the deltas of the first block start from
+    unsigned char lastVertex[256];
+    memcpy(lastVertex, dataEnd - stride, stride);
+
+    size_t blockSize = GetVertexBlockSize(stride);
+    unsigned char* vertexData = (unsigned char*)destination;
+
+    for (size_t offset = 0; offset < count; offset += blockSize)
+    {
+        size_t size = offset + blockSize < count ? blockSize : count - offset;
+
+        data = DecodeVertexBlock(data, dataEnd, vertexData + offset * stride, size, stride, lastVertex);
+        if (!data)
+            return false;
+    }
+
+    size_t tailSize = stride < TailMaxSize ? TailMaxSize : stride;
+    return size_t(dataEnd - data) == tailSize;
+}
+
+bool DecodeMeshoptIndexBuffer(void* destination, size_t count, size_t stride, const unsigned char* buffer, size_t bufferSize)
+{
+    if (count % 3 != 0 || (stride != 2 && stride != 4))
+        return false;
+
+    // header, one code per triangle and the 16 byte aux table at the end
+    if (bufferSize < 1 + count / 3 + 16)
+        return false;
+
+    if ((buffer[0] & 0xf0) != IndexHeader)
+        return false;
+
+    int version = buffer[0] & 0x0f;
+    if (version > 1)
+        return false;
+
+    IndexFifos fifos;
+    unsigned int next = 0;
+    unsigned int last = 0;
+
+    // version 1 uses codes 13 and 14 for the last free index plus or minus one
+    int fecMax = version >= 1 ? 13 : 15;
+
+    const unsigned char* code = buffer + 1;
+    const unsigned char* data = code + count / 3;
+    const unsigned char* dataSafeEnd = buffer + bufferSize - 16;
+    const unsigned char* auxTable = dataSafeEnd;
+
+    for (size_t i = 0; i < count; i += 3)
+    {
+        // a triangle reads at most 16 bytes, the aux table is the padding that makes this safe
+        if (data > dataSafeEnd)
+            return false;
+
+        unsigned char codeTri = *code++;
+
+        if (codeTri < 0xf0)
+        {
+            // the triangle shares an edge from the fifo
+            int fe = codeTri >> 4;
+            unsigned int a = fifos.Edges[(fifos.EdgeOffset - 1 - fe) & 15][0];
+            unsigned int b = fifos.Edges[(fifos.EdgeOffset - 1 - fe) & 15][1];
+
+            int fec = codeTri & 15;
+            unsigned int c = 0;
+            bool pushC = true;
+
+            if (fec < fecMax)
+            {
+                c = fec == 0 ? next : fifos.Vertex(1 + fec);
+                pushC = fec == 0;
+                next += fec == 0 ? 1 : 0;
+            }
+            else
+            {
+                last = c = fec != 15 ? last + (fec - (fec ^ 3)) : DecodeIndex(data, last);
+            }
+
+            WriteIndex(destination, i + 0, stride, a);
+            WriteIndex(destination, i + 1, stride, b);
+            WriteIndex(destination, i + 2, stride, c);
+
+            fifos.PushVertex(c, pushC);
+            fifos.PushEdge(c, b);
+            fifos.PushEdge(a, c);
+        }
+        else
+        {
+            unsigned int a = 0;
+            unsigned int b = 0;
+            unsigned int c = 0;
+            bool pushB = true;
+            bool pushC = true;
+
+            if (codeTri < 0xfe)
+            {
+                // a is the next vertex, b and c come from the aux table
+                unsigned char codeAux = auxTable[codeTri & 15];
+                int feb = codeAux >> 4;
+                int fec = codeAux & 15;
+
+                a = next++;
+
+                b = feb == 0 ? next : fifos.Vertex(feb);
+                next += feb == 0 ? 1 : 0;
+
+                c = fec == 0 ? next : fifos.Vertex(fec);
+                next += fec == 0 ? 1 : 0;
+
+                pushB = feb == 0;
+                pushC = fec == 0;
+            }
+            else
+            {
+                unsigned char codeAux = *data++;
+                int fea = codeTri == 0xfe ? 0 : 15;
+                int feb = codeAux >> 4;
+                int fec = codeAux & 15;
+
+                if (codeAux == 0)
+                    next = 0;
+
+                a = fea == 0 ? next++ : 0;
+                b = feb == 0 ? next++ : fifos.Vertex(feb);
+                c = fec == 0 ? next++ : fifos.Vertex(fec);
+
+                if (fea == 15)
+                    last = a = DecodeIndex(data, last);
+                if (feb == 15)
+                    last = b = DecodeIndex(data, last);
+                if (fec == 15)
+                    last = c = DecodeIndex(data, last);
+
+                pushB = feb == 0 || feb == 15;
+                pushC = fec == 0 || fec == 15;
+            }
+
+            WriteIndex(destination, i + 0, stride, a);
+            WriteIndex(destination, i + 1, stride, b);
+            WriteIndex(destination, i + 2, stride, c);
+
+            fifos.PushVertex(a);
+            fifos.PushVertex(b, pushB);
+            fifos.PushVertex(c, pushC);
+
+            fifos.PushEdge(b, a);
+            fifos.PushEdge(c, b);
+            fifos.PushEdge(a, c);
+        }
+    }
+
+    // all triangle data must be used up exactly
+    return data == dataSafeEnd;
+}
+
+bool DecodeMeshoptIndexSequence(void* destination, size_t count, size_t stride, const unsigned char* buffer, size_t bufferSize)
+{
+    if (stride != 2 && stride != 4)
+        return false;
+
+    // header, at least one byte per index and a 4 byte tail
+    if (bufferSize < 1 + count + 4)
+        return false;
+
+    if ((buffer[0] & 0xf0) != SequenceHeader || (buffer[0] & 0x0f) > 1)
+        return false;
+
+    const unsigned char* data = buffer + 1;
+    const unsigned char* dataSafeEnd = buffer + bufferSize - 4;
+
+    // two baselines, the low bit of every value picks the one the delta is relative to
+    unsigned int last[2] = { 0, 0 };
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (data >= dataSafeEnd)
+            return false;
+
+        unsigned int v = DecodeVByte(data);
+        unsigned int baseline = v & 1;
+        v >>= 1;
+
+        unsigned int index = last[baseline] + ((v >> 1) ^ unsigned(-int(v & 1)));
+        last[baseline] = index;
+
+        WriteIndex(destination, i, stride, index);
+    }
+
+    return data == dataSafeEnd;
+}
+
+void DecodeMeshoptFilterOctahedral(void* data, size_t count, size_t stride)
+{
+    if (stride == 4)
+        DecodeOctahedral((int8_t*)data, count);
+    else if (stride == 8)
+        DecodeOctahedral((int16_t*)data, count);
+}
+
+void DecodeMeshoptFilterQuaternion(void* data, size_t count, size_t stride)
+{
+    if (stride != 8)
+        return;
+
+    int16_t* values = (int16_t*)data;
+    const float scale = 1.0f / sqrtf(2.0f);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        int16_t* q = values + i * 4;
+
+        // the low 2 bits of w pick the dropped component, the rest is the scale of the other three
+        int sf = q[3] | 3;
+        float ss = scale / float(sf);
+
+        float x = float(q[0]) * ss;
+        float y = float(q[1]) * ss;
+        float z = float(q[2]) * ss;
+
+        float ww = 1.0f - x * x - y * y - z * z;
+        float w = sqrtf(ww >= 0 ? ww : 0);
+
+        int xf = int(x * 32767.0f + (x >= 0 ? 0.5f : -0.5f));
+        int yf = int(y * 32767.0f + (y >= 0 ? 0.5f : -0.5f));
+        int zf = int(z * 32767.0f + (z >= 0 ? 0.5f : -0.5f));
+        int wf = int(w * 32767.0f + 0.5f);
+
+        int qc = q[3] & 3;
+
+        q[(qc + 1) & 3] = int16_t(xf);
+        q[(qc + 2) & 3] = int16_t(yf);
+        q[(qc + 3) & 3] = int16_t(zf);
+        q[(qc + 0) & 3] = int16_t(wf);
+    }
+}
+
+void DecodeMeshoptFilterExponential(void* data, size_t count, size_t stride)
+{
+    uint32_t* values = (uint32_t*)data;
+    size_t valueCount = count * (stride / 4);
+
+    for (size_t i = 0; i < valueCount; i++)
+    {
+        // 24 bit signed mantissa and 8 bit signed exponent
+        uint32_t v = values[i];
+        int mantissa = int(v << 8) >> 8;
+        int exponent = int(v) >> 24;
+
+        uint32_t bits = uint32_t(exponent + 127) << 23;
+        float power = 0;
+        memcpy(&power, &bits, sizeof(power));
+
+        float result = power * float(mantissa);
+        memcpy(&values[i], &result, sizeof(result));
+    }
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+
+// Internal decoders for the EXT_meshopt_compression bitstreams (vertex codec version 0, index codec versions 0 and 1)
+// all functions return false when the data is malformed, destination must hold count * stride bytes
+
+// attributes mode, stride must be a multiple of 4 and at most 256
+bool DecodeMeshoptVertexBuffer(void* destination, size_t count, size_t stride, const unsigned char* buffer, size_t bufferSize);
+
+// triangles mode, stride is the index size and must be 2 or 4, count must be a multiple of 3
+bool DecodeMeshoptIndexBuffer(void* destination, size_t count, size_t stride, const unsigned char* buffer, size_t bufferSize);
+
+// indices mode, stride is the index size and must be 2 or 4
+bool DecodeMeshoptIndexSequence(void* destination, size_t count, size_t stride, const unsigned char* buffer, size_t bufferSize);
+
+// filters run in place on decoded attribute data
+void DecodeMeshoptFilterOctahedral(void* data, size_t count, size_t stride);
+void DecodeMeshoptFilterQuaternion(void* data, size_t count, size_t stride);
+void DecodeMeshoptFilterExponential(void* data, size_t count, size_t stride);
@@ -1,6 +1,10 @@
 
 #include "scene.h"
 
+#include "rlgl.h"
+
+#include <cmath>
+
 
 void PQSTransformToMatrix(const PQSTransform& transform, Matrix& out_matrix)
 {
@@ -57,4 +61,590 @@ void SceneObject::CacheTransform()
     {
         WorldMatrix = MatrixMultiply(WorldMatrix, Parent->WorldMatrix);
     }
+
+    BoundsDirty = true;
+}
+
+MeshBounds ComputeMeshBounds(const Mesh& mesh)
+{
+    MeshBounds bounds;
+    if (!mesh.vertices || mesh.vertexCount == 0)
+        return bounds;
+
+    bounds.Box = GetMeshBoundingBox(mesh);
+
+    // centered on the box, which is close to the smallest sphere for the boxy shapes levels are made of
+    Vector3 center = Vector3Scale(Vector3Add(bounds.Box.min, bounds.Box.max), 0.5f);
+    float radiusSquared = 0;
+    for (int v = 0; v < mesh.vertexCount; v++)
+    {
+        Vector3 offset = { mesh.vertices[v * 3 + 0] - center.x, mesh.vertices[v * 3 + 1] - center.y, mesh.vertices[v * 3 + 2] - center.z };
+        radiusSquared = fmaxf(radiusSquared, Vector3DotProduct(offset, offset));
+    }
+
+    bounds.Sphere.Center = center;
+    bounds.Sphere.Radius = sqrtf(radiusSquared);
+    return bounds;
+}
+
+BoundingSphere MergeBoundingSpheres(const BoundingSphere& a, const BoundingSphere& b)
+{
+    float distance = Vector3Distance(a.Center, b.Center);
+
+    if (distance + b.Radius <= a.Radius)
+        return a;
+    if (distance + a.Radius <= b.Radius)
+        return b;
+
+    BoundingSphere merged;
+    merged.Radius = (distance + a.Radius + b.Radius) * 0.5f;
+    merged.Center = Vector3Add(a.Center, Vector3Scale(Vector3Subtract(b.Center, a.Center), (merged.Radius - a.Radius) / distance));
+    return merged;
+}
+
+BoundingBox TransformBoundingBox(const BoundingBox& local, const Matrix& world)
+{
+    Vector3 center = Vector3Transform(Vector3Scale(Vector3Add(local.min, local.max), 0.5f), world);
+    Vector3 extent = Vector3Scale(Vector3Subtract(local.max, local.min), 0.5f);
+
+    // the world extent along an axis is the extent projected onto the absolute rotated and scaled axes
+    Vector3 worldExtent = {
+        fabsf(world.m0) * extent.x + fabsf(world.m4) * extent.y + fabsf(world.m8) * extent.z,
+        fabsf(world.m1) * extent.x + fabsf(world.m5) * extent.y + fabsf(world.m9) * extent.z,
+        fabsf(world.m2) * extent.x + fabsf(world.m6) * extent.y + fabsf(world.m10) * extent.z
+    };
+
+    return BoundingBox{ Vector3Subtract(center, worldExtent), Vector3Add(center, worldExtent) };
+}
+
+size_t UpdateSceneWorldBounds(Scene& scene, bool all)
+{
+    std::vector<MeshSceneObject*> nodes;
+    for (MeshSceneObject* node : scene.Meshes)
+    {
+        if (all || node->BoundsDirty)
+            nodes.push_back(node);
+    }
+
+    size_t count = nodes.size();
+    if (count == 0)
+        return 0;
+
+    // the nodes are gathered into flat arrays so the transform is one branch free loop the compiler vectorizes
+    enum Stream { CenterX, CenterY, CenterZ, ExtentX, ExtentY, ExtentZ, M0, M1, M2, M4, M5, M6, M8, M9, M10, M12, M13, M14, StreamCount };
+
+    std::vector<float> streams(count * StreamCount);
+    float* stream[StreamCount];
+    for (int i = 0; i < StreamCount; i++)
+        stream[i] = streams.data() + count * i;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const BoundingBox& local = nodes[i]->Bounds;
+        const Matrix& world = nodes[i]->WorldMatrix;
+
+        stream[CenterX][i] = (local.min.x + local.max.x) * 0.5f;
+        stream[CenterY][i] = (local.min.y + local.max.y) * 0.5f;
+        stream[CenterZ][i] = (local.min.z + local.max.z) * 0.5f;
+        stream[ExtentX][i] = (local.max.x - local.min.x) * 0.5f;
+        stream[ExtentY][i] = (local.max.y - local.min.y) * 0.5f;
+        stream[ExtentZ][i] = (local.max.z - local.min.z) * 0.5f;
+
+        stream[M0][i] = world.m0;
+        stream[M1][i] = world.m1;
+        stream[M2][i] = world.m2;
+        stream[M4][i] = world.m4;
+        stream[M5][i] = world.m5;
+        stream[M6][i] = world.m6;
+        stream[M8][i] = world.m8;
+        stream[M9][i] = world.m9;
+        stream[M10][i] = world.m10;
+        stream[M12][i] = world.m12;
+        stream[M13][i] = world.m13;
+        stream[M14][i] = world.m14;
+    }
+
+    // the results overwrite the center and extent streams
+    float* __restrict cx = stream[CenterX];
+    float* __restrict cy = stream[CenterY];
+    float* __restrict cz = stream[CenterZ];
+    float* __restrict ex = stream[ExtentX];
+    float* __restrict ey = stream[ExtentY];
+    float* __restrict ez = stream[ExtentZ];
+    const float* __restrict m0 = stream[M0];
+    const float* __restrict m1 = stream[M1];
+    const float* __restrict m2 = stream[M2];
+    const float* __restrict m4 = stream[M4];
+    const float* __restrict m5 = stream[M5];
+    const float* __restrict m6 = stream[M6];
+    const float* __restrict m8 = stream[M8];
+    const float* __restrict m9 = stream[M9];
+    const float* __restrict m10 = stream[M10];
+    const float* __restrict m12 = stream[M12];
+    const float* __restrict m13 = stream[M13];
+    const float* __restrict m14 = stream[M14];
+
+    for (size_t i = 0; i < count; i++)
+    {
+        float x = cx[i], y = cy[i], z = cz[i];
+        float sx = ex[i], sy = ey[i], sz = ez[i];
+
+        cx[i] = m0[i] * x + m4[i] * y + m8[i] * z + m12[i];
+        cy[i] = m1[i] * x + m5[i] * y + m9[i] * z + m13[i];
+        cz[i] = m2[i] * x + m6[i] * y + m10[i] * z + m14[i];
+
+        ex[i] = fabsf(m0[i]) * sx + fabsf(m4[i]) * sy + fabsf(m8[i]) * sz;
+        ey[i] = fabsf(m1[i]) * sx + fabsf(m5[i]) * sy + fabsf(m9[i]) * sz;
+        ez[i] = fabsf(m2[i]) * sx + fabsf(m6[i]) * sy + fabsf(m10[i]) * sz;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        nodes[i]->WorldBounds.min = Vector3{ cx[i] - ex[i], cy[i] - ey[i], cz[i] - ez[i] };
+        nodes[i]->WorldBounds.max = Vector3{ cx[i] + ex[i], cy[i] + ey[i], cz[i] + ez[i] };
+        nodes[i]->BoundsDirty = false;
+    }
+
+    return count;
+}
+
+std::string_view StringPool::Intern(std::string_view text)
+{
+    auto itr = Strings.find(text);
+    if (itr == Strings.end())
+        itr = Strings.emplace(text).first;
+
+    return *itr;
+}
+
+std::string JoinScenePath(std::string_view parentPath, std::string_view name)
+{
+    return parentPath.empty() ? std::string(name) : std::string(parentPath) + "/" + std::string(name);
+}
+
+static void AddToNameIndex(Scene& scene, SceneObject* object, const std::string& parentPath)
+{
+    std::string path = JoinScenePath(parentPath, object->Name);
+
+    scene.NameIndex.emplace(object->Name, object);
+    scene.PathIndex.emplace(scene.Paths.Intern(path), object);
+
+    for (auto& child : object->Children)
+        AddToNameIndex(scene, child.get(), path);
+}
+
+void BuildSceneNameIndex(Scene& scene)
+{
+    // paths of renamed, moved or destroyed nodes are not kept
+    scene.NameIndex.clear();
+    scene.PathIndex.clear();
+    scene.Paths.Clear();
+
+    for (auto& root : scene.RootObjects)
+        AddToNameIndex(scene, root.get(), std::string());
+}
+
+SceneObject* FindSceneObject(const Scene& scene, std::string_view name)
+{
+    auto itr = scene.NameIndex.find(name);
+    return itr != scene.NameIndex.end() ? itr->second : nullptr;
+}
+
+std::vector<SceneObject*> FindSceneObjects(const Scene& scene, std::string_view name)
+{
+    std::vector<SceneObject*> objects;
+
+    auto [begin, end] = scene.NameIndex.equal_range(name);
+    for (auto itr = begin; itr != end; ++itr)
+        objects.push_back(itr->second);
+
+    return objects;
+}
+
+SceneObject* FindSceneObjectByPath(const Scene& scene, std::string_view path)
+{
+    auto itr = scene.PathIndex.find(path);
+    return itr != scene.PathIndex.end() ? itr->second : nullptr;
+}
+
+std::string GetSceneObjectPath(const SceneObject& object)
+{
+    return object.Parent ? JoinScenePath(GetSceneObjectPath(*object.Parent), object.Name) : std::string(object.Name);
+}
+
+static void CollectSubtree(SceneObject* object, std::unordered_set<SceneObject*>& nodes)
+{
+    nodes.insert(object);
+    for (auto& child : object->Children)
+        CollectSubtree(child.get(), nodes);
+}
+
+static void RemoveFromNameIndex(Scene& scene, SceneObject* object, const std::string& path)
+{
+    auto [nameBegin, nameEnd] = scene.NameIndex.equal_range(object->Name);
+    for (auto itr = nameBegin; itr != nameEnd; ++itr)
+    {
+        if (itr->second == object)
+        {
+            scene.NameIndex.erase(itr);
+            break;
+        }
+    }
+
+    auto [pathBegin, pathEnd] = scene.PathIndex.equal_range(path);
+    for (auto itr = pathBegin; itr != pathEnd; ++itr)
+    {
+        if (itr->second == object)
+        {
+            scene.PathIndex.erase(itr);
+            break;
+        }
+    }
+
+    for (auto& child : object->Children)
+        RemoveFromNameIndex(scene, child.get(), JoinScenePath(path, child->Name));
+}
+
+void DestroySceneObject(Scene& scene, SceneObject* object)
+{
+    if (!object)
+        return;
+
+    std::unordered_set<SceneObject*> nodes;
+    CollectSubtree(object, nodes);
+
+    RemoveFromNameIndex(scene, object, GetSceneObjectPath(*object));
+
+    for (auto* meshNode : scene.Meshes)
+    {
+        if (!nodes.contains(meshNode))
+            continue;
+
+        for (auto& instance : meshNode->Meshes)
+        {
+            if (!instance.SharedMaterial)
+                MemFree(instance.MaterialData.maps);
+            instance.MaterialData.maps = nullptr;
+        }
+    }
+
+    std::erase_if(scene.Meshes, [&](SceneObject* node) { return nodes.contains(node); });
+    std::erase_if(scene.Lights, [&](SceneObject* node) { return nodes.contains(node); });
+    std::erase_if(scene.Cameras, [&](SceneObject* node) { return nodes.contains(node); });
+
+    auto& siblings = object->Parent ? object->Parent->Children : scene.RootObjects;
+    std::erase_if(siblings, [&](const std::unique_ptr<SceneObject>& node) { return node.get() == object; });
+}
+
+static void FreeMeshVertexData(Mesh& mesh)
+{
+    MemFree(mesh.vertices);
+    MemFree(mesh.normals);
+    MemFree(mesh.texcoords);
+    MemFree(mesh.texcoords2);
+    MemFree(mesh.tangents);
+    MemFree(mesh.colors);
+
+    mesh.vertices = nullptr;
+    mesh.normals = nullptr;
+    mesh.texcoords = nullptr;
+    mesh.texcoords2 = nullptr;
+    mesh.tangents = nullptr;
+    mesh.colors = nullptr;
+}
+
+// block meshes must not have their arrays freed one by one
+static void ClearMeshArrays(Mesh& mesh)
+{
+    mesh.vertices = nullptr;
+    mesh.normals = nullptr;
+    mesh.texcoords = nullptr;
+    mesh.texcoords2 = nullptr;
+    mesh.tangents = nullptr;
+    mesh.colors = nullptr;
+    mesh.indices = nullptr;
+}
+
+// meshes that were never uploaded have no GPU side, UnloadMesh would call into GL
+static void UnloadSceneMesh(Mesh& mesh)
+{
+    if (mesh.vboId != nullptr)
+    {
+        UnloadMesh(mesh);
+        return;
+    }
+
+    FreeMeshVertexData(mesh);
+    MemFree(mesh.indices);
+    mesh.indices = nullptr;
+}
+
+static void UnloadCachedMesh(Scene& scene, size_t hash, Mesh& mesh)
+{
+    auto block = scene.MeshBlocks.find(hash);
+    if (block != scene.MeshBlocks.end())
+    {
+        ClearMeshArrays(mesh);
+        MemFree(block->second.Data);
+    }
+
+    UnloadSceneMesh(mesh);
+}
+
+void UnloadScene(Scene& scene)
+{
+    for (auto& [hash, lods] : scene.MeshLODs)
+    {
+        for (auto& lod : lods)
+            UnloadSceneMesh(*lod.MeshData);
+    }
+
+    for (auto& [hash, mesh] : scene.MeshCache)
+        UnloadCachedMesh(scene, hash, *mesh);
+
+    for (auto& [hash, texture] : scene.TextureCache)
+        UnloadTexture(texture);
+
+    // every instance owns its material maps unless it came from a prefab, the textures they point at are owned by the cache
+    for (auto* meshNode : scene.Meshes)
+    {
+        for (auto& instance : meshNode->Meshes)
+        {
+            if (!instance.SharedMaterial)
+                MemFree(instance.MaterialData.maps);
+            instance.MaterialData.maps = nullptr;
+        }
+    }
+
+    for (auto& instance : scene.PrefabMeshes)
+        MemFree(instance.MaterialData.maps);
+
+    for (auto& [hash, image] : scene.ImageCache)
+        UnloadImage(image);
+
+    scene.Cameras.clear();
+    scene.Lights.clear();
+    scene.Meshes.clear();
+    scene.RootObjects.clear();
+    scene.PrefabMeshes.clear();
+    scene.NameIndex.clear();
+    scene.PathIndex.clear();
+    scene.Strings.Clear();
+    scene.Paths.Clear();
+    scene.MeshLODs.clear();
+    scene.MeshBlocks.clear();
+    scene.MeshBoundsCache.clear();
+    scene.MeshCache.clear();
+    scene.TextureCache.clear();
+    scene.ImageCache.clear();
+}
+
+void UnloadUnusedSceneData(Scene& scene)
+{
+    std::unordered_set<size_t> usedMeshes;
+    std::unordered_set<size_t> usedTextures;
+
+    auto markUsed = [&](const MeshSceneObject::MeshInstanceData& instance)
+        {
+            usedMeshes.insert(instance.MeshHash);
+            if (instance.TextureHash != 0)
+                usedTextures.insert(instance.TextureHash);
+        };
+
+    for (auto* meshNode : scene.Meshes)
+    {
+        for (auto& instance : meshNode->Meshes)
+            markUsed(instance);
+    }
+
+    for (auto& instance : scene.PrefabMeshes)
+        markUsed(instance);
+
+    for (auto itr = scene.MeshCache.begin(); itr != scene.MeshCache.end();)
+    {
+        if (usedMeshes.contains(itr->first))
+        {
+            ++itr;
+            continue;
+        }
+
+        auto lods = scene.MeshLODs.find(itr->first);
+        if (lods != scene.MeshLODs.end())
+        {
+            for (auto& lod : lods->second)
+                UnloadSceneMesh(*lod.MeshData);
+            scene.MeshLODs.erase(lods);
+        }
+
+        UnloadCachedMesh(scene, itr->first, *itr->second);
+        scene.MeshBlocks.erase(itr->first);
+        scene.MeshBoundsCache.erase(itr->first);
+        itr = scene.MeshCache.erase(itr);
+    }
+
+    for (auto itr = scene.TextureCache.begin(); itr != scene.TextureCache.end();)
+    {
+        if (usedTextures.contains(itr->first))
+        {
+            ++itr;
+            continue;
+        }
+
+        UnloadTexture(itr->second);
+        itr = scene.TextureCache.erase(itr);
+    }
+
+    for (auto itr = scene.ImageCache.begin(); itr != scene.ImageCache.end();)
+    {
+        if (usedTextures.contains(itr->first))
+        {
+            ++itr;
+            continue;
+        }
+
+        UnloadImage(itr->second);
+        itr = scene.ImageCache.erase(itr);
+    }
+}
+
+bool UploadScene(Scene& scene, int maxUploads)
+{
+    int uploads = 0;
+    auto canUpload = [&]() { return maxUploads <= 0 || uploads < maxUploads; };
+
+    for (auto itr = scene.ImageCache.begin(); itr != scene.ImageCache.end();)
+    {
+        if (!canUpload())
+            return false;
+
+        Texture texture = LoadTextureFromImage(itr->second);
+        if (itr->second.mipmaps > 1)
+            SetTextureFilter(texture, TEXTURE_FILTER_TRILINEAR);
+
+        scene.TextureCache[itr->first] = texture;
+        UnloadImage(itr->second);
+        itr = scene.ImageCache.erase(itr);
+        uploads++;
+    }
+
+    auto uploadMesh = [&](Mesh& mesh)
+        {
+            if (mesh.vboId != nullptr || mesh.vertexCount == 0)
+                return true;
+
+            if (!canUpload())
+                return false;
+
+            UploadMesh(&mesh, false);
+            uploads++;
+            return true;
+        };
+
+    for (auto& [hash, mesh] : scene.MeshCache)
+    {
+        if (!uploadMesh(*mesh))
+            return false;
+    }
+
+    for (auto& [hash, lods] : scene.MeshLODs)
+    {
+        for (auto& lod : lods)
+        {
+            if (!uploadMesh(*lod.MeshData))
+                return false;
+        }
+    }
+
+    // materials built without a GL context have no shader or textures yet
+    auto patchMaterial = [&](MeshSceneObject::MeshInstanceData& instance)
+        {
+            Material& material = instance.MaterialData;
+            if (material.shader.id == 0)
+            {
+                material.shader.id = rlGetShaderIdDefault();
+                material.shader.locs = rlGetShaderLocsDefault();
+            }
+
+            Texture& albedo = material.maps[MATERIAL_MAP_ALBEDO].texture;
+
+            auto texture = scene.TextureCache.find(instance.TextureHash);
+            if (instance.TextureHash != 0 && texture != scene.TextureCache.end())
+                albedo = texture->second;
+            else if (albedo.id == 0)
+                albedo.id = rlGetTextureIdDefault();
+        };
+
+    for (auto* meshNode : scene.Meshes)
+    {
+        for (auto& instance : meshNode->Meshes)
+            patchMaterial(instance);
+    }
+
+    // prefabs instantiated later copy these
+    for (auto& instance : scene.PrefabMeshes)
+        patchMaterial(instance);
+
+    return true;
+}
+
+void UnloadSceneMeshData(Scene& scene, const std::unordered_set<size_t>* keepMeshes)
+{
+    for (auto& [hash, lods] : scene.MeshLODs)
+    {
+        for (auto& lod : lods)
+            FreeMeshVertexData(*lod.MeshData);
+    }
+
+    for (auto& [hash, mesh] : scene.MeshCache)
+    {
+        if (keepMeshes && keepMeshes->contains(hash))
+            continue;
+
+        auto block = scene.MeshBlocks.find(hash);
+        if (block == scene.MeshBlocks.end())
+        {
+            FreeMeshVertexData(*mesh);
+            continue;
+        }
+
+        // the indices are at the start of the block, so shrinking it keeps them
+        unsigned short* indices = mesh->indices;
+        ClearMeshArrays(*mesh);
+
+        if (indices)
+        {
+            mesh->indices = (unsigned short*)MemRealloc(block->second.Data, (unsigned int)(size_t(mesh->triangleCount) * 3 * sizeof(unsigned short)));
+            block->second.Data = mesh->indices;
+        }
+        else
+        {
+            MemFree(block->second.Data);
+            block->second.Data = nullptr;
+        }
+        block->second.Vertices = nullptr;
+    }
+}
+
+void FillInterleavedVertices(const Mesh& mesh, InterleavedVertex* vertices)
+{
+    if (!vertices || !mesh.vertices)
+        return;
+
+    for (int v = 0; v < mesh.vertexCount; v++)
+    {
+        InterleavedVertex& vertex = vertices[v];
+        vertex.Position = Vector3{ mesh.vertices[v * 3 + 0], mesh.vertices[v * 3 + 1], mesh.vertices[v * 3 + 2] };
+        vertex.Normal = mesh.normals ? Vector3{ mesh.normals[v * 3 + 0], mesh.normals[v * 3 + 1], mesh.normals[v * 3 + 2] } : Vector3Zeros;
+        vertex.Texcoord = mesh.texcoords ? Vector2{ mesh.texcoords[v * 2 + 0], mesh.texcoords[v * 2 + 1] } : Vector2{ 0, 0 };
+    }
+}
+
+void UpdateInterleavedVertices(Scene& scene)
+{
+    for (auto& [hash, block] : scene.MeshBlocks)
+    {
+        auto mesh = scene.MeshCache.find(hash);
+        if (mesh != scene.MeshCache.end())
+            FillInterleavedVertices(*mesh->second, block.Vertices);
+    }
 }
@@ -0,0 +1,451 @@
+#include "scene_atlas.h"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <unordered_set>
+
+namespace
+{
+    // bottom left skyline packer, the top edge of the packed area is kept as segments from left to right
+    class Skyline
+    {
+    public:
+        Skyline(int width, int height)
+            : Width(width), Height(height)
+        {
+            Segments.push_back(Segment{ 0, 0, width });
+        }
+
+        bool Insert(int width, int height, int& outX, int& outY)
+        {
+            size_t best = Segments.size();
+            int bestTop = Height + 1;
+            int bestWidth = Width + 1;
+
+            for (size_t i = 0; i < Segments.size(); i++)
+            {
+                int y = Fit(i, width, height);
+                if (y < 0)
+                    continue;
+
+                // lowest top edge wins, ties go to the narrowest segment so gaps fill up first
+                if (y + height < bestTop || (y + height == bestTop && Segments[i].Width < bestWidth))
+                {
+                    best = i;
+                    bestTop = y + height;
+                    bestWidth = Segments[i].Width;
+                }
+            }
+
+            if (best == Segments.size())
+                return false;
+
+            outX = Segments[best].X;
+            outY = bestTop - height;
+
+            Segments.insert(Segments.begin() + best, Segment{ outX, bestTop, width });
+
+            // the segments under the new one are covered now
+            int right = outX + width;
+            for (size_t i = best + 1; i < Segments.size();)
+            {
+                Segment& segment = Segments[i];
+                if (segment.X >= right)
+                    break;
+
+                if (segment.X + segment.Width <= right)
+                {
+                    Segments.erase(Segments.begin() + i);
+                    continue;
+                }
+
+                segment.Width -= right - segment.X;
+                segment.X = right;
+                break;
+            }
+
+            for (size_t i = 0; i + 1 < Segments.size();)
+            {
+                if (Segments[i].Y == Segments[i + 1].Y)
+                {
+                    Segments[i].Width += Segments[i + 1].Width;
+                    Segments.erase(Segments.begin() + i + 1);
+                    continue;
+                }
+                i++;
+            }
+
+            UsedHeight = std::max(UsedHeight, bestTop);
+            return true;
+        }
+
+        int GetUsedHeight() const { return UsedHeight; }
+
+    private:
+        struct Segment
+        {
+            int X = 0;
+            int Y = 0;
+            int Width = 0;
+        };
+
+        // bottom of a rectangle whose left edge sits on the segment, -1 when it does not fit
+        int Fit(size_t index, int width, int height) const
+        {
+            if (Segments[index].X + width > Width)
+                return -1;
+
+            int y = 0;
+            int remaining = width;
+            for (size_t i = index; remaining > 0 && i < Segments.size(); i++)
+            {
+                y = std::max(y, Segments[i].Y);
+                if (y + height > Height)
+                    return -1;
+
+                remaining -= Segments[i].Width;
+            }
+
+            return y;
+        }
+
+        int Width = 0;
+        int Height = 0;
+        int UsedHeight = 0;
+        std::vector<Segment> Segments;
+    };
+
+    struct PackedTexture
+    {
+        size_t Hash = 0;
+        Image Pixels = { 0 };                       // RGBA8 copy of the source image
+        size_t Atlas = 0;
+        int X = 0;                                  // position of the image inside the atlas, without the padding
+        int Y = 0;
+    };
+
+    int AlignUp(int value, int alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    int NextPowerOfTwo(int value)
+    {
+        int result = 1;
+        while (result < value)
+            result <<= 1;
+        return result;
+    }
+
+    bool HasAtlasTexcoords(const Mesh& mesh)
+    {
+        // uploaded meshes would keep the old texcoords on the GPU
+        if (!mesh.texcoords || mesh.vaoId != 0)
+            return false;
+
+        // tiling textures repeat outside 0-1, which an atlas can not do
+        constexpr float epsilon = 0.001f;
+        for (int i = 0; i < mesh.vertexCount * 2; i++)
+        {
+            if (mesh.texcoords[i] < -epsilon || mesh.texcoords[i] > 1.0f + epsilon)
+                return false;
+        }
+
+        return true;
+    }
+
+    void RemapTexcoords(Mesh& mesh, const PackedTexture& texture, int atlasWidth, int atlasHeight)
+    {
+        if (!mesh.texcoords)
+            return;
+
+        float scaleX = float(texture.Pixels.width) / float(atlasWidth);
+        float scaleY = float(texture.Pixels.height) / float(atlasHeight);
+        float offsetX = float(texture.X) / float(atlasWidth);
+        float offsetY = float(texture.Y) / float(atlasHeight);
+
+        for (int v = 0; v < mesh.vertexCount; v++)
+        {
+            mesh.texcoords[v * 2 + 0] = offsetX + std::clamp(mesh.texcoords[v * 2 + 0], 0.0f, 1.0f) * scaleX;
+            mesh.texcoords[v * 2 + 1] = offsetY + std::clamp(mesh.texcoords[v * 2 + 1], 0.0f, 1.0f) * scaleY;
+        }
+    }
+
+    // copies the image into the atlas and repeats its edge pixels into the padding
+    void CopyIntoAtlas(Image& atlas, const PackedTexture& texture, int padding)
+    {
+        const unsigned char* source = (const unsigned char*)texture.Pixels.data;
+        unsigned char* destination = (unsigned char*)atlas.data;
+
+        int width = texture.Pixels.width;
+        int height = texture.Pixels.height;
+
+        for (int y = -padding; y < height + padding; y++)
+        {
+            int sourceY = std::clamp(y, 0, height - 1);
+            unsigned char* row = destination + (size_t(texture.Y + y) * atlas.width + texture.X) * 4;
+
+            for (int x = -padding; x < width + padding; x++)
+            {
+                int sourceX = std::clamp(x, 0, width - 1);
+                memcpy(row + x * 4, source + (size_t(sourceY) * width + sourceX) * 4, 4);
+            }
+        }
+    }
+
+    size_t GetAtlasHash(const std::vector<const PackedTexture*>& members)
+    {
+        size_t hash = 2166136261U; // FNV_offset_basis
+        for (const PackedTexture* member : members)
+        {
+            hash ^= member->Hash;
+            hash *= 16777619U; // FNV_prime
+        }
+        return hash ^ std::hash<std::string_view>()("rlSceneLoader/atlas");
+    }
+
+    // remapped texcoords make another mesh, so it must not be found under the hash of the file data again
+    size_t GetAtlasMeshHash(size_t meshHash, size_t atlasHash, const PackedTexture& texture, int atlasWidth, int atlasHeight)
+    {
+        size_t hash = meshHash ^ (atlasHash * 0x9E3779B97F4A7C15ull);
+        for (int value : { texture.X, texture.Y, atlasWidth, atlasHeight })
+            hash = hash * 31 + size_t(value);
+        return hash;
+    }
+
+    template<class T>
+    void MoveCacheEntry(std::unordered_map<size_t, T>& cache, size_t from, size_t to)
+    {
+        auto itr = cache.find(from);
+        if (itr == cache.end())
+            return;
+
+        cache[to] = std::move(itr->second);
+        cache.erase(from);
+    }
+}
+
+TextureAtlasStats AtlasSceneTextures(Scene& scene, const TextureAtlasSettings& settings)
+{
+    TextureAtlasStats stats;
+
+    int padding = std::max(0, settings.Padding);
+    int atlasSize = std::max(1, settings.AtlasSize);
+
+    // which textures every cached mesh is drawn with
+    std::unordered_map<size_t, std::unordered_set<size_t>> meshTextures;
+    std::unordered_map<size_t, std::vector<size_t>> textureMeshes;
+
+    auto addInstance = [&](const MeshSceneObject::MeshInstanceData& instance)
+        {
+            if (instance.TextureHash == 0)
+                return;
+
+            if (meshTextures[instance.MeshHash].insert(instance.TextureHash).second)
+                textureMeshes[instance.TextureHash].push_back(instance.MeshHash);
+        };
+
+    for (auto* meshNode : scene.Meshes)
+    {
+        for (auto& instance : meshNode->Meshes)
+            addInstance(instance);
+    }
+
+    for (auto& instance : scene.PrefabMeshes)
+        addInstance(instance);
+
+    // sorted by hash first so the packing order does not depend on the hash map order
+    std::map<size_t, const Image*> smallImages;
+    for (auto& [hash, image] : scene.ImageCache)
+    {
+        if (image.width <= settings.MaxTextureSize && image.height <= settings.MaxTextureSize && textureMeshes.contains(hash))
+            smallImages.emplace(hash, &image);
+    }
+
+    std::vector<PackedTexture> textures;
+    for (auto& [hash, image] : smallImages)
+    {
+        bool packable = image->width + padding * 2 <= atlasSize && image->height + padding * 2 <= atlasSize;
+
+        for (size_t meshHash : textureMeshes[hash])
+        {
+            auto mesh = scene.MeshCache.find(meshHash);
+            packable &= meshTextures[meshHash].size() == 1 && mesh != scene.MeshCache.end() && HasAtlasTexcoords(*mesh->second);
+        }
+
+        if (!packable)
+        {
+            stats.SkippedTextures++;
+            continue;
+        }
+
+        PackedTexture texture;
+        texture.Hash = hash;
+        texture.Pixels = ImageCopy(*image);
+        if (texture.Pixels.mipmaps > 1 || texture.Pixels.format != PIXELFORMAT_UNCOMPRESSED_R8G8B8A8)
+        {
+            texture.Pixels.mipmaps = 1;
+            ImageFormat(&texture.Pixels, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+        }
+
+        if (texture.Pixels.data == NULL || texture.Pixels.format != PIXELFORMAT_UNCOMPRESSED_R8G8B8A8)
+        {
+            UnloadImage(texture.Pixels);
+            stats.SkippedTextures++;
+            continue;
+        }
+
+        textures.push_back(texture);
+    }
+
+    if (textures.empty())
+        return stats;
+
+    // tallest first packs tightest with a skyline, the hash breaks ties so the order is stable
+    std::sort(textures.begin(), textures.end(), [](const PackedTexture& a, const PackedTexture& b)
+        {
+            if (a.Pixels.height != b.Pixels.height)
+                return a.Pixels.height > b.Pixels.height;
+            if (a.Pixels.width != b.Pixels.width)
+                return a.Pixels.width > b.Pixels.width;
+            return a.Hash < b.Hash;
+        });
+
+    // padded cells start on multiples of the padding so the first mip levels average texels of one texture only
+    int alignment = std::max(1, padding);
+
+    std::vector<Skyline> skylines;
+    for (PackedTexture& texture : textures)
+    {
+        int cellWidth = std::min(AlignUp(texture.Pixels.width + padding * 2, alignment), atlasSize);
+        int cellHeight = std::min(AlignUp(texture.Pixels.height + padding * 2, alignment), atlasSize);
+
+        bool placed = false;
+        for (size_t atlas = 0; atlas < skylines.size() && !placed; atlas++)
+        {
+            placed = skylines[atlas].Insert(cellWidth, cellHeight, texture.X, texture.Y);
+            texture.Atlas = atlas;
+        }
+
+        if (!placed)
+        {
+            skylines.emplace_back(atlasSize, atlasSize);
+            skylines.back().Insert(cellWidth, cellHeight, texture.X, texture.Y);
+            texture.Atlas = skylines.size() - 1;
+        }
+
+        texture.X += padding;
+        texture.Y += padding;
+    }
+
+    std::vector<std::vector<const PackedTexture*>> members(skylines.size());
+    for (const PackedTexture& texture : textures)
+        members[texture.Atlas].push_back(&texture);
+
+    std::unordered_map<size_t, size_t> atlasHashes;     // texture hash to atlas hash
+    std::unordered_map<size_t, size_t> meshHashes;      // file mesh hash to remapped mesh hash
+
+    for (size_t atlas = 0; atlas < skylines.size(); atlas++)
+    {
+        Image image = { 0 };
+        image.width = atlasSize;
+        image.height = std::min(NextPowerOfTwo(skylines[atlas].GetUsedHeight()), atlasSize);
+        image.mipmaps = 1;
+        image.format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8;
+        image.data = MemAlloc((unsigned int)(size_t(image.width) * image.height * 4));
+
+        size_t atlasHash = GetAtlasHash(members[atlas]);
+
+        for (const PackedTexture* texture : members[atlas])
+        {
+            CopyIntoAtlas(image, *texture, padding);
+
+            for (size_t meshHash : textureMeshes[texture->Hash])
+            {
+                Mesh& mesh = *scene.MeshCache[meshHash];
+                RemapTexcoords(mesh, *texture, image.width, image.height);
+
+                auto lods = scene.MeshLODs.find(meshHash);
+                if (lods != scene.MeshLODs.end())
+                {
+                    for (auto& lod : lods->second)
+                        RemapTexcoords(*lod.MeshData, *texture, image.width, image.height);
+                }
+
+                auto block = scene.MeshBlocks.find(meshHash);
+                if (block != scene.MeshBlocks.end() && block->second.Vertices)
+                    FillInterleavedVertices(mesh, block->second.Vertices);
+
+                meshHashes[meshHash] = GetAtlasMeshHash(meshHash, atlasHash, *texture, image.width, image.height);
+                stats.RemappedMeshes++;
+            }
+
+            atlasHashes[texture->Hash] = atlasHash;
+
+            auto cached = scene.ImageCache.find(texture->Hash);
+            UnloadImage(cached->second);
+            scene.ImageCache.erase(cached);
+        }
+
+        // a reload of an atlased scene builds the same atlas again, the scene keeps the one it has
+        if (scene.TextureCache.contains(atlasHash) || scene.ImageCache.contains(atlasHash))
+        {
+            UnloadImage(image);
+            continue;
+        }
+
+        if (settings.Mipmaps)
+            ImageMipmaps(&image);
+
+        scene.ImageCache[atlasHash] = image;
+    }
+
+    // remapped meshes move to a key that includes their place in the atlas, so a reload converts the file data again
+    // instead of reusing them with the original texture, when the key is taken by an earlier identical remap that mesh
+    // is used and the new one stays unused under the old key until UnloadUnusedSceneData
+    for (auto& [fileHash, atlasMeshHash] : meshHashes)
+    {
+        if (scene.MeshCache.contains(atlasMeshHash))
+            continue;
+
+        MoveCacheEntry(scene.MeshCache, fileHash, atlasMeshHash);
+        MoveCacheEntry(scene.MeshBlocks, fileHash, atlasMeshHash);
+        MoveCacheEntry(scene.MeshBoundsCache, fileHash, atlasMeshHash);
+        MoveCacheEntry(scene.MeshLODs, fileHash, atlasMeshHash);
+    }
+
+    auto remapInstance = [&](MeshSceneObject::MeshInstanceData& instance)
+        {
+            auto atlas = atlasHashes.find(instance.TextureHash);
+            if (atlas != atlasHashes.end())
+                instance.TextureHash = atlas->second;
+
+            auto mesh = meshHashes.find(instance.MeshHash);
+            if (mesh != meshHashes.end())
+            {
+                instance.MeshHash = mesh->second;
+                instance.MeshData = scene.MeshCache[mesh->second];
+            }
+        };
+
+    for (auto* meshNode : scene.Meshes)
+    {
+        for (auto& instance : meshNode->Meshes)
+            remapInstance(instance);
+    }
+
+    for (auto& instance : scene.PrefabMeshes)
+        remapInstance(instance);
+
+    for (PackedTexture& texture : textures)
+        UnloadImage(texture.Pixels);
+
+    stats.Atlases = skylines.size();
+    stats.PackedTextures = textures.size();
+
+    TraceLog(LOG_INFO, "ATLAS: packed %zu textures into %zu atlases, %zu meshes remapped, %zu small textures skipped",
+        stats.PackedTextures, stats.Atlases, stats.RemappedMeshes, stats.SkippedTextures);
+
+    return stats;
+}
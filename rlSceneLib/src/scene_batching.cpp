@@ -0,0 +1,389 @@
+#include "scene_batching.h"
+#include "mesh_utils.h"
+
+#include "rlgl.h"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+namespace
+{
+    // instances merge when they would draw the same way
+    struct BatchKey
+    {
+        size_t TextureHash = 0;
+        uint32_t Color = 0;
+        unsigned int ShaderId = 0;
+
+        bool operator==(const BatchKey& other) const = default;
+    };
+
+    struct BatchKeyHash
+    {
+        size_t operator()(const BatchKey& key) const
+        {
+            return key.TextureHash ^ (size_t(key.Color) * 0x9E3779B97F4A7C15ull) ^ (size_t(key.ShaderId) << 32);
+        }
+    };
+
+    BatchKey GetBatchKey(const MeshSceneObject::MeshInstanceData& instance)
+    {
+        const Color& color = instance.MaterialData.maps[MATERIAL_MAP_ALBEDO].color;
+        return BatchKey{ instance.TextureHash, uint32_t(color.r) | uint32_t(color.g) << 8 | uint32_t(color.b) << 16 | uint32_t(color.a) << 24, instance.MaterialData.shader.id };
+    }
+
+    // a batch while it is being filled, the arrays become the mesh once it is full
+    struct BatchBuilder
+    {
+        const MeshSceneObject::MeshInstanceData* Material = nullptr;    // first instance, its material is copied
+
+        std::vector<float> Vertices;
+        std::vector<float> Normals;
+        std::vector<float> Texcoords;
+        std::vector<float> Texcoords2;                  // empty until a source has lightmap texcoords
+        std::vector<float> Tangents;                    // empty until a source has tangents
+        std::vector<unsigned char> Colors;              // empty until a source has colors
+        std::vector<unsigned short> Indices;
+
+        BoundingBox Bounds = { 0 };
+        std::vector<StaticBatchSource> Sources;
+
+        int VertexCount() const { return int(Vertices.size() / 3); }
+    };
+
+    bool CanBatch(const MeshSceneObject::MeshInstanceData& instance, int maxVertices)
+    {
+        const Mesh* mesh = instance.MeshData.get();
+        if (!mesh || !mesh->vertices || mesh->vertexCount == 0 || mesh->vertexCount > maxVertices)
+            return false;
+
+        return instance.MaterialData.maps != nullptr;
+    }
+
+    void AppendInstance(BatchBuilder& batch, const MeshSceneObject& node, size_t meshIndex)
+    {
+        const Mesh& mesh = *node.Meshes[meshIndex].MeshData;
+        const Matrix& world = node.WorldMatrix;
+
+        // normals use the inverse transpose so scaled nodes keep them perpendicular
+        Matrix normalMatrix = MatrixTranspose(MatrixInvert(world));
+        normalMatrix.m12 = normalMatrix.m13 = normalMatrix.m14 = 0;
+
+        // tangents follow the surface, so they use the world matrix without the translation
+        Matrix tangentMatrix = world;
+        tangentMatrix.m12 = tangentMatrix.m13 = tangentMatrix.m14 = 0;
+
+        // mirrored nodes flip the winding and the bitangent
+        float determinant = MatrixDeterminant(world);
+        bool flip = determinant < 0;
+
+        uint32_t firstVertex = uint32_t(batch.VertexCount());
+
+        for (int v = 0; v < mesh.vertexCount; v++)
+        {
+            Vector3 position = Vector3Transform(Vector3{ mesh.vertices[v * 3 + 0], mesh.vertices[v * 3 + 1], mesh.vertices[v * 3 + 2] }, world);
+            batch.Vertices.insert(batch.Vertices.end(), { position.x, position.y, position.z });
+
+            if (batch.VertexCount() == 1)
+                batch.Bounds = BoundingBox{ position, position };
+            else
+            {
+                batch.Bounds.min = Vector3Min(batch.Bounds.min, position);
+                batch.Bounds.max = Vector3Max(batch.Bounds.max, position);
+            }
+
+            Vector3 normal = Vector3Zeros;
+            if (mesh.normals)
+                normal = Vector3Normalize(Vector3Transform(Vector3{ mesh.normals[v * 3 + 0], mesh.normals[v * 3 + 1], mesh.normals[v * 3 + 2] }, normalMatrix));
+            batch.Normals.insert(batch.Normals.end(), { normal.x, normal.y, normal.z });
+
+            if (mesh.texcoords)
+                batch.Texcoords.insert(batch.Texcoords.end(), { mesh.texcoords[v * 2 + 0], mesh.texcoords[v * 2 + 1] });
+            else
+                batch.Texcoords.insert(batch.Texcoords.end(), { 0.0f, 0.0f });
+        }
+
+        if (mesh.texcoords2 || !batch.Texcoords2.empty())
+        {
+            batch.Texcoords2.resize(size_t(firstVertex) * 2, 0.0f);
+            if (mesh.texcoords2)
+                batch.Texcoords2.insert(batch.Texcoords2.end(), mesh.texcoords2, mesh.texcoords2 + size_t(mesh.vertexCount) * 2);
+            else
+                batch.Texcoords2.resize(size_t(batch.VertexCount()) * 2, 0.0f);
+        }
+
+        if (mesh.tangents || !batch.Tangents.empty())
+        {
+            batch.Tangents.resize(size_t(firstVertex) * 4, 0.0f);
+            for (int v = 0; v < mesh.vertexCount; v++)
+            {
+                if (!mesh.tangents)
+                {
+                    batch.Tangents.insert(batch.Tangents.end(), { 1.0f, 0.0f, 0.0f, 1.0f });
+                    continue;
+                }
+
+                const float* tangent = mesh.tangents + v * 4;
+                Vector3 direction = Vector3Normalize(Vector3Transform(Vector3{ tangent[0], tangent[1], tangent[2] }, tangentMatrix));
+                batch.Tangents.insert(batch.Tangents.end(), { direction.x, direction.y, direction.z, flip ? -tangent[3] : tangent[3] });
+            }
+        }
+
+        // sources without colors are white, which is what raylib draws them with
+        if (mesh.colors || !batch.Colors.empty())
+        {
+            batch.Colors.resize(size_t(firstVertex) * 4, 255);
+            if (mesh.colors)
+                batch.Colors.insert(batch.Colors.end(), mesh.colors, mesh.colors + size_t(mesh.vertexCount) * 4);
+            else
+                batch.Colors.resize(size_t(batch.VertexCount()) * 4, 255);
+        }
+
+        std::vector<uint32_t> indices = GetMeshIndices(mesh);
+
+        StaticBatchSource source;
+        source.Node = &node;
+        source.MeshIndex = meshIndex;
+        source.FirstTriangle = uint32_t(batch.Indices.size() / 3);
+        source.TriangleCount = uint32_t(indices.size() / 3);
+        batch.Sources.push_back(source);
+
+        for (size_t i = 0; i + 2 < indices.size(); i += 3)
+        {
+            batch.Indices.push_back((unsigned short)(firstVertex + indices[i]));
+            batch.Indices.push_back((unsigned short)(firstVertex + indices[flip ? i + 2 : i + 1]));
+            batch.Indices.push_back((unsigned short)(firstVertex + indices[flip ? i + 1 : i + 2]));
+        }
+    }
+
+    template<typename T>
+    T* CopyArray(const std::vector<T>& data)
+    {
+        if (data.empty())
+            return nullptr;
+
+        T* copy = (T*)MemAlloc((unsigned int)(data.size() * sizeof(T)));
+        memcpy(copy, data.data(), data.size() * sizeof(T));
+        return copy;
+    }
+
+    StaticBatch FinishBatch(BatchBuilder& builder)
+    {
+        StaticBatch batch;
+
+        const Material& source = builder.Material->MaterialData;
+        batch.MaterialData = LoadMaterialDefault();
+        batch.MaterialData.shader = source.shader;
+        memcpy(batch.MaterialData.maps, source.maps, sizeof(MaterialMap) * MAX_MATERIAL_MAPS);
+        memcpy(batch.MaterialData.params, source.params, sizeof(source.params));
+        batch.TextureHash = builder.Material->TextureHash;
+
+        batch.MeshData = std::make_shared<Mesh>();
+        Mesh& mesh = *batch.MeshData;
+        mesh = Mesh{ 0 };
+        mesh.vertexCount = builder.VertexCount();
+        mesh.triangleCount = int(builder.Indices.size() / 3);
+        mesh.vertices = CopyArray(builder.Vertices);
+        mesh.normals = CopyArray(builder.Normals);
+        mesh.texcoords = CopyArray(builder.Texcoords);
+        mesh.texcoords2 = CopyArray(builder.Texcoords2);
+        mesh.tangents = CopyArray(builder.Tangents);
+        mesh.colors = CopyArray(builder.Colors);
+        mesh.indices = CopyArray(builder.Indices);
+
+        batch.Bounds = builder.Bounds;
+        batch.Sources = std::move(builder.Sources);
+        return batch;
+    }
+
+    void UnloadBatchMesh(Mesh& mesh)
+    {
+        if (mesh.vboId != nullptr)
+        {
+            UnloadMesh(mesh);
+            return;
+        }
+
+        MemFree(mesh.vertices);
+        MemFree(mesh.normals);
+        MemFree(mesh.texcoords);
+        MemFree(mesh.texcoords2);
+        MemFree(mesh.tangents);
+        MemFree(mesh.colors);
+        MemFree(mesh.indices);
+        mesh = Mesh{ 0 };
+    }
+}
+
+void BuildStaticBatches(const Scene& scene, StaticBatchSet& batches, const StaticBatchSettings& settings)
+{
+    UnloadStaticBatches(batches);
+
+    int maxVertices = std::clamp(settings.MaxVertices, 3, 65535);
+
+    // one open batch per material, kept in first use order so the batch order does not depend on the hash
+    std::vector<BatchBuilder> builders;
+    std::unordered_map<BatchKey, size_t, BatchKeyHash> open;
+
+    for (const MeshSceneObject* node : scene.Meshes)
+    {
+        if (node->Meshes.empty() || (settings.IsStatic && !settings.IsStatic(*node)))
+            continue;
+
+        bool batchable = true;
+        for (const auto& instance : node->Meshes)
+            batchable &= CanBatch(instance, maxVertices);
+
+        if (!batchable)
+            continue;
+
+        for (size_t i = 0; i < node->Meshes.size(); i++)
+        {
+            const auto& instance = node->Meshes[i];
+            auto [itr, added] = open.try_emplace(GetBatchKey(instance), builders.size());
+            if (added)
+                builders.emplace_back();
+
+            BatchBuilder& builder = builders[itr->second];
+
+            // a full batch is closed and the material starts a new one
+            if (builder.VertexCount() + instance.MeshData->vertexCount > maxVertices)
+            {
+                batches.Batches.push_back(FinishBatch(builder));
+                builder = BatchBuilder();
+            }
+
+            if (!builder.Material)
+                builder.Material = &instance;
+
+            AppendInstance(builder, *node, i);
+        }
+
+        batches.BatchedNodes.insert(node);
+    }
+
+    for (BatchBuilder& builder : builders)
+    {
+        if (!builder.Sources.empty())
+            batches.Batches.push_back(FinishBatch(builder));
+    }
+
+    size_t sourceCount = 0;
+    for (const StaticBatch& batch : batches.Batches)
+        sourceCount += batch.Sources.size();
+
+    TraceLog(LOG_INFO, "BATCHING: merged %zu mesh instances of %zu nodes into %zu batches", sourceCount, batches.BatchedNodes.size(), batches.Batches.size());
+}
+
+void UploadStaticBatches(const Scene& scene, StaticBatchSet& batches)
+{
+    for (StaticBatch& batch : batches.Batches)
+    {
+        if (batch.MeshData->vaoId == 0)
+            UploadMesh(batch.MeshData.get(), false);
+
+        Material& material = batch.MaterialData;
+        if (material.shader.id == 0)
+        {
+            material.shader.id = rlGetShaderIdDefault();
+            material.shader.locs = rlGetShaderLocsDefault();
+        }
+
+        Texture& albedo = material.maps[MATERIAL_MAP_ALBEDO].texture;
+
+        auto texture = scene.TextureCache.find(batch.TextureHash);
+        if (batch.TextureHash != 0 && texture != scene.TextureCache.end())
+            albedo = texture->second;
+        else if (albedo.id == 0)
+            albedo.id = rlGetTextureIdDefault();
+    }
+}
+
+void DrawStaticBatches(const StaticBatchSet& batches)
+{
+    for (const StaticBatch& batch : batches.Batches)
+        DrawMesh(*batch.MeshData, batch.MaterialData, MatrixIdentity());
+}
+
+const StaticBatchSource* GetStaticBatchSource(const StaticBatch& batch, uint32_t triangle)
+{
+    auto itr = std::upper_bound(batch.Sources.begin(), batch.Sources.end(), triangle,
+        [](uint32_t value, const StaticBatchSource& source) { return value < source.FirstTriangle; });
+
+    if (itr == batch.Sources.begin())
+        return nullptr;
+
+    --itr;
+    if (triangle >= itr->FirstTriangle + itr->TriangleCount)
+        return nullptr;
+
+    return &(*itr);
+}
+
+const MeshSceneObject* PickStaticBatches(const StaticBatchSet& batches, const Ray& ray, RayCollision* collision)
+{
+    const MeshSceneObject* picked = nullptr;
+
+    RayCollision closest = { 0 };
+    closest.distance = 1e30f;
+
+    for (const StaticBatch& batch : batches.Batches)
+    {
+        const Mesh& mesh = *batch.MeshData;
+        if (!mesh.vertices || !mesh.indices)
+            continue;
+
+        if (!GetRayCollisionBox(ray, batch.Bounds).hit)
+            continue;
+
+        for (int t = 0; t < mesh.triangleCount; t++)
+        {
+            const float* v0 = mesh.vertices + mesh.indices[t * 3 + 0] * 3;
+            const float* v1 = mesh.vertices + mesh.indices[t * 3 + 1] * 3;
+            const float* v2 = mesh.vertices + mesh.indices[t * 3 + 2] * 3;
+
+            RayCollision hit = GetRayCollisionTriangle(ray, Vector3{ v0[0], v0[1], v0[2] }, Vector3{ v1[0], v1[1], v1[2] }, Vector3{ v2[0], v2[1], v2[2] });
+            if (!hit.hit || hit.distance >= closest.distance)
+                continue;
+
+            const StaticBatchSource* source = GetStaticBatchSource(batch, uint32_t(t));
+            if (!source)
+                continue;
+
+            closest = hit;
+            picked = source->Node;
+        }
+    }
+
+    if (collision)
+        *collision = picked ? closest : RayCollision{ 0 };
+
+    return picked;
+}
+
+std::unordered_set<size_t> GetStaticBatchMeshes(const StaticBatchSet& batches)
+{
+    std::unordered_set<size_t> meshes;
+    for (const StaticBatch& batch : batches.Batches)
+    {
+        for (const StaticBatchSource& source : batch.Sources)
+            meshes.insert(source.Node->Meshes[source.MeshIndex].MeshHash);
+    }
+
+    return meshes;
+}
+
+void UnloadStaticBatches(StaticBatchSet& batches)
+{
+    for (StaticBatch& batch : batches.Batches)
+    {
+        if (batch.MeshData)
+            UnloadBatchMesh(*batch.MeshData);
+
+        MemFree(batch.MaterialData.maps);
+    }
+
+    batches.Batches.clear();
+    batches.BatchedNodes.clear();
+}
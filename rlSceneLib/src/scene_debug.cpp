@@ -0,0 +1,313 @@
+#include "scene_debug.h"
+
+#include "rlgl.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    void GatherNodes(const SceneObject* node, std::vector<const SceneObject*>& nodes)
+    {
+        nodes.push_back(node);
+        for (const auto& child : node->Children)
+            GatherNodes(child.get(), nodes);
+    }
+
+    std::vector<const SceneObject*> GatherNodes(const Scene& scene)
+    {
+        std::vector<const SceneObject*> nodes;
+        for (const auto& root : scene.RootObjects)
+            GatherNodes(root.get(), nodes);
+
+        return nodes;
+    }
+
+    // world position and unit axes of a node, the scale is left out so the markers keep their size
+    struct NodeFrame
+    {
+        Vector3 Origin;
+        Vector3 Right;
+        Vector3 Up;
+        Vector3 Forward;                            // -Z, the direction glTF lights and cameras point in
+    };
+
+    NodeFrame GetNodeFrame(const Matrix& world)
+    {
+        NodeFrame frame;
+        frame.Origin = Vector3{ world.m12, world.m13, world.m14 };
+        frame.Right = Vector3Normalize(Vector3{ world.m0, world.m1, world.m2 });
+        frame.Up = Vector3Normalize(Vector3{ world.m4, world.m5, world.m6 });
+        frame.Forward = Vector3Negate(Vector3Normalize(Vector3{ world.m8, world.m9, world.m10 }));
+        return frame;
+    }
+
+    struct DebugBuilder
+    {
+        const DebugGeometrySettings& Settings;
+        std::vector<DebugVertex>& Lines;
+        std::vector<DebugVertex>& Triangles;
+
+        void AddLine(const Vector3& start, const Vector3& end, Color color)
+        {
+            Lines.push_back(DebugVertex{ start, color });
+            Lines.push_back(DebugVertex{ end, color });
+        }
+
+        void AddTriangle(const Vector3& v1, const Vector3& v2, const Vector3& v3, Color color)
+        {
+            Triangles.push_back(DebugVertex{ v1, color });
+            Triangles.push_back(DebugVertex{ v2, color });
+            Triangles.push_back(DebugVertex{ v3, color });
+        }
+
+        // circle in the plane of two unit axes
+        void AddCircle(const Vector3& center, const Vector3& axisA, const Vector3& axisB, float radius, Color color)
+        {
+            int segments = std::max(Settings.CircleSegments, 3);
+
+            Vector3 last = Vector3Add(center, Vector3Scale(axisA, radius));
+            for (int i = 1; i <= segments; i++)
+            {
+                float angle = (2 * PI * i) / segments;
+                Vector3 offset = Vector3Add(Vector3Scale(axisA, cosf(angle) * radius), Vector3Scale(axisB, sinf(angle) * radius));
+                Vector3 point = Vector3Add(center, offset);
+                AddLine(last, point, color);
+                last = point;
+            }
+        }
+
+        // small solid marker at a light position
+        void AddOctahedron(const Vector3& center, float size, Color color)
+        {
+            Vector3 points[6] =
+            {
+                Vector3Add(center, Vector3{ size, 0, 0 }),
+                Vector3Add(center, Vector3{ -size, 0, 0 }),
+                Vector3Add(center, Vector3{ 0, size, 0 }),
+                Vector3Add(center, Vector3{ 0, -size, 0 }),
+                Vector3Add(center, Vector3{ 0, 0, size }),
+                Vector3Add(center, Vector3{ 0, 0, -size }),
+            };
+
+            // counter clockwise from outside, so back face culling can stay on
+            AddTriangle(points[0], points[2], points[4], color);
+            AddTriangle(points[4], points[2], points[1], color);
+            AddTriangle(points[1], points[2], points[5], color);
+            AddTriangle(points[5], points[2], points[0], color);
+            AddTriangle(points[0], points[4], points[3], color);
+            AddTriangle(points[4], points[1], points[3], color);
+            AddTriangle(points[1], points[5], points[3], color);
+            AddTriangle(points[5], points[0], points[3], color);
+        }
+
+        void AddAxes(const NodeFrame& frame)
+        {
+            float length = Settings.AxisLength;
+            AddLine(Vector3Add(frame.Origin, Vector3Scale(frame.Right, length)), Vector3Subtract(frame.Origin, Vector3Scale(frame.Right, length)), RED);
+            AddLine(Vector3Add(frame.Origin, Vector3Scale(frame.Up, length)), Vector3Subtract(frame.Origin, Vector3Scale(frame.Up, length)), GREEN);
+            AddLine(Vector3Add(frame.Origin, Vector3Scale(frame.Forward, length)), Vector3Subtract(frame.Origin, Vector3Scale(frame.Forward, length)), BLUE);
+        }
+
+        // the local box through the full world matrix, so rotated nodes show their oriented bounds
+        void AddBounds(const MeshSceneObject& mesh)
+        {
+            const BoundingBox& box = mesh.Bounds;
+
+            Vector3 corners[8];
+            for (int i = 0; i < 8; i++)
+            {
+                Vector3 corner = { (i & 1) ? box.max.x : box.min.x, (i & 2) ? box.max.y : box.min.y, (i & 4) ? box.max.z : box.min.z };
+                corners[i] = Vector3Transform(corner, mesh.WorldMatrix);
+            }
+
+            // corners that differ in one bit share an edge
+            for (int i = 0; i < 8; i++)
+            {
+                for (int bit = 1; bit < 8; bit <<= 1)
+                {
+                    if (!(i & bit))
+                        AddLine(corners[i], corners[i | bit], GREEN);
+                }
+            }
+        }
+
+        void AddLight(const LightSceneObject& light, const NodeFrame& frame)
+        {
+            float size = Settings.LightSize;
+
+            switch (light.LightType)
+            {
+            case LightSceneObject::LightTypes::Directional:
+            {
+                // an arrow along the light direction
+                Vector3 tip = Vector3Add(frame.Origin, Vector3Scale(frame.Forward, size * 4));
+                Vector3 back = Vector3Subtract(tip, Vector3Scale(frame.Forward, size));
+                AddLine(frame.Origin, tip, light.EmissiveColor);
+                AddLine(tip, Vector3Add(back, Vector3Scale(frame.Right, size * 0.5f)), light.EmissiveColor);
+                AddLine(tip, Vector3Subtract(back, Vector3Scale(frame.Right, size * 0.5f)), light.EmissiveColor);
+                AddLine(tip, Vector3Add(back, Vector3Scale(frame.Up, size * 0.5f)), light.EmissiveColor);
+                AddLine(tip, Vector3Subtract(back, Vector3Scale(frame.Up, size * 0.5f)), light.EmissiveColor);
+                AddCircle(frame.Origin, frame.Right, frame.Up, size, light.EmissiveColor);
+                break;
+            }
+
+            case LightSceneObject::LightTypes::Spot:
+            {
+                AddOctahedron(frame.Origin, size * 0.5f, light.EmissiveColor);
+
+                // the outer cone out to the range
+                float cone = std::clamp(light.MaxCone, 0.0f, PI * 0.45f);
+                float radius = light.Range * tanf(cone);
+                Vector3 center = Vector3Add(frame.Origin, Vector3Scale(frame.Forward, light.Range));
+                AddCircle(center, frame.Right, frame.Up, radius, light.EmissiveColor);
+                AddLine(frame.Origin, Vector3Add(center, Vector3Scale(frame.Right, radius)), light.EmissiveColor);
+                AddLine(frame.Origin, Vector3Subtract(center, Vector3Scale(frame.Right, radius)), light.EmissiveColor);
+                AddLine(frame.Origin, Vector3Add(center, Vector3Scale(frame.Up, radius)), light.EmissiveColor);
+                AddLine(frame.Origin, Vector3Subtract(center, Vector3Scale(frame.Up, radius)), light.EmissiveColor);
+                break;
+            }
+
+            case LightSceneObject::LightTypes::Point:
+            {
+                AddOctahedron(frame.Origin, size * 0.5f, light.EmissiveColor);
+
+                // the range sphere as three world aligned circles
+                Color range = ColorAlpha(light.EmissiveColor, 0.25f);
+                AddCircle(frame.Origin, Vector3{ 1, 0, 0 }, Vector3{ 0, 1, 0 }, light.Range, range);
+                AddCircle(frame.Origin, Vector3{ 0, 1, 0 }, Vector3{ 0, 0, 1 }, light.Range, range);
+                AddCircle(frame.Origin, Vector3{ 0, 0, 1 }, Vector3{ 1, 0, 0 }, light.Range, range);
+                break;
+            }
+
+            default:
+                break;
+            }
+        }
+
+        void AddCamera(const CameraSceneObject& camera, const NodeFrame& frame)
+        {
+            float tangent = tanf(camera.FOV * DEG2RAD * 0.5f);
+
+            Vector3 corners[2][4];
+            float depths[2] = { Settings.CameraNear, Settings.CameraFar };
+            for (int plane = 0; plane < 2; plane++)
+            {
+                float halfHeight = depths[plane] * tangent;
+                float halfWidth = halfHeight * Settings.CameraAspect;
+
+                Vector3 center = Vector3Add(frame.Origin, Vector3Scale(frame.Forward, depths[plane]));
+                Vector3 right = Vector3Scale(frame.Right, halfWidth);
+                Vector3 up = Vector3Scale(frame.Up, halfHeight);
+
+                corners[plane][0] = Vector3Subtract(Vector3Subtract(center, right), up);
+                corners[plane][1] = Vector3Subtract(Vector3Add(center, right), up);
+                corners[plane][2] = Vector3Add(Vector3Add(center, right), up);
+                corners[plane][3] = Vector3Add(Vector3Subtract(center, right), up);
+            }
+
+            for (int i = 0; i < 4; i++)
+            {
+                AddLine(corners[0][i], corners[0][(i + 1) % 4], BLACK);
+                AddLine(corners[1][i], corners[1][(i + 1) % 4], BLACK);
+                AddLine(corners[0][i], corners[1][i], BLACK);
+            }
+
+            // a filled triangle over the far plane shows which way is up
+            Vector3 top = Vector3Lerp(corners[1][2], corners[1][3], 0.5f);
+            float halfWidth = Vector3Distance(corners[1][2], corners[1][3]) * 0.25f;
+            AddTriangle(Vector3Subtract(top, Vector3Scale(frame.Right, halfWidth)), Vector3Add(top, Vector3Scale(frame.Right, halfWidth)), Vector3Add(top, Vector3Scale(frame.Up, halfWidth)), BLACK);
+        }
+    };
+
+    void DrawVertices(const std::vector<DebugVertex>& vertices, int mode, size_t verticesPerPrimitive)
+    {
+        // whole primitives per chunk, so a full rlgl batch is never flushed in the middle of one
+        const size_t chunkSize = 4096 - 4096 % verticesPerPrimitive;
+
+        for (size_t start = 0; start < vertices.size(); start += chunkSize)
+        {
+            size_t count = std::min(chunkSize, vertices.size() - start);
+            rlCheckRenderBatchLimit(int(count));
+
+            rlBegin(mode);
+            for (size_t i = start; i < start + count; i++)
+            {
+                const DebugVertex& vertex = vertices[i];
+                rlColor4ub(vertex.Tint.r, vertex.Tint.g, vertex.Tint.b, vertex.Tint.a);
+                rlVertex3f(vertex.Position.x, vertex.Position.y, vertex.Position.z);
+            }
+            rlEnd();
+        }
+    }
+}
+
+void BuildDebugGeometry(const Scene& scene, DebugGeometry& geometry)
+{
+    std::vector<const SceneObject*> nodes = GatherNodes(scene);
+
+    geometry.Lines.clear();
+    geometry.Triangles.clear();
+    geometry.NodeMatrices.resize(nodes.size());
+
+    DebugBuilder builder{ geometry.Settings, geometry.Lines, geometry.Triangles };
+    uint32_t categories = geometry.Settings.Categories;
+
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+        const SceneObject* node = nodes[i];
+        geometry.NodeMatrices[i] = node->WorldMatrix;
+
+        NodeFrame frame = GetNodeFrame(node->WorldMatrix);
+
+        if (categories & DebugGeometryAxes)
+            builder.AddAxes(frame);
+
+        switch (node->GetType())
+        {
+        case SceneObjectType::MeshObject:
+            if (categories & DebugGeometryBounds)
+                builder.AddBounds(*static_cast<const MeshSceneObject*>(node));
+            break;
+
+        case SceneObjectType::LightObject:
+            if (categories & DebugGeometryLights)
+                builder.AddLight(*static_cast<const LightSceneObject*>(node), frame);
+            break;
+
+        case SceneObjectType::CameraObject:
+            if (categories & DebugGeometryCameras)
+                builder.AddCamera(*static_cast<const CameraSceneObject*>(node), frame);
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    geometry.Dirty = false;
+}
+
+bool UpdateDebugGeometry(const Scene& scene, DebugGeometry& geometry)
+{
+    if (!geometry.Dirty)
+    {
+        std::vector<const SceneObject*> nodes = GatherNodes(scene);
+
+        bool moved = nodes.size() != geometry.NodeMatrices.size();
+        for (size_t i = 0; i < nodes.size() && !moved; i++)
+            moved = memcmp(&nodes[i]->WorldMatrix, &geometry.NodeMatrices[i], sizeof(Matrix)) != 0;
+
+        if (!moved)
+            return false;
+    }
+
+    BuildDebugGeometry(scene, geometry);
+    return true;
+}
+
+void DrawDebugGeometry(const DebugGeometry& geometry)
+{
+    DrawVertices(geometry.Lines, RL_LINES, 2);
+    DrawVertices(geometry.Triangles, RL_TRIANGLES, 3);
+}
@@ -0,0 +1,671 @@
+#include "scene_exporter.h"
+
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+    constexpr int ComponentByte = 5120;
+    constexpr int ComponentUnsignedByte = 5121;
+    constexpr int ComponentUnsignedShort = 5123;
+    constexpr int ComponentFloat = 5126;
+    constexpr int TargetArrayBuffer = 34962;
+    constexpr int TargetElementArrayBuffer = 34963;
+
+    void AppendFormat(std::string& out, const char* format, ...)
+    {
+        char buffer[512];
+
+        va_list args;
+        va_start(args, format);
+        vsnprintf(buffer, sizeof(buffer), format, args);
+        va_end(args);
+
+        out += buffer;
+    }
+
+    void AppendSeparator(std::string& out)
+    {
+        if (!out.empty())
+            out += ",";
+    }
+
+    // appends a quoted json string
+    void AppendString(std::string& out, std::string_view text)
+    {
+        out += '"';
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+            {
+                out += '\\';
+                out += c;
+            }
+            else if ((unsigned char)c < 0x20)
+            {
+                AppendFormat(out, "\\u%04x", (unsigned int)(unsigned char)c);
+            }
+            else
+            {
+                out += c;
+            }
+        }
+        out += '"';
+    }
+
+    struct MeshArray
+    {
+        const void* Data;
+        size_t Size;
+    };
+
+    std::vector<MeshArray> GetMeshArrays(const Mesh& mesh)
+    {
+        size_t vertexCount = size_t(mesh.vertexCount);
+        return {
+            { mesh.vertices, vertexCount * 3 * sizeof(float) },
+            { mesh.normals, vertexCount * 3 * sizeof(float) },
+            { mesh.texcoords, vertexCount * 2 * sizeof(float) },
+            { mesh.texcoords2, vertexCount * 2 * sizeof(float) },
+            { mesh.tangents, vertexCount * 4 * sizeof(float) },
+            { mesh.colors, vertexCount * 4 },
+            { mesh.indices, size_t(mesh.triangleCount) * 3 * sizeof(uint16_t) },
+        };
+    }
+
+    // hash of every array of the mesh, the scene hash of a mesh is not unique enough to merge meshes in the output
+    size_t GetMeshContentHash(const Mesh& mesh)
+    {
+        size_t hash = 14695981039346656037ull; // FNV_offset_basis
+        auto add = [&hash](const void* data, size_t size)
+            {
+                for (size_t i = 0; i < size; i++)
+                {
+                    hash ^= ((const unsigned char*)data)[i];
+                    hash *= 1099511628211ull; // FNV_prime
+                }
+            };
+
+        add(&mesh.vertexCount, sizeof(mesh.vertexCount));
+        add(&mesh.triangleCount, sizeof(mesh.triangleCount));
+        for (const MeshArray& array : GetMeshArrays(mesh))
+        {
+            unsigned char present = array.Data ? 1 : 0;
+            add(&present, 1);
+            if (array.Data)
+                add(array.Data, array.Size);
+        }
+        return hash;
+    }
+
+    bool IsSameMeshData(const Mesh& a, const Mesh& b)
+    {
+        if (&a == &b)
+            return true;
+
+        if (a.vertexCount != b.vertexCount || a.triangleCount != b.triangleCount)
+            return false;
+
+        std::vector<MeshArray> arraysA = GetMeshArrays(a);
+        std::vector<MeshArray> arraysB = GetMeshArrays(b);
+        for (size_t i = 0; i < arraysA.size(); i++)
+        {
+            if ((arraysA[i].Data == nullptr) != (arraysB[i].Data == nullptr))
+                return false;
+            if (arraysA[i].Data && memcmp(arraysA[i].Data, arraysB[i].Data, arraysA[i].Size) != 0)
+                return false;
+        }
+        return true;
+    }
+
+    struct MeshAccessors
+    {
+        const Mesh* Source = nullptr;               // the first mesh written with this content, compared on every hash match
+        int Position = -1;
+        int Normal = -1;
+        int Texcoord = -1;
+        int Texcoord2 = -1;
+        int Tangent = -1;
+        int Color = -1;
+        int Indices = -1;
+    };
+
+    class GLBWriter
+    {
+    public:
+        GLBWriter(const Scene& scene, const SceneExportSettings& settings)
+            : SourceScene(scene), Settings(settings)
+        {
+        }
+
+        bool Write(std::string_view filename)
+        {
+            std::string roots;
+            for (auto& root : SourceScene.RootObjects)
+            {
+                int node = AddNode(*root);
+                if (node < 0)
+                    return false;
+
+                AppendSeparator(roots);
+                AppendFormat(roots, "%d", node);
+            }
+
+            while (Bin.size() % 4 != 0)
+                Bin.push_back(0);
+
+            std::string json = "{\"asset\":{\"version\":\"2.0\",\"generator\":\"rlSceneLib\"},\"scene\":0";
+
+            std::string used;
+            if (UsesQuantization)
+                used += "\"KHR_mesh_quantization\"";
+            if (!Lights.empty())
+            {
+                AppendSeparator(used);
+                used += "\"KHR_lights_punctual\"";
+            }
+
+            if (!used.empty())
+                json += ",\"extensionsUsed\":[" + used + "]";
+            if (UsesQuantization)
+                json += ",\"extensionsRequired\":[\"KHR_mesh_quantization\"]";
+            if (!Lights.empty())
+                json += ",\"extensions\":{\"KHR_lights_punctual\":{\"lights\":[" + Lights + "]}}";
+
+            json += ",\"scenes\":[{\"nodes\":[" + roots + "]}]";
+
+            json += ",\"nodes\":[";
+            for (size_t i = 0; i < Nodes.size(); i++)
+            {
+                if (i > 0)
+                    json += ",";
+                json += Nodes[i];
+            }
+            json += "]";
+
+            if (!Meshes.empty())
+                json += ",\"meshes\":[" + Meshes + "]";
+            if (!Materials.empty())
+                json += ",\"materials\":[" + Materials + "]";
+            if (!Textures.empty())
+                json += ",\"textures\":[" + Textures + "],\"images\":[" + Images + "]";
+            if (!Cameras.empty())
+                json += ",\"cameras\":[" + Cameras + "]";
+            if (!Accessors.empty())
+                json += ",\"accessors\":[" + Accessors + "]";
+            if (!BufferViews.empty())
+                json += ",\"bufferViews\":[" + BufferViews + "]";
+            if (!Bin.empty())
+                AppendFormat(json, ",\"buffers\":[{\"byteLength\":%zu}]", Bin.size());
+            json += "}";
+
+            while (json.size() % 4 != 0)
+                json += ' ';
+
+            size_t totalSize = 12 + 8 + json.size() + (Bin.empty() ? 0 : 8 + Bin.size());
+
+            std::vector<unsigned char> glb;
+            glb.reserve(totalSize);
+
+            auto writeU32 = [&glb](uint32_t value)
+                {
+                    unsigned char bytes[4];
+                    memcpy(bytes, &value, 4);
+                    glb.insert(glb.end(), bytes, bytes + 4);
+                };
+
+            writeU32(0x46546C67); // "glTF"
+            writeU32(2);
+            writeU32(uint32_t(totalSize));
+
+            writeU32(uint32_t(json.size()));
+            writeU32(0x4E4F534A); // "JSON"
+            glb.insert(glb.end(), json.begin(), json.end());
+
+            if (!Bin.empty())
+            {
+                writeU32(uint32_t(Bin.size()));
+                writeU32(0x004E4942); // "BIN"
+                glb.insert(glb.end(), Bin.begin(), Bin.end());
+            }
+
+            return SaveFileData(std::string(filename).c_str(), glb.data(), int(glb.size()));
+        }
+
+    private:
+        int AddBufferView(const void* data, size_t size, int target, int stride = 0)
+        {
+            while (Bin.size() % 4 != 0)
+                Bin.push_back(0);
+
+            size_t offset = Bin.size();
+            Bin.insert(Bin.end(), (const unsigned char*)data, (const unsigned char*)data + size);
+
+            AppendSeparator(BufferViews);
+            AppendFormat(BufferViews, "{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu", offset, size);
+            if (stride > 0)
+                AppendFormat(BufferViews, ",\"byteStride\":%d", stride);
+            if (target != 0)
+                AppendFormat(BufferViews, ",\"target\":%d", target);
+            BufferViews += "}";
+
+            return BufferViewCount++;
+        }
+
+        int AddAccessor(int bufferView, int componentType, size_t count, const char* type, bool normalized, const float* min = nullptr, const float* max = nullptr)
+        {
+            AppendSeparator(Accessors);
+            AppendFormat(Accessors, "{\"bufferView\":%d,\"componentType\":%d,\"count\":%zu,\"type\":\"%s\"", bufferView, componentType, count, type);
+            if (normalized)
+                Accessors += ",\"normalized\":true";
+            if (min && max)
+                AppendFormat(Accessors, ",\"min\":[%.9g,%.9g,%.9g],\"max\":[%.9g,%.9g,%.9g]", min[0], min[1], min[2], max[0], max[1], max[2]);
+            Accessors += "}";
+
+            return AccessorCount++;
+        }
+
+        int AddTexcoords(const float* texcoords, int vertexCount)
+        {
+            bool quantize = Settings.QuantizeTexcoords;
+            for (int i = 0; i < vertexCount * 2 && quantize; i++)
+                quantize = texcoords[i] >= 0.0f && texcoords[i] <= 1.0f;
+
+            if (!quantize)
+            {
+                int view = AddBufferView(texcoords, size_t(vertexCount) * 2 * sizeof(float), TargetArrayBuffer);
+                return AddAccessor(view, ComponentFloat, vertexCount, "VEC2", false);
+            }
+
+            std::vector<uint16_t> quantized(size_t(vertexCount) * 2);
+            for (size_t i = 0; i < quantized.size(); i++)
+                quantized[i] = uint16_t(roundf(texcoords[i] * 65535.0f));
+
+            UsesQuantization = true;
+            int view = AddBufferView(quantized.data(), quantized.size() * sizeof(uint16_t), TargetArrayBuffer);
+            return AddAccessor(view, ComponentUnsignedShort, vertexCount, "VEC2", true);
+        }
+
+        // meshes are shared by content, hash is set to the key the accessors are stored under
+        const MeshAccessors* GetMeshAccessors(const Mesh& mesh, size_t& hash)
+        {
+            if (!mesh.vertices)
+            {
+                TraceLog(LOG_WARNING, "EXPORT: mesh has no CPU data, it must be exported before UnloadSceneMeshData");
+                return nullptr;
+            }
+
+            auto contentHash = MeshContentHashes.find(&mesh);
+            if (contentHash == MeshContentHashes.end())
+                contentHash = MeshContentHashes.emplace(&mesh, GetMeshContentHash(mesh)).first;
+
+            // a different mesh with the same content hash moves to the next free key
+            hash = contentHash->second;
+            for (auto itr = MeshAccessorCache.find(hash); itr != MeshAccessorCache.end(); itr = MeshAccessorCache.find(hash))
+            {
+                if (IsSameMeshData(*itr->second.Source, mesh))
+                    return &itr->second;
+
+                hash = hash * 0x9E3779B97F4A7C15ull + 1;
+            }
+
+            MeshAccessors accessors;
+            accessors.Source = &mesh;
+
+            float min[3] = { INFINITY, INFINITY, INFINITY };
+            float max[3] = { -INFINITY, -INFINITY, -INFINITY };
+            for (int v = 0; v < mesh.vertexCount; v++)
+            {
+                for (int c = 0; c < 3; c++)
+                {
+                    min[c] = fminf(min[c], mesh.vertices[v * 3 + c]);
+                    max[c] = fmaxf(max[c], mesh.vertices[v * 3 + c]);
+                }
+            }
+
+            int positionView = AddBufferView(mesh.vertices, size_t(mesh.vertexCount) * 3 * sizeof(float), TargetArrayBuffer);
+            accessors.Position = AddAccessor(positionView, ComponentFloat, mesh.vertexCount, "VEC3", false, min, max);
+
+            if (mesh.normals)
+            {
+                if (Settings.QuantizeNormals)
+                {
+                    // vertex attributes must stay 4 byte aligned, so every normal is padded to 4 bytes
+                    std::vector<int8_t> quantized(size_t(mesh.vertexCount) * 4, 0);
+                    for (int v = 0; v < mesh.vertexCount; v++)
+                    {
+                        for (int c = 0; c < 3; c++)
+                            quantized[v * 4 + c] = int8_t(roundf(fmaxf(-1.0f, fminf(1.0f, mesh.normals[v * 3 + c])) * 127.0f));
+                    }
+
+                    UsesQuantization = true;
+                    int normalView = AddBufferView(quantized.data(), quantized.size(), TargetArrayBuffer, 4);
+                    accessors.Normal = AddAccessor(normalView, ComponentByte, mesh.vertexCount, "VEC3", true);
+                }
+                else
+                {
+                    int normalView = AddBufferView(mesh.normals, size_t(mesh.vertexCount) * 3 * sizeof(float), TargetArrayBuffer);
+                    accessors.Normal = AddAccessor(normalView, ComponentFloat, mesh.vertexCount, "VEC3", false);
+                }
+            }
+
+            if (mesh.texcoords)
+                accessors.Texcoord = AddTexcoords(mesh.texcoords, mesh.vertexCount);
+
+            if (mesh.texcoords2)
+                accessors.Texcoord2 = AddTexcoords(mesh.texcoords2, mesh.vertexCount);
+
+            // generated tangents are baked into the output so the next load reads them instead
+            if (mesh.tangents)
+            {
+                if (Settings.QuantizeNormals)
+                {
+                    std::vector<int8_t> quantized(size_t(mesh.vertexCount) * 4);
+                    for (size_t i = 0; i < quantized.size(); i++)
+                        quantized[i] = int8_t(roundf(fmaxf(-1.0f, fminf(1.0f, mesh.tangents[i])) * 127.0f));
+
+                    UsesQuantization = true;
+                    int tangentView = AddBufferView(quantized.data(), quantized.size(), TargetArrayBuffer);
+                    accessors.Tangent = AddAccessor(tangentView, ComponentByte, mesh.vertexCount, "VEC4", true);
+                }
+                else
+                {
+                    int tangentView = AddBufferView(mesh.tangents, size_t(mesh.vertexCount) * 4 * sizeof(float), TargetArrayBuffer);
+                    accessors.Tangent = AddAccessor(tangentView, ComponentFloat, mesh.vertexCount, "VEC4", false);
+                }
+            }
+
+            if (mesh.colors)
+            {
+                int colorView = AddBufferView(mesh.colors, size_t(mesh.vertexCount) * 4, TargetArrayBuffer);
+                accessors.Color = AddAccessor(colorView, ComponentUnsignedByte, mesh.vertexCount, "VEC4", true);
+            }
+
+            if (mesh.indices)
+            {
+                size_t indexCount = size_t(mesh.triangleCount) * 3;
+                int indexView = AddBufferView(mesh.indices, indexCount * sizeof(uint16_t), TargetElementArrayBuffer);
+                accessors.Indices = AddAccessor(indexView, ComponentUnsignedShort, indexCount, "SCALAR", false);
+            }
+
+            return &MeshAccessorCache.insert_or_assign(hash, accessors).first->second;
+        }
+
+        int GetTexture(size_t textureHash)
+        {
+            auto itr = TextureIndices.find(textureHash);
+            if (itr != TextureIndices.end())
+                return itr->second;
+
+            int index = -1;
+
+            Image image = { 0 };
+            bool ownsImage = false;
+
+            auto cachedImage = SourceScene.ImageCache.find(textureHash);
+            if (cachedImage != SourceScene.ImageCache.end())
+            {
+                image = cachedImage->second;
+            }
+            else
+            {
+                auto texture = SourceScene.TextureCache.find(textureHash);
+                if (texture != SourceScene.TextureCache.end() && texture->second.id != 0)
+                {
+                    image = LoadImageFromTexture(texture->second);
+                    ownsImage = true;
+                }
+            }
+
+            if (image.data != nullptr)
+            {
+                int pngSize = 0;
+                unsigned char* png = ExportImageToMemory(image, ".png", &pngSize);
+                if (png)
+                {
+                    int view = AddBufferView(png, size_t(pngSize), 0);
+                    MemFree(png);
+
+                    index = TextureCount++;
+
+                    // the name keeps textures shared when the file is loaded again
+                    AppendSeparator(Images);
+                    AppendFormat(Images, "{\"name\":\"texture_%zx\",\"bufferView\":%d,\"mimeType\":\"image/png\"}", textureHash, view);
+
+                    AppendSeparator(Textures);
+                    AppendFormat(Textures, "{\"source\":%d}", index);
+                }
+            }
+
+            if (ownsImage)
+                UnloadImage(image);
+
+            TextureIndices[textureHash] = index;
+            return index;
+        }
+
+        int GetMaterial(const MeshSceneObject::MeshInstanceData& instance)
+        {
+            Color color = WHITE;
+            if (instance.MaterialData.maps)
+                color = instance.MaterialData.maps[MATERIAL_MAP_ALBEDO].color;
+
+            size_t textureHash = Settings.EmbedTextures ? instance.TextureHash : 0;
+
+            uint32_t packedColor = uint32_t(color.r) | uint32_t(color.g) << 8 | uint32_t(color.b) << 16 | uint32_t(color.a) << 24;
+            auto key = std::make_pair(packedColor, textureHash);
+
+            auto itr = MaterialIndices.find(key);
+            if (itr != MaterialIndices.end())
+                return itr->second;
+
+            int texture = textureHash != 0 ? GetTexture(textureHash) : -1;
+
+            AppendSeparator(Materials);
+            AppendFormat(Materials, "{\"pbrMetallicRoughness\":{\"baseColorFactor\":[%.6g,%.6g,%.6g,%.6g]",
+                color.r / 255.0f, color.g / 255.0f, color.b / 255.0f, color.a / 255.0f);
+            if (texture >= 0)
+                AppendFormat(Materials, ",\"baseColorTexture\":{\"index\":%d}", texture);
+            Materials += "}}";
+
+            int index = MaterialCount++;
+            MaterialIndices[key] = index;
+            return index;
+        }
+
+        // nodes that use the same meshes with the same materials share one glTF mesh
+        int GetMesh(const MeshSceneObject& meshNode)
+        {
+            std::vector<std::pair<size_t, int>> key;
+            std::string primitives;
+
+            for (auto& instance : meshNode.Meshes)
+            {
+                if (!instance.MeshData || instance.MeshData->vertexCount == 0)
+                    continue;
+
+                size_t meshKey = 0;
+                const MeshAccessors* accessors = GetMeshAccessors(*instance.MeshData, meshKey);
+                if (!accessors)
+                    return -2;
+
+                int material = GetMaterial(instance);
+                key.emplace_back(meshKey, material);
+
+                AppendSeparator(primitives);
+                AppendFormat(primitives, "{\"attributes\":{\"POSITION\":%d", accessors->Position);
+                if (accessors->Normal >= 0)
+                    AppendFormat(primitives, ",\"NORMAL\":%d", accessors->Normal);
+                if (accessors->Texcoord >= 0)
+                    AppendFormat(primitives, ",\"TEXCOORD_0\":%d", accessors->Texcoord);
+                if (accessors->Texcoord2 >= 0)
+                    AppendFormat(primitives, ",\"TEXCOORD_1\":%d", accessors->Texcoord2);
+                if (accessors->Tangent >= 0)
+                    AppendFormat(primitives, ",\"TANGENT\":%d", accessors->Tangent);
+                if (accessors->Color >= 0)
+                    AppendFormat(primitives, ",\"COLOR_0\":%d", accessors->Color);
+                primitives += "}";
+                if (accessors->Indices >= 0)
+                    AppendFormat(primitives, ",\"indices\":%d", accessors->Indices);
+                AppendFormat(primitives, ",\"material\":%d}", material);
+            }
+
+            if (key.empty())
+                return -1;
+
+            auto itr = MeshIndices.find(key);
+            if (itr != MeshIndices.end())
+                return itr->second;
+
+            AppendSeparator(Meshes);
+            Meshes += "{\"primitives\":[" + primitives + "]}";
+
+            int index = MeshCount++;
+            MeshIndices[key] = index;
+            return index;
+        }
+
+        int AddLight(const LightSceneObject& light)
+        {
+            AppendSeparator(Lights);
+            AppendFormat(Lights, "{\"color\":[%.6g,%.6g,%.6g],\"intensity\":%.6g",
+                light.EmissiveColor.r / 255.0f, light.EmissiveColor.g / 255.0f, light.EmissiveColor.b / 255.0f, light.Intensity);
+
+            switch (light.LightType)
+            {
+            case LightSceneObject::LightTypes::Directional:
+                Lights += ",\"type\":\"directional\"";
+                break;
+
+            case LightSceneObject::LightTypes::Spot:
+                AppendFormat(Lights, ",\"type\":\"spot\",\"range\":%.6g,\"spot\":{\"innerConeAngle\":%.6g,\"outerConeAngle\":%.6g}", light.Range, light.MinCone, light.MaxCone);
+                break;
+
+            default:
+                AppendFormat(Lights, ",\"type\":\"point\",\"range\":%.6g", light.Range);
+                break;
+            }
+            Lights += "}";
+
+            return LightCount++;
+        }
+
+        int AddCamera(const CameraSceneObject& camera)
+        {
+            AppendSeparator(Cameras);
+            AppendFormat(Cameras, "{\"type\":\"perspective\",\"perspective\":{\"yfov\":%.6g,\"znear\":0.01}}", camera.FOV * DEG2RAD);
+            return CameraCount++;
+        }
+
+        // returns the node index, or -1 if the node could not be written
+        int AddNode(const SceneObject& node)
+        {
+            int index = int(Nodes.size());
+            Nodes.emplace_back();
+
+            std::string json = "{";
+            if (!node.Name.empty())
+            {
+                json += "\"name\":";
+                AppendString(json, node.Name);
+                json += ",";
+            }
+
+            const PQSTransform& transform = node.Transform;
+            AppendFormat(json, "\"translation\":[%.9g,%.9g,%.9g]", transform.position.x, transform.position.y, transform.position.z);
+            AppendFormat(json, ",\"rotation\":[%.9g,%.9g,%.9g,%.9g]", transform.rotation.x, transform.rotation.y, transform.rotation.z, transform.rotation.w);
+            AppendFormat(json, ",\"scale\":[%.9g,%.9g,%.9g]", transform.scale.x, transform.scale.y, transform.scale.z);
+
+            switch (node.GetType())
+            {
+            case SceneObjectType::MeshObject:
+            {
+                int mesh = GetMesh(static_cast<const MeshSceneObject&>(node));
+                if (mesh == -2)
+                    return -1;
+                if (mesh >= 0)
+                    AppendFormat(json, ",\"mesh\":%d", mesh);
+                break;
+            }
+
+            case SceneObjectType::LightObject:
+                AppendFormat(json, ",\"extensions\":{\"KHR_lights_punctual\":{\"light\":%d}}", AddLight(static_cast<const LightSceneObject&>(node)));
+                break;
+
+            case SceneObjectType::CameraObject:
+                AppendFormat(json, ",\"camera\":%d", AddCamera(static_cast<const CameraSceneObject&>(node)));
+                break;
+
+            default:
+                break;
+            }
+
+            std::string children;
+            for (auto& child : node.Children)
+            {
+                int childIndex = AddNode(*child);
+                if (childIndex < 0)
+                    return -1;
+
+                AppendSeparator(children);
+                AppendFormat(children, "%d", childIndex);
+            }
+
+            if (!children.empty())
+                json += ",\"children\":[" + children + "]";
+            json += "}";
+
+            Nodes[index] = std::move(json);
+            return index;
+        }
+
+        const Scene& SourceScene;
+        SceneExportSettings Settings;
+
+        std::vector<unsigned char> Bin;
+
+        std::string BufferViews;
+        std::string Accessors;
+        std::string Meshes;
+        std::string Materials;
+        std::string Textures;
+        std::string Images;
+        std::string Cameras;
+        std::string Lights;
+        std::vector<std::string> Nodes;
+
+        int BufferViewCount = 0;
+        int AccessorCount = 0;
+        int MeshCount = 0;
+        int MaterialCount = 0;
+        int TextureCount = 0;
+        int CameraCount = 0;
+        int LightCount = 0;
+
+        bool UsesQuantization = false;
+
+        std::unordered_map<size_t, MeshAccessors> MeshAccessorCache;
+        std::unordered_map<const Mesh*, size_t> MeshContentHashes;
+        std::unordered_map<size_t, int> TextureIndices;
+        std::map<std::pair<uint32_t, size_t>, int> MaterialIndices;
+        std::map<std::vector<std::pair<size_t, int>>, int> MeshIndices;
+    };
+}
+
+bool ExportSceneToGLB(const Scene& scene, std::string_view filename, const SceneExportSettings& settings)
+{
+    GLBWriter writer(scene, settings);
+    if (!writer.Write(filename))
+    {
+        TraceLog(LOG_WARNING, "EXPORT: unable to write %s", std::string(filename).c_str());
+        return false;
+    }
+
+    return true;
+}
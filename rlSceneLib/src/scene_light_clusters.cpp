@@ -0,0 +1,420 @@
+#include "scene_light_clusters.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+namespace
+{
+    // bounds of a light in view space, depth is positive in front of the camera
+    struct LightVolume
+    {
+        int Light = 0;                              // index into LightClusterGrid::Lights
+
+        Vector3 Center = { 0 };                     // bounding sphere
+        float Radius = 0;
+
+        bool Spot = false;
+        Vector3 Apex = { 0 };
+        Vector3 Direction = { 0 };
+        float Range = 0;
+        float CosOuter = 0;
+        float SinOuter = 0;
+
+        int TileMin[2] = { 0, 0 };
+        int TileMax[2] = { 0, 0 };
+        int SliceMin = 0;
+        int SliceMax = 0;
+    };
+
+    struct ClusterFrame
+    {
+        float TanHalfY = 0;                         // half height of the view at depth 1, or the fixed half height for orthographic cameras
+        float Aspect = 1;
+        bool Orthographic = false;
+
+        float HalfHeight(float depth) const { return Orthographic ? TanHalfY : TanHalfY * depth; }
+    };
+
+    float GetSliceDepth(const LightClusterSettings& settings, int slice)
+    {
+        return settings.NearDepth * powf(settings.FarDepth / settings.NearDepth, float(slice) / float(settings.Slices));
+    }
+
+    int GetDepthSlice(const LightClusterGrid& grid, float depth)
+    {
+        if (depth <= grid.Settings.NearDepth)
+            return 0;
+
+        int slice = int(floorf(logf(depth) * grid.SliceScale - grid.SliceBias));
+        return std::clamp(slice, 0, grid.Settings.Slices - 1);
+    }
+
+    // bounding sphere of a cone, tighter than the sphere around the apex for narrow cones
+    void GetConeBounds(LightVolume& volume)
+    {
+        float angle = acosf(volume.CosOuter);
+        if (angle <= PI / 4)
+        {
+            volume.Radius = volume.Range / (2.0f * volume.CosOuter);
+            volume.Center = Vector3Add(volume.Apex, Vector3Scale(volume.Direction, volume.Radius));
+        }
+        else
+        {
+            volume.Radius = volume.Range * volume.SinOuter;
+            volume.Center = Vector3Add(volume.Apex, Vector3Scale(volume.Direction, volume.Range * volume.CosOuter));
+        }
+    }
+
+    // conservative range of tiles the sphere covers on screen
+    void GetTileRange(const LightClusterSettings& settings, const ClusterFrame& frame, LightVolume& volume)
+    {
+        float nearDepth = volume.Center.z - volume.Radius;
+        float farDepth = volume.Center.z + volume.Radius;
+
+        float ndc[4] = { -1, 1, -1, 1 };                // min x, max x, min y, max y
+        if (frame.Orthographic || nearDepth > 0.001f)
+        {
+            float depths[2] = { frame.Orthographic ? 1.0f : nearDepth, frame.Orthographic ? 1.0f : farDepth };
+
+            ndc[0] = ndc[2] = 1;
+            ndc[1] = ndc[3] = -1;
+            for (float depth : depths)
+            {
+                float halfHeight = frame.HalfHeight(depth);
+                float halfWidth = halfHeight * frame.Aspect;
+
+                ndc[0] = std::min(ndc[0], (volume.Center.x - volume.Radius) / halfWidth);
+                ndc[1] = std::max(ndc[1], (volume.Center.x + volume.Radius) / halfWidth);
+                ndc[2] = std::min(ndc[2], (volume.Center.y - volume.Radius) / halfHeight);
+                ndc[3] = std::max(ndc[3], (volume.Center.y + volume.Radius) / halfHeight);
+            }
+        }
+
+        auto toTile = [](float value, int count) { return std::clamp(int(floorf((value * 0.5f + 0.5f) * float(count))), 0, count - 1); };
+
+        volume.TileMin[0] = toTile(ndc[0], settings.TilesX);
+        volume.TileMax[0] = toTile(ndc[1], settings.TilesX);
+        volume.TileMin[1] = toTile(ndc[2], settings.TilesY);
+        volume.TileMax[1] = toTile(ndc[3], settings.TilesY);
+    }
+
+    bool SphereIntersectsBox(const Vector3& center, float radius, const BoundingBox& box)
+    {
+        float dx = std::max(0.0f, std::max(box.min.x - center.x, center.x - box.max.x));
+        float dy = std::max(0.0f, std::max(box.min.y - center.y, center.y - box.max.y));
+        float dz = std::max(0.0f, std::max(box.min.z - center.z, center.z - box.max.z));
+        return dx * dx + dy * dy + dz * dz <= radius * radius;
+    }
+
+    // cone against the bounding sphere of the cluster
+    bool ConeIntersectsSphere(const LightVolume& volume, const Vector3& center, float radius)
+    {
+        Vector3 v = Vector3Subtract(center, volume.Apex);
+        float lengthSq = Vector3DotProduct(v, v);
+        float along = Vector3DotProduct(v, volume.Direction);
+        float across = sqrtf(std::max(0.0f, lengthSq - along * along));
+
+        float distance = volume.CosOuter * across - along * volume.SinOuter;
+
+        return !(distance > radius || along > radius + volume.Range || along < -radius);
+    }
+
+    BoundingBox GetClusterBox(const LightClusterSettings& settings, const ClusterFrame& frame, int x, int y, int slice)
+    {
+        float nearDepth = GetSliceDepth(settings, slice);
+        float farDepth = GetSliceDepth(settings, slice + 1);
+
+        float ndcX0 = float(x) / float(settings.TilesX) * 2.0f - 1.0f;
+        float ndcX1 = float(x + 1) / float(settings.TilesX) * 2.0f - 1.0f;
+        float ndcY0 = float(y) / float(settings.TilesY) * 2.0f - 1.0f;
+        float ndcY1 = float(y + 1) / float(settings.TilesY) * 2.0f - 1.0f;
+
+        BoundingBox box = { Vector3{ 1e30f, 1e30f, nearDepth }, Vector3{ -1e30f, -1e30f, farDepth } };
+        for (float depth : { nearDepth, farDepth })
+        {
+            float halfHeight = frame.HalfHeight(depth);
+            float halfWidth = halfHeight * frame.Aspect;
+
+            box.min.x = std::min(box.min.x, std::min(ndcX0 * halfWidth, ndcX1 * halfWidth));
+            box.max.x = std::max(box.max.x, std::max(ndcX0 * halfWidth, ndcX1 * halfWidth));
+            box.min.y = std::min(box.min.y, std::min(ndcY0 * halfHeight, ndcY1 * halfHeight));
+            box.max.y = std::max(box.max.y, std::max(ndcY0 * halfHeight, ndcY1 * halfHeight));
+        }
+
+        return box;
+    }
+}
+
+// glTF lights without a range never reach zero, they end where the shader attenuation 1 / (d^2 + 1) drops the brightest
+// channel below the cutoff, so exports without ranges do not put every light into every cluster
+static float GetCutoffRange(const LightSceneObject& light, float cutoff)
+{
+    float brightest = std::max({ light.EmissiveColor.r, light.EmissiveColor.g, light.EmissiveColor.b }) / 255.0f * light.Intensity;
+    return sqrtf(std::max(brightest / cutoff - 1.0f, 0.0f)) + 1e-3f;
+}
+
+void BuildLightClusters(LightClusterGrid& grid, const std::vector<LightSceneObject*>& lights, const Camera3D& camera, float aspect)
+{
+    LightClusterSettings& settings = grid.Settings;
+    settings.TilesX = std::max(1, settings.TilesX);
+    settings.TilesY = std::max(1, settings.TilesY);
+    settings.Slices = std::max(1, settings.Slices);
+
+    float depthRange = logf(settings.FarDepth / settings.NearDepth);
+    grid.SliceScale = float(settings.Slices) / depthRange;
+    grid.SliceBias = float(settings.Slices) * logf(settings.NearDepth) / depthRange;
+
+    ClusterFrame frame;
+    frame.Aspect = aspect;
+    frame.Orthographic = camera.projection == CAMERA_ORTHOGRAPHIC;
+    frame.TanHalfY = frame.Orthographic ? camera.fovy * 0.5f : tanf(camera.fovy * DEG2RAD * 0.5f);
+
+    Matrix view = MatrixLookAt(camera.position, camera.target, camera.up);
+
+    float cutoff = std::max(settings.CutoffIntensity, 1e-6f);
+
+    grid.Lights.clear();
+    grid.DirectionalCount = 0;
+
+    // directional lights go first so the shader can loop over them without the grid
+    std::vector<LightVolume> volumes;
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (const LightSceneObject* light : lights)
+        {
+            bool directional = light->LightType == LightSceneObject::LightTypes::Directional;
+            if (directional != (pass == 0))
+                continue;
+
+            Vector3 position = Vector3Transform(Vector3Zeros, light->WorldMatrix);
+            Vector3 direction = Vector3Normalize(Vector3Subtract(Vector3Transform(Vector3{ 0, 0, -1 }, light->WorldMatrix), position));
+
+            ClusterLight data = {};
+            data.Position[0] = position.x;
+            data.Position[1] = position.y;
+            data.Position[2] = position.z;
+            data.Range = light->Range > 0 ? light->Range : GetCutoffRange(*light, cutoff);
+            data.Color[0] = light->EmissiveColor.r / 255.0f;
+            data.Color[1] = light->EmissiveColor.g / 255.0f;
+            data.Color[2] = light->EmissiveColor.b / 255.0f;
+            data.Intensity = light->Intensity;
+            data.Direction[0] = direction.x;
+            data.Direction[1] = direction.y;
+            data.Direction[2] = direction.z;
+            data.CosOuter = cosf(light->MaxCone);
+            data.CosInner = cosf(light->MinCone);
+            data.Type = float(int(light->LightType));
+
+            if (directional)
+            {
+                grid.Lights.push_back(data);
+                grid.DirectionalCount++;
+                continue;
+            }
+
+            LightVolume volume;
+            volume.Light = int(grid.Lights.size());
+
+            // view space with depth flipped to be positive
+            Vector3 viewPosition = Vector3Transform(position, view);
+            viewPosition.z = -viewPosition.z;
+
+            float range = data.Range;
+
+            volume.Center = viewPosition;
+            volume.Radius = range;
+
+            if (light->LightType == LightSceneObject::LightTypes::Spot && light->MaxCone > 0 && light->MaxCone < PI / 2)
+            {
+                Vector3 viewDirection = Vector3Subtract(Vector3Transform(Vector3Add(position, direction), view), Vector3Transform(position, view));
+                viewDirection.z = -viewDirection.z;
+
+                volume.Spot = true;
+                volume.Apex = viewPosition;
+                volume.Direction = Vector3Normalize(viewDirection);
+                volume.Range = range;
+                volume.CosOuter = cosf(light->MaxCone);
+                volume.SinOuter = sinf(light->MaxCone);
+                GetConeBounds(volume);
+            }
+
+            // behind the camera or past the grid
+            if (volume.Center.z + volume.Radius <= 0 || volume.Center.z - volume.Radius > settings.FarDepth)
+                continue;
+
+            volume.SliceMin = GetDepthSlice(grid, volume.Center.z - volume.Radius);
+            volume.SliceMax = GetDepthSlice(grid, volume.Center.z + volume.Radius);
+            GetTileRange(settings, frame, volume);
+
+            grid.Lights.push_back(data);
+            volumes.push_back(volume);
+        }
+    }
+
+    // lights bucketed by slice, so a slice only tests the lights that can reach it
+    std::vector<std::vector<int>> sliceLights(settings.Slices);
+    for (int i = 0; i < int(volumes.size()); i++)
+    {
+        for (int slice = volumes[i].SliceMin; slice <= volumes[i].SliceMax; slice++)
+            sliceLights[slice].push_back(i);
+    }
+
+    int tilesPerSlice = settings.TilesX * settings.TilesY;
+    std::vector<std::vector<uint32_t>> sliceIndices(settings.Slices);
+    std::vector<uint32_t> clusterCounts(size_t(tilesPerSlice) * settings.Slices, 0);
+
+    auto buildSlice = [&](int slice)
+        {
+            std::vector<uint32_t>& indices = sliceIndices[slice];
+            indices.clear();
+
+            // distance to the cluster relative to the light range, and the volume index
+            std::vector<std::pair<float, int>> candidates;
+
+            for (int y = 0; y < settings.TilesY; y++)
+            {
+                for (int x = 0; x < settings.TilesX; x++)
+                {
+                    BoundingBox box = GetClusterBox(settings, frame, x, y, slice);
+                    Vector3 boxCenter = Vector3Scale(Vector3Add(box.min, box.max), 0.5f);
+                    float boxRadius = Vector3Length(Vector3Subtract(box.max, boxCenter));
+
+                    uint32_t& count = clusterCounts[size_t(slice) * tilesPerSlice + size_t(y) * settings.TilesX + x];
+                    candidates.clear();
+
+                    for (int index : sliceLights[slice])
+                    {
+                        const LightVolume& volume = volumes[index];
+
+                        if (x < volume.TileMin[0] || x > volume.TileMax[0] || y < volume.TileMin[1] || y > volume.TileMax[1])
+                            continue;
+
+                        if (!SphereIntersectsBox(volume.Center, volume.Radius, box))
+                            continue;
+
+                        if (volume.Spot && !ConeIntersectsSphere(volume, boxCenter, boxRadius))
+                            continue;
+
+                        candidates.emplace_back(Vector3Distance(volume.Center, boxCenter) / volume.Radius, index);
+                    }
+
+                    // a full cluster keeps the lights that reach it the strongest instead of the first ones in the list
+                    if (int(candidates.size()) > settings.MaxLightsPerCluster)
+                    {
+                        std::nth_element(candidates.begin(), candidates.begin() + settings.MaxLightsPerCluster, candidates.end());
+                        candidates.resize(settings.MaxLightsPerCluster);
+                        std::sort(candidates.begin(), candidates.end(), [](const auto& a, const auto& b) { return a.second < b.second; });
+                    }
+
+                    for (const auto& [distance, index] : candidates)
+                    {
+                        indices.push_back(uint32_t(volumes[index].Light));
+                        count++;
+                    }
+                }
+            }
+        };
+
+    int threadCount = settings.ThreadCount > 0 ? settings.ThreadCount : int(std::max(1u, std::thread::hardware_concurrency()));
+    threadCount = std::min(threadCount, settings.Slices);
+
+    // small light counts are not worth the threads
+    if (volumes.size() < 32)
+        threadCount = 1;
+
+    std::atomic<int> nextSlice = 0;
+    auto worker = [&]()
+        {
+            for (int slice = nextSlice++; slice < settings.Slices; slice = nextSlice++)
+                buildSlice(slice);
+        };
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < threadCount; i++)
+        threads.emplace_back(worker);
+    worker();
+
+    for (auto& thread : threads)
+        thread.join();
+
+    // the per slice lists are in cluster order already, so they only need to be joined
+    grid.ClusterRanges.resize(clusterCounts.size() * 2);
+    grid.LightIndices.clear();
+
+    uint32_t offset = 0;
+    for (int slice = 0; slice < settings.Slices; slice++)
+    {
+        for (int tile = 0; tile < tilesPerSlice; tile++)
+        {
+            size_t cluster = size_t(slice) * tilesPerSlice + tile;
+            grid.ClusterRanges[cluster * 2 + 0] = offset;
+            grid.ClusterRanges[cluster * 2 + 1] = clusterCounts[cluster];
+            offset += clusterCounts[cluster];
+        }
+
+        grid.LightIndices.insert(grid.LightIndices.end(), sliceIndices[slice].begin(), sliceIndices[slice].end());
+    }
+}
+
+static void UpdateFloatTexture(Texture& texture, const std::vector<float>& data, int width, int height, int format)
+{
+    if (texture.id != 0 && texture.width == width && texture.height == height && texture.format == format)
+    {
+        UpdateTexture(texture, data.data());
+        return;
+    }
+
+    if (texture.id != 0)
+        UnloadTexture(texture);
+
+    Image image = { (void*)data.data(), width, height, 1, format };
+    texture = LoadTextureFromImage(image);
+}
+
+void UpdateLightClusterTextures(const LightClusterGrid& grid, LightClusterTextures& textures)
+{
+    const LightClusterSettings& settings = grid.Settings;
+
+    // textures can not be empty, so unused ones keep a single texel
+    int lightRows = std::max(1, int(grid.Lights.size()));
+    std::vector<float> lights(size_t(lightRows) * 16, 0.0f);
+    if (!grid.Lights.empty())
+        memcpy(lights.data(), grid.Lights.data(), grid.Lights.size() * sizeof(ClusterLight));
+
+    UpdateFloatTexture(textures.Lights, lights, 4, lightRows, PIXELFORMAT_UNCOMPRESSED_R32G32B32A32);
+
+    int tilesPerSlice = settings.TilesX * settings.TilesY;
+    std::vector<float> clusters(size_t(tilesPerSlice) * settings.Slices * 4, 0.0f);
+    for (size_t cluster = 0; cluster * 2 < grid.ClusterRanges.size(); cluster++)
+    {
+        clusters[cluster * 4 + 0] = float(grid.ClusterRanges[cluster * 2 + 0]);
+        clusters[cluster * 4 + 1] = float(grid.ClusterRanges[cluster * 2 + 1]);
+    }
+
+    UpdateFloatTexture(textures.Clusters, clusters, tilesPerSlice, settings.Slices, PIXELFORMAT_UNCOMPRESSED_R32G32B32A32);
+
+    // the index texture only grows, so the light count changing every frame does not reallocate it
+    int indexRows = std::max(1, int((grid.LightIndices.size() + LightClusterIndexTextureWidth - 1) / LightClusterIndexTextureWidth));
+    indexRows = std::max(indexRows, textures.Indices.height);
+
+    std::vector<float> indices(size_t(indexRows) * LightClusterIndexTextureWidth, 0.0f);
+    for (size_t i = 0; i < grid.LightIndices.size(); i++)
+        indices[i] = float(grid.LightIndices[i]);
+
+    UpdateFloatTexture(textures.Indices, indices, LightClusterIndexTextureWidth, indexRows, PIXELFORMAT_UNCOMPRESSED_R32);
+}
+
+void UnloadLightClusterTextures(LightClusterTextures& textures)
+{
+    if (textures.Lights.id != 0)
+        UnloadTexture(textures.Lights);
+    if (textures.Clusters.id != 0)
+        UnloadTexture(textures.Clusters);
+    if (textures.Indices.id != 0)
+        UnloadTexture(textures.Indices);
+
+    textures = LightClusterTextures();
+}
@@ -3,15 +3,159 @@
 #include "raylib.h"
 #include "external/cgltf.h"
 
+#include "meshopt_decoder.h"
+#include "mesh_utils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <type_traits>
 #include <unordered_map>
+#include <unordered_set>
 
-ResolveTextureCallback TextureResolver = nullptr;
+// the free functions load with this loader, it does not cache images so memory use stays the same as loading by hand
+static SceneLoader& GetDefaultLoader()
+{
+    static SceneLoader loader(SceneLoaderOptions{ .CacheImages = false });
+    return loader;
+}
+
+// state of the load in progress, per thread so separate scenes can load in parallel
+thread_local SceneLoader* CurrentLoader = nullptr;
+thread_local bool HeadlessLoad = false;
+thread_local std::string SceneFileName;
+
+// position accessors of normal mapped primitives, and the meshes of this load that wait for generated tangents
+thread_local std::unordered_set<const cgltf_accessor*> NormalMappedPositions;
+thread_local std::vector<Mesh*> PendingTangents;
 
-std::string_view SceneFileName;
+thread_local LoadStats CurrentStats;
+thread_local bool CollectStats = false;
+thread_local size_t ResidentBytes = 0;
+thread_local std::unordered_map<const void*, size_t> ResidentBlocks;  // sizes of tracked blocks that are released during the load
 
 void SetTextureResolver(ResolveTextureCallback resolver)
 {
-    TextureResolver = resolver;
+    GetDefaultLoader().Options.TextureResolver = resolver;
+}
+
+void SetMeshStorageLayout(MeshStorageLayout layout)
+{
+    GetDefaultLoader().Options.StorageLayout = layout;
+}
+
+void SetHeadlessLoading(bool headless)
+{
+    GetDefaultLoader().Options.Headless = headless;
+}
+
+bool IsHeadlessLoading()
+{
+    return GetDefaultLoader().Options.Headless;
+}
+
+void SetLoadOptions(const LoadOptions& options)
+{
+    GetDefaultLoader().Options.Content = options;
+}
+
+void SetLoadPhaseCallback(LoadPhaseCallback callback)
+{
+    GetDefaultLoader().Options.PhaseCallback = callback;
+}
+
+const char* GetLoadPhaseName(LoadPhase phase)
+{
+    switch (phase)
+    {
+    case LoadPhase::Parse: return "parse";
+    case LoadPhase::BufferLoad: return "buffer_load";
+    case LoadPhase::Decompress: return "decompress";
+    case LoadPhase::Hash: return "hash";
+    case LoadPhase::Convert: return "convert";
+    case LoadPhase::Bounds: return "bounds";
+    case LoadPhase::Material: return "material";
+    case LoadPhase::Tangents: return "tangents";
+    case LoadPhase::Transform: return "transform";
+    default: return "unknown";
+    }
+}
+
+#if SCENE_LOAD_STATS
+
+// adds the time spent in a scope to a load phase, does nothing when nobody listens
+class ScopedPhaseTimer
+{
+public:
+    ScopedPhaseTimer(LoadPhase phase)
+        : Phase(phase), Active(CollectStats)
+    {
+        if (Active)
+            Start = std::chrono::steady_clock::now();
+    }
+
+    ~ScopedPhaseTimer()
+    {
+        if (Active)
+            CurrentStats.PhaseSeconds[size_t(Phase)] += std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+    }
+
+private:
+    LoadPhase Phase;
+    bool Active = false;
+    std::chrono::steady_clock::time_point Start;
+};
+
+static void TrackAllocation(size_t size)
+{
+    CurrentStats.AllocationCount++;
+    CurrentStats.AllocatedBytes += size;
+}
+
+static void TrackResident(size_t size)
+{
+    ResidentBytes += size;
+    CurrentStats.PeakResidentBytes = std::max(CurrentStats.PeakResidentBytes, ResidentBytes);
+}
+
+// for data that is freed again before the load ends, so the peak only counts what is held at the same time
+static void TrackResidentBlock(const void* data, size_t size)
+{
+    ResidentBlocks[data] = size;
+    TrackResident(size);
+}
+
+static void ReleaseResidentBlock(const void* data)
+{
+    auto itr = ResidentBlocks.find(data);
+    if (itr == ResidentBlocks.end())
+        return;
+
+    ResidentBytes -= itr->second;
+    ResidentBlocks.erase(itr);
+}
+
+#define PHASE_TIMER(phase) ScopedPhaseTimer phaseTimer(phase)
+#define LOAD_STAT(statement) if (CollectStats) { statement; }
+
+#else
+
+#define PHASE_TIMER(phase)
+#define LOAD_STAT(statement)
+
+#endif
+
+// decoded data of compressed buffer views lives in the view itself
+static const unsigned char* GetBufferViewData(const cgltf_buffer_view* view)
+{
+    if (view->data)
+        return (const unsigned char*)view->data;
+
+    if (!view->buffer->data)
+        return nullptr;
+
+    return (const unsigned char*)view->buffer->data + view->offset;
 }
 
 // Load image from different glTF provided methods (uri, path, buffer_view)
@@ -22,16 +166,16 @@ static Image LoadImageFromCgltfImage(cgltf_image* cgltfImage, const char* texPat
     if (cgltfImage == NULL)
         return GenImageChecked(32, 32, 16, 16, GRAY, LIGHTGRAY);
 
-    if ((cgltfImage->buffer_view != NULL) && (cgltfImage->buffer_view->buffer->data != NULL))    // Check if image is provided as data buffer
+    if ((cgltfImage->buffer_view != NULL) && (GetBufferViewData(cgltfImage->buffer_view) != NULL))    // Check if image is provided as data buffer
     {
         unsigned char* data = (unsigned char*)MemAlloc(uint32_t(cgltfImage->buffer_view->size));
-        int offset = (int)cgltfImage->buffer_view->offset;
+        int offset = 0;
         int stride = (int)cgltfImage->buffer_view->stride ? (int)cgltfImage->buffer_view->stride : 1;
 
         // Copy buffer data to memory for loading
         for (unsigned int i = 0; i < cgltfImage->buffer_view->size; i++)
         {
-            data[i] = ((unsigned char*)cgltfImage->buffer_view->buffer->data)[offset];
+            data[i] = GetBufferViewData(cgltfImage->buffer_view)[offset];
             offset += stride;
         }
 
@@ -62,7 +206,7 @@ static Image LoadImageFromCgltfImage(cgltf_image* cgltfImage, const char* texPat
 #define LOAD_ATTRIBUTE_CAST(accesor, numComp, srcType, dstPtr, dstType) \
     { \
         int n = 0; \
-        srcType *buffer = (srcType *)accesor->buffer_view->buffer->data + accesor->buffer_view->offset/sizeof(srcType) + accesor->offset/sizeof(srcType); \
+        const srcType *buffer = (const srcType *)(GetBufferViewData(accesor->buffer_view) + accesor->offset); \
         for (unsigned int k = 0; k < accesor->count; k++) \
         {\
             for (int l = 0; l < numComp; l++) \
@@ -81,6 +225,8 @@ static cgltf_result LoadFileGLTFCallback(const struct cgltf_memory_options* memo
 
     if (filedata == NULL) return cgltf_result_io_error;
 
+    LOAD_STAT(CurrentStats.BytesRead += size_t(filesize); TrackResidentBlock(filedata, size_t(filesize)));
+
     *size = filesize;
     *data = filedata;
 
@@ -90,55 +236,223 @@ static cgltf_result LoadFileGLTFCallback(const struct cgltf_memory_options* memo
 // Release file data callback for cgltf
 static void ReleaseFileGLTFCallback(const struct cgltf_memory_options* memoryOptions, const struct cgltf_file_options* fileOptions, void* data)
 {
+    LOAD_STAT(ReleaseResidentBlock(data));
     UnloadFileData((unsigned char*)data);
 }
 
+// allocation callbacks for cgltf so parser allocations show up in the stats
+static void* AllocGLTFCallback(void* user, cgltf_size size)
+{
+    void* data = MemAlloc((unsigned int)size);
+    LOAD_STAT(TrackAllocation(size_t(size)); TrackResidentBlock(data, size_t(size)));
+    return data;
+}
+
+static void FreeGLTFCallback(void* user, void* ptr)
+{
+    LOAD_STAT(ReleaseResidentBlock(ptr));
+    MemFree(ptr);
+}
+
+// decodes an EXT_meshopt_compression view into view.data, cgltf_free releases it with the free callback
+static bool DecompressBufferView(cgltf_buffer_view& view)
+{
+    const cgltf_meshopt_compression& compression = view.meshopt_compression;
+    if (!compression.buffer || !compression.buffer->data)
+        return false;
+
+    const unsigned char* source = (const unsigned char*)compression.buffer->data + compression.offset;
+
+    void* destination = MemAlloc((unsigned int)(compression.count * compression.stride));
+    if (!destination)
+        return false;
+
+    bool decoded = false;
+    switch (compression.mode)
+    {
+    case cgltf_meshopt_compression_mode_attributes:
+        decoded = DecodeMeshoptVertexBuffer(destination, compression.count, compression.stride, source, compression.size);
+        break;
+    case cgltf_meshopt_compression_mode_triangles:
+        decoded = DecodeMeshoptIndexBuffer(destination, compression.count, compression.stride, source, compression.size);
+        break;
+    case cgltf_meshopt_compression_mode_indices:
+        decoded = DecodeMeshoptIndexSequence(destination, compression.count, compression.stride, source, compression.size);
+        break;
+    default:
+        break;
+    }
+
+    if (!decoded)
+    {
+        MemFree(destination);
+        return false;
+    }
+
+    switch (compression.filter)
+    {
+    case cgltf_meshopt_compression_filter_octahedral:
+        DecodeMeshoptFilterOctahedral(destination, compression.count, compression.stride);
+        break;
+    case cgltf_meshopt_compression_filter_quaternion:
+        DecodeMeshoptFilterQuaternion(destination, compression.count, compression.stride);
+        break;
+    case cgltf_meshopt_compression_filter_exponential:
+        DecodeMeshoptFilterExponential(destination, compression.count, compression.stride);
+        break;
+    default:
+        break;
+    }
+
+    view.data = destination;
+    return true;
+}
+
+// decodes the compressed views the load reads before any attribute is read, large files spread the views over worker threads
+static bool DecompressBufferViews(cgltf_data* data, const std::unordered_set<const cgltf_buffer_view*>& usedViews)
+{
+    std::vector<cgltf_buffer_view*> views;
+    size_t compressedBytes = 0;
+
+    for (size_t i = 0; i < data->buffer_views_count; i++)
+    {
+        cgltf_buffer_view& view = data->buffer_views[i];
+        if (view.has_meshopt_compression && !view.data && usedViews.contains(&view))
+        {
+            views.push_back(&view);
+            compressedBytes += view.meshopt_compression.size;
+        }
+    }
+
+    if (views.empty())
+        return true;
+
+    // below this a thread costs more than it saves
+    constexpr size_t parallelThreshold = 256 * 1024;
+
+    size_t threadCount = compressedBytes < parallelThreshold ? 1 : std::min(views.size(), size_t(std::max(1u, std::thread::hardware_concurrency())));
+
+    std::vector<char> decoded(views.size(), 0);
+    std::atomic<size_t> nextView = 0;
+    auto worker = [&]()
+        {
+            for (size_t index = nextView++; index < views.size(); index = nextView++)
+                decoded[index] = DecompressBufferView(*views[index]) ? 1 : 0;
+        };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < threadCount; i++)
+        threads.emplace_back(worker);
+    worker();
+
+    for (auto& thread : threads)
+        thread.join();
+
+    bool result = true;
+    for (size_t i = 0; i < views.size(); i++)
+    {
+        if (!decoded[i])
+        {
+            TraceLog(LOG_WARNING, "SCENE: unable to decode compressed buffer view %d in %s", int(views[i] - data->buffer_views), SceneFileName.c_str());
+            result = false;
+            continue;
+        }
+
+        LOAD_STAT(size_t bytes = views[i]->meshopt_compression.count * views[i]->meshopt_compression.stride; TrackAllocation(bytes); TrackResidentBlock(views[i]->data, bytes));
+    }
+
+    return result;
+}
+
+static size_t GetComponentSize(cgltf_component_type type)
+{
+    switch (type)
+    {
+    case cgltf_component_type_r_8:
+    case cgltf_component_type_r_8u:
+        return 1;
+    case cgltf_component_type_r_16:
+    case cgltf_component_type_r_16u:
+        return 2;
+    default:
+        return 4;
+    }
+}
+
+// every byte of every element, the reload and the mesh cache decide on this hash whether a mesh changed
 std::size_t GetAttributeBufferHash(cgltf_accessor* accesor)
 {
-    std::size_t hash = 2166136261U; // FNV_offset_basis
+    std::size_t hash = 14695981039346656037ull; // FNV_offset_basis
 
-    int n = 0;
-    unsigned char* buffer = (unsigned char*)accesor->buffer_view->buffer->data + accesor->buffer_view->offset / sizeof(unsigned char) + accesor->offset / sizeof(unsigned char);
-    for (unsigned int k = 0; k < accesor->count; k++)
+    size_t elementSize = cgltf_num_components(accesor->type) * GetComponentSize(accesor->component_type);
+    const unsigned char* buffer = GetBufferViewData(accesor->buffer_view) + accesor->offset;
+    for (size_t k = 0; k < accesor->count; k++)
     {
-        for (int l = 0; l < 1; l++)
+        for (size_t l = 0; l < elementSize; l++)
         {
-            hash ^= (unsigned char)buffer[n + l];
-            hash *= 16777619U; // FNV_prime
+            hash ^= buffer[l];
+            hash *= 1099511628211ull; // FNV_prime
         }
-        n += (int)(accesor->stride / sizeof(unsigned char));
+        buffer += accesor->stride;
     }
-    return hash;
+    return hash ^ accesor->count;
+}
+
+// order dependent, so swapped or moved attributes do not cancel out like they would with xor
+static size_t MixHash(size_t hash, size_t value)
+{
+    return (hash ^ (value + 0x9E3779B97F4A7C15ull + (hash << 6) + (hash >> 2))) * 0xBF58476D1CE4E5B9ull;
 }
 
-size_t GetMeshHash(cgltf_primitive* primitive)
+// attributes the load options leave out are neither converted nor hashed
+static bool IsAttributeSkipped(const cgltf_attribute& attribute, uint32_t attributes)
+{
+    switch (attribute.type)
+    {
+    case cgltf_attribute_type_normal:
+        return (attributes & MeshAttributeNormals) == 0;
+    case cgltf_attribute_type_texcoord:
+        return (attributes & (attribute.index == 1 ? MeshAttributeTexcoords2 : MeshAttributeTexcoords)) == 0;
+    case cgltf_attribute_type_tangent:
+        return (attributes & MeshAttributeTangents) == 0;
+    case cgltf_attribute_type_color:
+        return (attributes & MeshAttributeColors) == 0;
+    default:
+        return false;
+    }
+}
+
+size_t GetMeshHash(cgltf_primitive* primitive, uint32_t attributes)
 {
     size_t hash = 0;
 
     for (size_t j = 0; j < primitive->attributes_count; j++)
     {
         cgltf_attribute* attribute = &primitive->attributes[j];
-        hash ^= GetAttributeBufferHash(attribute->data);
+        if (IsAttributeSkipped(*attribute, attributes))
+            continue;
+
+        hash = MixHash(hash, size_t(attribute->type) << 8 | size_t(attribute->index));
+        hash = MixHash(hash, GetAttributeBufferHash(attribute->data));
     }
 
     if (primitive->indices)
     {
-        hash ^= GetAttributeBufferHash(primitive->indices);
+        hash = MixHash(hash, ~size_t(0));
+        hash = MixHash(hash, GetAttributeBufferHash(primitive->indices));
     }
 
+    // a partial mesh must not be found when the same primitive is loaded into the scene again with all attributes
+    if (attributes != MeshAttributeAll)
+        hash ^= (size_t(attributes) + 1) * 0x9E3779B97F4A7C15ull;
+
     return hash;
 }
 
 template<class T, class F>
 void CopyBufferType(F* outBuffer, cgltf_accessor* data, int componentCount)
 {
-    T* temp = (T*)MemAlloc(int(data->count * componentCount * sizeof(T)));
-    LOAD_ATTRIBUTE(data, componentCount, T, temp);
-
-    for (size_t t = 0; t < data->count * componentCount; t++)
-        outBuffer[t] = (F)temp[t];
-
-    RL_FREE(temp);
+    LOAD_ATTRIBUTE_CAST(data, componentCount, T, outBuffer, F);
 }
 
 template<class T>
@@ -180,55 +494,167 @@ bool ConvertBufferType(T* outBuffer, cgltf_accessor* data, int componentCount, f
         return false;
     }
 
+    // normalized integers map to 0-1 or -1-1 (KHR_mesh_quantization)
+    if constexpr (std::is_floating_point_v<T>)
+    {
+        if (data->normalized)
+        {
+            switch (data->component_type)
+            {
+            case cgltf_component_type_r_8u: scale /= 255.0f; break;
+            case cgltf_component_type_r_8: scale /= 127.0f; break;
+            case cgltf_component_type_r_16u: scale /= 65535.0f; break;
+            case cgltf_component_type_r_16: scale /= 32767.0f; break;
+            default: break;
+            }
+        }
+    }
+
     if (scale != 1.0f)
     {
         for (size_t i = 0; i < data->count * componentCount; i++)
         {
             outBuffer[i] = T(outBuffer[i] * scale);
         }
+
+        // the most negative signed value is below -1 after scaling
+        if constexpr (std::is_floating_point_v<T>)
+        {
+            if (data->normalized && (data->component_type == cgltf_component_type_r_8 || data->component_type == cgltf_component_type_r_16))
+            {
+                for (size_t i = 0; i < data->count * componentCount; i++)
+                    outBuffer[i] = std::max(outBuffer[i], T(-1));
+            }
+        }
+    }
+
+    return true;
+}
+
+// COLOR_0 is RGB or RGBA as floats or normalized integers, raylib wants RGBA bytes
+static bool ConvertColors(unsigned char* outColors, cgltf_accessor* data)
+{
+    if (data->type == cgltf_type_vec4 && data->component_type == cgltf_component_type_r_8u)
+        return ConvertBufferType<unsigned char>(outColors, data, 4);
+
+    int componentCount = data->type == cgltf_type_vec3 ? 3 : 4;
+
+    std::vector<float> values(data->count * componentCount);
+    if (!ConvertBufferType<float>(values.data(), data, componentCount))
+        return false;
+
+    for (size_t v = 0; v < data->count; v++)
+    {
+        for (int c = 0; c < 4; c++)
+        {
+            float value = c < componentCount ? values[v * componentCount + c] : 1.0f;
+            outColors[v * 4 + c] = (unsigned char)(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+        }
     }
 
     return true;
 }
 
+// blocks are carved into 16 byte aligned arrays
+static size_t AlignBlockSize(size_t size)
+{
+    return (size + 15) & ~size_t(15);
+}
+
+// all CPU mesh data goes through here so it can be accounted for
+static void* AllocMeshData(size_t size)
+{
+    LOAD_STAT(TrackAllocation(size); TrackResident(size); CurrentStats.MeshDataBytes += size);
+    return MemAlloc((unsigned int)size);
+}
+
 std::shared_ptr<Mesh> CacheMesh(Scene& outScene, size_t hash, cgltf_primitive* primitive)
 {
     std::shared_ptr<Mesh> newMesh = std::make_shared<Mesh>();
 
     memset(newMesh.get(), 0, sizeof(Mesh));
 
+    cgltf_accessor* positions = nullptr;
+    cgltf_accessor* normals = nullptr;
+    cgltf_accessor* texcoords = nullptr;
+    cgltf_accessor* texcoords2 = nullptr;
+    cgltf_accessor* tangents = nullptr;
+    cgltf_accessor* colors = nullptr;
+    cgltf_accessor* indices = nullptr;
+
+    uint32_t attributes = CurrentLoader->Options.Content.Attributes;
+
     for (size_t i = 0; i < primitive->attributes_count; i++)
     {
         cgltf_attribute* attribute = &primitive->attributes[i];
+        if (IsAttributeSkipped(*attribute, attributes))
+            continue;
 
         switch (attribute->type)
         {
         case cgltf_attribute_type_position:
-            newMesh->vertexCount = (int)attribute->data->count;
-            newMesh->vertices = (float*)MemAlloc(newMesh->vertexCount * 3 * sizeof(float));
-            ConvertBufferType<float>(newMesh->vertices, attribute->data, 3);
+            positions = attribute->data;
             break;
 
         case cgltf_attribute_type_normal:
-            newMesh->normals = (float*)MemAlloc((int)attribute->data->count * 3 * sizeof(float));
-            ConvertBufferType<float>(newMesh->normals, attribute->data, 3);
+            normals = attribute->data;
             break;
 
         case cgltf_attribute_type_texcoord:
-        {
-            float* ptr = (float*)MemAlloc((int)attribute->data->count * 2 * sizeof(float));
-            ConvertBufferType<float>(ptr, attribute->data, 2);
-
             if (attribute->index == 1)
-                newMesh->texcoords2 = ptr;
-            else
-                newMesh->texcoords = ptr;
-        }
-        break;
+                texcoords2 = attribute->data;
+            else if (attribute->index == 0)
+                texcoords = attribute->data;
+            break;
+
+        case cgltf_attribute_type_tangent:
+            tangents = attribute->data;
+            break;
+
+        case cgltf_attribute_type_color:
+            if (attribute->index == 0)
+                colors = attribute->data;
+            break;
         }
     }
 
-    newMesh->triangleCount = newMesh->vertexCount / 3;
+    if (!positions)
+    {
+        outScene.MeshCache.insert_or_assign(hash, newMesh);
+        return newMesh;
+    }
+
+    newMesh->vertexCount = (int)positions->count;
+    size_t vertexCount = positions->count;
+
+    // every attribute must match the position count or it would overrun the arrays
+    if (normals && normals->count != vertexCount)
+        normals = nullptr;
+    if (texcoords && texcoords->count != vertexCount)
+        texcoords = nullptr;
+    if (texcoords2 && texcoords2->count != vertexCount)
+        texcoords2 = nullptr;
+    if (tangents && (tangents->count != vertexCount || tangents->type != cgltf_type_vec4))
+        tangents = nullptr;
+    if (colors && (colors->count != vertexCount || (colors->type != cgltf_type_vec3 && colors->type != cgltf_type_vec4)))
+        colors = nullptr;
+
+    // generated tangents get their array now so they end up in the block, they are filled once the whole file is converted
+    bool generateTangents = false;
+    if (!tangents && normals && texcoords && (attributes & MeshAttributeTangents))
+    {
+        switch (CurrentLoader->Options.Content.Tangents)
+        {
+        case TangentGeneration::NormalMapped:
+            generateTangents = NormalMappedPositions.contains(positions);
+            break;
+        case TangentGeneration::All:
+            generateTangents = true;
+            break;
+        default:
+            break;
+        }
+    }
 
     if (primitive->indices && primitive->indices->buffer_view)
     {
@@ -238,20 +664,235 @@ std::shared_ptr<Mesh> CacheMesh(Scene& outScene, size_t hash, cgltf_primitive* p
         }
         else
         {
-            newMesh->indices = (uint16_t*)MemAlloc((int)primitive->indices->count * sizeof(uint16_t));
+            indices = primitive->indices;
+        }
+    }
 
-            ConvertBufferType<uint16_t>(newMesh->indices, primitive->indices, 1);
+    MeshStorageLayout storageLayout = CurrentLoader->Options.StorageLayout;
 
-            newMesh->triangleCount = int(primitive->indices->count / 3);
-        }
+    if (storageLayout == MeshStorageLayout::Separate)
+    {
+        newMesh->vertices = (float*)AllocMeshData(vertexCount * 3 * sizeof(float));
+        if (normals)
+            newMesh->normals = (float*)AllocMeshData(vertexCount * 3 * sizeof(float));
+        if (texcoords)
+            newMesh->texcoords = (float*)AllocMeshData(vertexCount * 2 * sizeof(float));
+        if (texcoords2)
+            newMesh->texcoords2 = (float*)AllocMeshData(vertexCount * 2 * sizeof(float));
+        if (tangents || generateTangents)
+            newMesh->tangents = (float*)AllocMeshData(vertexCount * 4 * sizeof(float));
+        if (colors)
+            newMesh->colors = (unsigned char*)AllocMeshData(vertexCount * 4);
+        if (indices)
+            newMesh->indices = (uint16_t*)AllocMeshData(indices->count * sizeof(uint16_t));
     }
+    else
+    {
+        // indices go first so the vertex data can be dropped after upload by shrinking the block
+        size_t indexSize = indices ? AlignBlockSize(indices->count * sizeof(uint16_t)) : 0;
+        size_t positionSize = AlignBlockSize(vertexCount * 3 * sizeof(float));
+        size_t normalSize = normals ? AlignBlockSize(vertexCount * 3 * sizeof(float)) : 0;
+        size_t texcoordSize = texcoords ? AlignBlockSize(vertexCount * 2 * sizeof(float)) : 0;
+        size_t texcoord2Size = texcoords2 ? AlignBlockSize(vertexCount * 2 * sizeof(float)) : 0;
+        size_t tangentSize = (tangents || generateTangents) ? AlignBlockSize(vertexCount * 4 * sizeof(float)) : 0;
+        size_t colorSize = colors ? AlignBlockSize(vertexCount * 4) : 0;
+        size_t interleavedSize = (storageLayout == MeshStorageLayout::Interleaved) ? vertexCount * sizeof(InterleavedVertex) : 0;
+
+        unsigned char* block = (unsigned char*)AllocMeshData(indexSize + positionSize + normalSize + texcoordSize + texcoord2Size + tangentSize + colorSize + interleavedSize);
+        unsigned char* next = block;
+
+        if (indices)
+            newMesh->indices = (uint16_t*)next;
+        next += indexSize;
+
+        newMesh->vertices = (float*)next;
+        next += positionSize;
+
+        if (normals)
+            newMesh->normals = (float*)next;
+        next += normalSize;
+
+        if (texcoords)
+            newMesh->texcoords = (float*)next;
+        next += texcoordSize;
+
+        if (texcoords2)
+            newMesh->texcoords2 = (float*)next;
+        next += texcoord2Size;
+
+        if (tangentSize > 0)
+            newMesh->tangents = (float*)next;
+        next += tangentSize;
+
+        if (colors)
+            newMesh->colors = (unsigned char*)next;
+        next += colorSize;
+
+        MeshBlock meshBlock;
+        meshBlock.Data = block;
+        if (interleavedSize > 0)
+            meshBlock.Vertices = (InterleavedVertex*)next;
+
+        outScene.MeshBlocks.insert_or_assign(hash, meshBlock);
+    }
+
+    ConvertBufferType<float>(newMesh->vertices, positions, 3);
+
+    if (normals)
+        ConvertBufferType<float>(newMesh->normals, normals, 3);
+
+    if (texcoords)
+        ConvertBufferType<float>(newMesh->texcoords, texcoords, 2);
+
+    if (texcoords2)
+        ConvertBufferType<float>(newMesh->texcoords2, texcoords2, 2);
+
+    if (tangents)
+        ConvertBufferType<float>(newMesh->tangents, tangents, 4);
+
+    if (colors)
+        ConvertColors(newMesh->colors, colors);
+
+    if (generateTangents)
+        PendingTangents.push_back(newMesh.get());
+
+    newMesh->triangleCount = newMesh->vertexCount / 3;
+
+    if (indices)
+    {
+        ConvertBufferType<uint16_t>(newMesh->indices, indices, 1);
+        newMesh->triangleCount = int(indices->count / 3);
+    }
+
+    if (storageLayout == MeshStorageLayout::Interleaved)
+        FillInterleavedVertices(*newMesh, outScene.MeshBlocks[hash].Vertices);
 
     outScene.MeshCache.insert_or_assign(hash, newMesh);
 
     return newMesh;
 }
 
-void LoadMaterial(Material& material, const cgltf_material& gltf_mat, Scene& outScene)
+// meshes are shared between primitives, so any normal mapped primitive marks the positions it uses
+static void FindNormalMappedPrimitives(const cgltf_data* data)
+{
+    NormalMappedPositions.clear();
+
+    for (size_t m = 0; m < data->meshes_count; m++)
+    {
+        const cgltf_mesh& mesh = data->meshes[m];
+        for (size_t p = 0; p < mesh.primitives_count; p++)
+        {
+            const cgltf_primitive& primitive = mesh.primitives[p];
+            if (!primitive.material || !primitive.material->normal_texture.texture)
+                continue;
+
+            for (size_t a = 0; a < primitive.attributes_count; a++)
+            {
+                if (primitive.attributes[a].type == cgltf_attribute_type_position)
+                    NormalMappedPositions.insert(primitive.attributes[a].data);
+            }
+        }
+    }
+}
+
+// every unique mesh is generated on its own, so they are spread over the workers
+static void GeneratePendingTangents(size_t threadCount)
+{
+    size_t vertexCount = 0;
+    for (const Mesh* mesh : PendingTangents)
+        vertexCount += size_t(mesh->vertexCount);
+
+    // below this a thread costs more than it saves
+    constexpr size_t parallelThreshold = 64 * 1024;
+    if (vertexCount < parallelThreshold)
+        threadCount = 1;
+
+    threadCount = std::min(threadCount, PendingTangents.size());
+
+    std::atomic<size_t> nextMesh = 0;
+    auto worker = [&]()
+        {
+            for (size_t index = nextMesh++; index < PendingTangents.size(); index = nextMesh++)
+                GenerateMeshTangents(*PendingTangents[index]);
+        };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < threadCount; i++)
+        threads.emplace_back(worker);
+    worker();
+
+    for (auto& thread : threads)
+        thread.join();
+}
+
+// hash of the encoded bytes of an embedded image, so the same image in different files has the same hash
+static size_t GetImageDataHash(const cgltf_buffer_view* view)
+{
+    size_t hash = 2166136261U; // FNV_offset_basis
+
+    const unsigned char* data = GetBufferViewData(view);
+    for (size_t i = 0; i < view->size; i++)
+    {
+        hash ^= data[i];
+        hash *= 16777619U; // FNV_prime
+    }
+    return hash ^ view->size;
+}
+
+// cache key of an image, it changes when the image does, so a reload picks up images that were edited but kept their name
+// embedded images are keyed by their encoded bytes, external ones by their path and modification time
+static size_t GetTextureKey(const cgltf_image* image)
+{
+    if (!image)
+        return std::hash<std::string_view>()("rlSceneLoader/missing");
+
+    if (image->buffer_view && GetBufferViewData(image->buffer_view))
+        return GetImageDataHash(image->buffer_view);
+
+    if (!image->uri)
+        return std::hash<std::string_view>()("rlSceneLoader/missing");
+
+    // data uris carry the image itself
+    if (strncmp(image->uri, "data:", 5) == 0)
+        return std::hash<std::string_view>()(image->uri);
+
+    std::string path = std::string(GetDirectoryPath(SceneFileName.c_str())) + "/" + image->uri;
+    return std::hash<std::string>()(path) ^ (size_t(GetFileModTime(path.c_str())) * 0x9E3779B97F4A7C15ull);
+}
+
+// images referenced by uri go to the resolver, embedded images are shared with other loads of the same loader
+static Image LoadMaterialImage(cgltf_image* image, size_t& texHash)
+{
+    const SceneLoaderOptions& options = CurrentLoader->Options;
+
+    if (options.TextureResolver && image && image->uri && strncmp(image->uri, "data:", 5) != 0)
+    {
+        size_t resolvedHash = texHash;
+        Image resolved = options.TextureResolver(SceneFileName, image->uri, resolvedHash);
+        if (resolved.data != NULL)
+        {
+            texHash = resolvedHash;
+            return resolved;
+        }
+    }
+
+    if (!options.CacheImages || !image || !image->buffer_view || !GetBufferViewData(image->buffer_view))
+        return LoadImageFromCgltfImage(image, "");
+
+    size_t dataHash = GetImageDataHash(image->buffer_view);
+
+    Image decoded = { 0 };
+    if (CurrentLoader->GetImageCache().Find(dataHash, decoded))
+        return decoded;
+
+    decoded = LoadImageFromCgltfImage(image, "");
+    if (decoded.data != NULL)
+        CurrentLoader->GetImageCache().Add(dataHash, decoded);
+
+    return decoded;
+}
+
+void LoadMaterial(Material& material, size_t& textureHash, const cgltf_material& gltf_mat, Scene& outScene)
 {
     //	const char* texPath = GetDirectoryPath(fileName);
 
@@ -264,31 +905,61 @@ void LoadMaterial(Material& material, const cgltf_material& gltf_mat, Scene& out
         material.maps[MATERIAL_MAP_ALBEDO].color.b = (unsigned char)(gltf_mat.pbr_metallic_roughness.base_color_factor[2] * 255);
         material.maps[MATERIAL_MAP_ALBEDO].color.a = (unsigned char)(gltf_mat.pbr_metallic_roughness.base_color_factor[3] * 255);
 
-        if (gltf_mat.pbr_metallic_roughness.base_color_texture.texture)
+        TextureLoadMode textureMode = CurrentLoader->Options.Content.Textures;
+
+        if (gltf_mat.pbr_metallic_roughness.base_color_texture.texture && textureMode != TextureLoadMode::Skip)
         {
-            std::string name;
-            if (gltf_mat.pbr_metallic_roughness.base_color_texture.texture->image->name)
-            {
-                name = gltf_mat.pbr_metallic_roughness.base_color_texture.texture->image->name;
-            }
+            size_t texHash = 0;
+            if (textureMode == TextureLoadMode::Placeholder)
+                texHash = std::hash<std::string_view>()("rlSceneLoader/placeholder");
             else
-            {
-                name = TextFormat("%p", gltf_mat.pbr_metallic_roughness.base_color_texture.texture);
-            }
-
-            std::hash<std::string> hasher;
-            size_t texHash = hasher(name);
+                texHash = GetTextureKey(gltf_mat.pbr_metallic_roughness.base_color_texture.texture->image);
 
             auto itr = outScene.TextureCache.find(texHash);
             if (itr != outScene.TextureCache.end())
             {
+                LOAD_STAT(CurrentStats.TextureCacheHits++);
                 material.maps[MATERIAL_MAP_ALBEDO].texture = itr->second;
+                textureHash = texHash;
+                return;
+            }
+
+            if (outScene.ImageCache.find(texHash) != outScene.ImageCache.end())
+            {
+                LOAD_STAT(CurrentStats.TextureCacheHits++);
+                textureHash = texHash;
                 return;
             }
 
-            Image imAlbedo = LoadImageFromCgltfImage(gltf_mat.pbr_metallic_roughness.base_color_texture.texture->image, "");
+            LOAD_STAT(CurrentStats.TextureCacheMisses++);
+
+            Image imAlbedo = { 0 };
+            if (textureMode == TextureLoadMode::Placeholder)
+                imAlbedo = GenImageChecked(8, 8, 4, 4, GRAY, LIGHTGRAY);
+            else
+                imAlbedo = LoadMaterialImage(gltf_mat.pbr_metallic_roughness.base_color_texture.texture->image, texHash);
             if (imAlbedo.data != NULL)
             {
+                textureHash = texHash;
+
+                // the resolver can map several names to one image that is already loaded
+                auto loaded = outScene.TextureCache.find(texHash);
+                if (loaded != outScene.TextureCache.end() || outScene.ImageCache.find(texHash) != outScene.ImageCache.end())
+                {
+                    if (loaded != outScene.TextureCache.end())
+                        material.maps[MATERIAL_MAP_ALBEDO].texture = loaded->second;
+
+                    UnloadImage(imAlbedo);
+                    return;
+                }
+
+                // the texture is created by UploadScene
+                if (HeadlessLoad)
+                {
+                    outScene.ImageCache[texHash] = imAlbedo;
+                    return;
+                }
+
                 material.maps[MATERIAL_MAP_ALBEDO].texture = LoadTextureFromImage(imAlbedo);
                 outScene.TextureCache[texHash] = material.maps[MATERIAL_MAP_ALBEDO].texture;
                 UnloadImage(imAlbedo);
@@ -312,6 +983,62 @@ BoundingBox MergeBoundingBoxes(const BoundingBox& b1, const BoundingBox& b2)
     return result;
 }
 
+// skipped attributes are not decoded, so they are not checked
+static bool HasAccessorData(const cgltf_primitive* primitive, uint32_t attributes)
+{
+    for (size_t i = 0; i < primitive->attributes_count; i++)
+    {
+        if (IsAttributeSkipped(primitive->attributes[i], attributes))
+            continue;
+
+        const cgltf_accessor* accessor = primitive->attributes[i].data;
+        if (!accessor->buffer_view || !GetBufferViewData(accessor->buffer_view))
+            return false;
+    }
+
+    if (primitive->indices && primitive->indices->buffer_view && !GetBufferViewData(primitive->indices->buffer_view))
+        return false;
+
+    return true;
+}
+
+// a cache hit is only used when the positions and indices match, meshes without CPU data are trusted to the hash
+static bool MatchesCachedMesh(const Mesh& cached, cgltf_primitive* primitive)
+{
+    if (!cached.vertices)
+        return true;
+
+    cgltf_accessor* positions = nullptr;
+    for (size_t i = 0; i < primitive->attributes_count; i++)
+    {
+        if (primitive->attributes[i].type == cgltf_attribute_type_position)
+            positions = primitive->attributes[i].data;
+    }
+
+    if (!positions || size_t(cached.vertexCount) != positions->count)
+        return false;
+
+    std::vector<float> vertices(positions->count * 3);
+    ConvertBufferType<float>(vertices.data(), positions, 3);
+    if (memcmp(vertices.data(), cached.vertices, vertices.size() * sizeof(float)) != 0)
+        return false;
+
+    // index buffers above the 16 bit limit are not loaded, see CacheMesh
+    cgltf_accessor* indices = primitive->indices;
+    if (indices && (!indices->buffer_view || indices->count > std::numeric_limits<uint16_t>::max()))
+        indices = nullptr;
+
+    if (!indices)
+        return cached.indices == nullptr;
+
+    if (!cached.indices || size_t(cached.triangleCount) != indices->count / 3)
+        return false;
+
+    std::vector<uint16_t> values(indices->count);
+    ConvertBufferType<uint16_t>(values.data(), indices, 1);
+    return memcmp(values.data(), cached.indices, values.size() * sizeof(uint16_t)) == 0;
+}
+
 void LoadMesh(MeshSceneObject* mesh, cgltf_node* node, const cgltf_data* data, Scene& outScene)
 {
     for (size_t i = 0; i < node->mesh->primitives_count; i++)
@@ -321,41 +1048,114 @@ void LoadMesh(MeshSceneObject* mesh, cgltf_node* node, const cgltf_data* data, S
         if (prim->attributes_count == 0)
             continue;
 
-        size_t meshHash = GetMeshHash(prim);
+        // Draco data needs a decoder this library does not ship, files without an uncompressed fallback have accessors with no data
+        if (!HasAccessorData(prim, CurrentLoader->Options.Content.Attributes))
+        {
+            if (prim->has_draco_mesh_compression)
+                TraceLog(LOG_WARNING, "SCENE: %s uses KHR_draco_mesh_compression without a fallback, primitive skipped", SceneFileName.c_str());
+            continue;
+        }
+
+        LOAD_STAT(CurrentStats.PrimitiveCount++);
+
+        size_t meshHash = 0;
+        {
+            PHASE_TIMER(LoadPhase::Hash);
+            meshHash = GetMeshHash(prim, CurrentLoader->Options.Content.Attributes);
+        }
 
         MeshSceneObject::MeshInstanceData meshInstance;
         // read the material?
 
-        meshInstance.MaterialData = LoadMaterialDefault();
-        if (prim->material)
         {
-            LoadMaterial(meshInstance.MaterialData, *prim->material, outScene);
-            //prim->material->has_pbr_metallic_roughness;
+            PHASE_TIMER(LoadPhase::Material);
+            meshInstance.MaterialData = LoadMaterialDefault();
+            if (prim->material)
+            {
+                LoadMaterial(meshInstance.MaterialData, meshInstance.TextureHash, *prim->material, outScene);
+                //prim->material->has_pbr_metallic_roughness;
+            }
         }
 
+        // a different mesh under the same hash moves this one to the next free hash
         auto itr = outScene.MeshCache.find(meshHash);
+        while (itr != outScene.MeshCache.end() && !MatchesCachedMesh(*itr->second, prim))
+        {
+            meshHash = MixHash(meshHash, 1);
+            itr = outScene.MeshCache.find(meshHash);
+        }
+
         if (itr != outScene.MeshCache.end())
         {
+            LOAD_STAT(CurrentStats.MeshCacheHits++);
             meshInstance.MeshData = itr->second;
         }
         else
         {
+            PHASE_TIMER(LoadPhase::Convert);
+            LOAD_STAT(CurrentStats.UniqueMeshes++);
             meshInstance.MeshData = CacheMesh(outScene, meshHash, prim);
         }
+        meshInstance.MeshHash = meshHash;
+
+        PHASE_TIMER(LoadPhase::Bounds);
 
-        auto bbox = GetMeshBoundingBox(*meshInstance.MeshData);
+        // instances of a cached mesh reuse its bounds instead of scanning the vertices again
+        auto bounds = outScene.MeshBoundsCache.find(meshHash);
+        if (bounds == outScene.MeshBoundsCache.end())
+            bounds = outScene.MeshBoundsCache.emplace(meshHash, ComputeMeshBounds(*meshInstance.MeshData)).first;
 
         if (mesh->Meshes.empty())
-            mesh->Bounds = bbox;
+        {
+            mesh->Bounds = bounds->second.Box;
+            mesh->Sphere = bounds->second.Sphere;
+        }
         else
-            mesh->Bounds = MergeBoundingBoxes(bbox, mesh->Bounds);
+        {
+            mesh->Bounds = MergeBoundingBoxes(bounds->second.Box, mesh->Bounds);
+            mesh->Sphere = MergeBoundingSpheres(bounds->second.Sphere, mesh->Sphere);
+        }
 
         mesh->Meshes.push_back(meshInstance);
     }
 }
 
-std::unique_ptr<SceneObject> LoadNodeGLTF(cgltf_node* node, const cgltf_data* data, Scene& outScene)
+// counts a skipped node and everything below it
+static size_t CountNodes(const cgltf_node* node)
+{
+    size_t count = 1;
+    for (size_t i = 0; i < node->children_count; i++)
+        count += CountNodes(node->children[i]);
+
+    return count;
+}
+
+static bool IsNodeSkipped(const cgltf_node* node, int depth)
+{
+    const LoadOptions& options = CurrentLoader->Options.Content;
+
+    if (options.MaxDepth >= 0 && depth > options.MaxDepth)
+        return true;
+
+    std::string_view name = node->name ? node->name : "";
+    for (const std::string& prefix : options.SkipNamePrefixes)
+    {
+        if (!prefix.empty() && name.starts_with(prefix))
+            return true;
+    }
+
+    return options.NodeFilter && !options.NodeFilter(name);
+}
+
+// returns nullptr when the load options skip the node
+std::unique_ptr<SceneObject> LoadNodeGLTF(cgltf_node* node, const cgltf_data* data, Scene& outScene, int depth)
 {
+    if (IsNodeSkipped(node, depth))
+    {
+        LOAD_STAT(CurrentStats.SkippedNodes += CountNodes(node));
+        return nullptr;
+    }
+
     bool storeTransform = true;
 
     std::unique_ptr<SceneObject> sceneNode = nullptr;
@@ -412,25 +1212,49 @@ std::unique_ptr<SceneObject> LoadNodeGLTF(cgltf_node* node, const cgltf_data* da
 
     }
 
-    sceneNode->Name = node->name ? node->name : "";
+    {
+        PHASE_TIMER(LoadPhase::Transform);
+
+        sceneNode->Name = outScene.Strings.Intern(node->name ? node->name : "");
 
-    sceneNode->Transform.position = Vector3{ node->translation[0], node->translation[1], node->translation[2] };
-    sceneNode->Transform.rotation = Quaternion{ node->rotation[0], node->rotation[1], node->rotation[2], node->rotation[3] };
-    sceneNode->Transform.scale = Vector3{ node->scale[0], node->scale[1], node->scale[2] };
+        if (node->has_matrix)
+        {
+            // nodes authored with a matrix leave translation, rotation and scale at identity
+            cgltf_float localTransform[16];
+            cgltf_node_transform_local(node, localTransform);
+
+            Matrix localMatrix = {
+                localTransform[0], localTransform[4], localTransform[8], localTransform[12],
+                localTransform[1], localTransform[5], localTransform[9], localTransform[13],
+                localTransform[2], localTransform[6], localTransform[10], localTransform[14],
+                localTransform[3], localTransform[7], localTransform[11], localTransform[15]
+            };
+            MatrixDecompose(localMatrix, &sceneNode->Transform.position, &sceneNode->Transform.rotation, &sceneNode->Transform.scale);
+        }
+        else
+        {
+            sceneNode->Transform.position = Vector3{ node->translation[0], node->translation[1], node->translation[2] };
+            sceneNode->Transform.rotation = Quaternion{ node->rotation[0], node->rotation[1], node->rotation[2], node->rotation[3] };
+            sceneNode->Transform.scale = Vector3{ node->scale[0], node->scale[1], node->scale[2] };
+        }
 
-    cgltf_float worldTransform[16];
-    cgltf_node_transform_world(node, worldTransform);
+        cgltf_float worldTransform[16];
+        cgltf_node_transform_world(node, worldTransform);
 
-    sceneNode->WorldMatrix = {
-        worldTransform[0], worldTransform[4], worldTransform[8], worldTransform[12],
-        worldTransform[1], worldTransform[5], worldTransform[9], worldTransform[13],
-        worldTransform[2], worldTransform[6], worldTransform[10], worldTransform[14],
-        worldTransform[3], worldTransform[7], worldTransform[11], worldTransform[15]
-    };
+        sceneNode->WorldMatrix = {
+            worldTransform[0], worldTransform[4], worldTransform[8], worldTransform[12],
+            worldTransform[1], worldTransform[5], worldTransform[9], worldTransform[13],
+            worldTransform[2], worldTransform[6], worldTransform[10], worldTransform[14],
+            worldTransform[3], worldTransform[7], worldTransform[11], worldTransform[15]
+        };
+    }
 
     for (size_t i = 0; i < node->children_count; i++)
     {
-        std::unique_ptr<SceneObject> childNode = LoadNodeGLTF(node->children[i], data, outScene);
+        std::unique_ptr<SceneObject> childNode = LoadNodeGLTF(node->children[i], data, outScene, depth + 1);
+        if (!childNode)
+            continue;
+
         childNode->Parent = sceneNode.get();
         sceneNode->Children.push_back(std::move(childNode));
     }
@@ -438,34 +1262,146 @@ std::unique_ptr<SceneObject> LoadNodeGLTF(cgltf_node* node, const cgltf_data* da
     return sceneNode;
 }
 
-bool LoadSceneFromGLTF(std::string_view filename, Scene& outScene)
+// walks the nodes the load options keep, the same way LoadNodeGLTF does, and marks every buffer view they read
+// so compressed views of skipped attributes and subtrees are never decoded
+static void FindUsedBufferViews(const cgltf_node* node, int depth, std::unordered_set<const cgltf_buffer_view*>& usedViews)
 {
+    if (IsNodeSkipped(node, depth))
+        return;
+
+    const LoadOptions& options = CurrentLoader->Options.Content;
+
+    if (node->mesh && !node->camera && !node->light)
+    {
+        for (size_t p = 0; p < node->mesh->primitives_count; p++)
+        {
+            const cgltf_primitive& primitive = node->mesh->primitives[p];
+
+            for (size_t a = 0; a < primitive.attributes_count; a++)
+            {
+                if (!IsAttributeSkipped(primitive.attributes[a], options.Attributes) && primitive.attributes[a].data->buffer_view)
+                    usedViews.insert(primitive.attributes[a].data->buffer_view);
+            }
+
+            if (primitive.indices && primitive.indices->buffer_view)
+                usedViews.insert(primitive.indices->buffer_view);
+
+            if (options.Textures == TextureLoadMode::Load && primitive.material && primitive.material->has_pbr_metallic_roughness)
+            {
+                const cgltf_texture* texture = primitive.material->pbr_metallic_roughness.base_color_texture.texture;
+                if (texture && texture->image && texture->image->buffer_view)
+                    usedViews.insert(texture->image->buffer_view);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < node->children_count; i++)
+        FindUsedBufferViews(node->children[i], depth + 1, usedViews);
+}
+
+bool SceneLoader::LoadFile(std::string_view filename, Scene& outScene, LoadStats* stats, bool headless, size_t threadCount)
+{
+    bool atlasTextures = Options.Content.AtlasTextures && Options.Content.Textures == TextureLoadMode::Load;
+
+    CurrentLoader = this;
+    HeadlessLoad = headless || atlasTextures;
     SceneFileName = filename;
 
+    CurrentStats = LoadStats();
+    ResidentBytes = 0;
+    ResidentBlocks.clear();
+    CollectStats = SCENE_LOAD_STATS && (stats != nullptr || Options.PhaseCallback != nullptr);
+
+#if SCENE_LOAD_STATS
+    auto loadStart = std::chrono::steady_clock::now();
+#endif
+
     // glTF file loading
     int dataSize = 0;
-    unsigned char* fileData = LoadFileData(filename.data(), &dataSize);
-
-    if (fileData == nullptr)
-        return false;
+    unsigned char* fileData = nullptr;
+    cgltf_data* data = nullptr;
+    cgltf_result result = cgltf_result_success;
 
     // glTF data loading
     cgltf_options options = {};
     options.file.read = LoadFileGLTFCallback;
     options.file.release = ReleaseFileGLTFCallback;
-    cgltf_data* data = nullptr;
-    cgltf_result result = cgltf_parse(&options, fileData, dataSize, &data);
+    options.memory.alloc_func = AllocGLTFCallback;
+    options.memory.free_func = FreeGLTFCallback;
+
+    {
+        PHASE_TIMER(LoadPhase::Parse);
+
+        fileData = LoadFileData(SceneFileName.c_str(), &dataSize);
+        if (fileData == nullptr)
+        {
+            CollectStats = false;
+            CurrentLoader = nullptr;
+            return false;
+        }
+
+        LOAD_STAT(CurrentStats.BytesRead += size_t(dataSize); TrackResidentBlock(fileData, size_t(dataSize)));
+
+        result = cgltf_parse(&options, fileData, dataSize, &data);
+    }
 
     if (result == cgltf_result_success)
     {
         // Force reading data buffers (fills buffer_view->buffer->data)
         // NOTE: If an uri is defined to base64 data or external path, it's automatically loaded
-        result = cgltf_load_buffers(&options, data, filename.data());
+        {
+            PHASE_TIMER(LoadPhase::BufferLoad);
+            result = cgltf_load_buffers(&options, data, SceneFileName.c_str());
+        }
+
+        if (result == cgltf_result_success)
+        {
+            PHASE_TIMER(LoadPhase::Decompress);
+
+            std::unordered_set<const cgltf_buffer_view*> usedViews;
+            for (size_t i = 0; i < data->scene->nodes_count; i++)
+                FindUsedBufferViews(data->scene->nodes[i], 0, usedViews);
+
+            if (!DecompressBufferViews(data, usedViews))
+                result = cgltf_result_invalid_gltf;
+        }
+
         if (result == cgltf_result_success)
         {
+            if (Options.Content.Tangents == TangentGeneration::NormalMapped)
+                FindNormalMappedPrimitives(data);
+
             for (size_t i = 0; i < data->scene->nodes_count; i++)
             {
-                outScene.RootObjects.emplace_back(std::move(LoadNodeGLTF(data->scene->nodes[i], data, outScene)));
+                std::unique_ptr<SceneObject> rootNode = LoadNodeGLTF(data->scene->nodes[i], data, outScene, 0);
+                if (rootNode)
+                    outScene.RootObjects.emplace_back(std::move(rootNode));
+            }
+
+            if (!PendingTangents.empty())
+            {
+                PHASE_TIMER(LoadPhase::Tangents);
+                GeneratePendingTangents(threadCount);
+                LOAD_STAT(CurrentStats.GeneratedTangents = PendingTangents.size());
+            }
+
+            NormalMappedPositions.clear();
+            PendingTangents.clear();
+
+            BuildSceneNameIndex(outScene);
+
+            {
+                PHASE_TIMER(LoadPhase::Bounds);
+                UpdateSceneWorldBounds(outScene);
+            }
+
+            if (atlasTextures)
+            {
+                PHASE_TIMER(LoadPhase::Material);
+                AtlasSceneTextures(outScene, Options.Content.Atlas);
+
+                if (!headless)
+                    UploadScene(outScene);
             }
         }
 
@@ -473,7 +1409,125 @@ bool LoadSceneFromGLTF(std::string_view filename, Scene& outScene)
         cgltf_free(data);
     }
 
+    LOAD_STAT(ReleaseResidentBlock(fileData));
     UnloadFileData(fileData);
 
+#if SCENE_LOAD_STATS
+    if (CollectStats)
+    {
+        ResidentBlocks.clear();
+
+        CurrentStats.TotalSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - loadStart).count();
+
+        if (Options.PhaseCallback)
+        {
+            for (size_t i = 0; i < size_t(LoadPhase::Count); i++)
+                Options.PhaseCallback(LoadPhase(i), CurrentStats.PhaseSeconds[i]);
+        }
+
+        if (stats)
+            *stats = CurrentStats;
+
+        CollectStats = false;
+    }
+#endif
+
+    CurrentLoader = nullptr;
+
     return result == cgltf_result_success;
 }
+
+bool SceneLoader::Load(std::string_view filename, Scene& outScene, LoadStats* stats)
+{
+    size_t threadCount = Options.ThreadCount > 0 ? size_t(Options.ThreadCount) : size_t(std::max(1u, std::thread::hardware_concurrency()));
+    return LoadFile(filename, outScene, stats, Options.Headless, threadCount);
+}
+
+size_t SceneLoader::LoadScenes(std::vector<SceneLoadRequest>& requests)
+{
+    if (requests.empty())
+        return 0;
+
+    size_t threadCount = Options.ThreadCount > 0 ? size_t(Options.ThreadCount) : size_t(std::max(1u, std::thread::hardware_concurrency()));
+    threadCount = std::min(threadCount, requests.size());
+
+    std::atomic<size_t> nextRequest = 0;
+    auto worker = [&]()
+        {
+            for (size_t index = nextRequest++; index < requests.size(); index = nextRequest++)
+            {
+                SceneLoadRequest& request = requests[index];
+                // the files already keep every worker busy, so their tangents are generated on the worker itself
+                request.Loaded = request.OutScene && LoadFile(request.FileName, *request.OutScene, request.Stats, true, 1);
+            }
+        };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < threadCount; i++)
+        threads.emplace_back(worker);
+    worker();
+
+    for (auto& thread : threads)
+        thread.join();
+
+    size_t loaded = 0;
+    for (SceneLoadRequest& request : requests)
+    {
+        if (!request.Loaded)
+        {
+            TraceLog(LOG_WARNING, "SCENE: unable to load %s", request.FileName.c_str());
+            continue;
+        }
+
+        // textures and meshes can only be created on the thread that owns the GL context
+        if (!Options.Headless)
+            UploadScene(*request.OutScene);
+
+        loaded++;
+    }
+
+    return loaded;
+}
+
+bool LoadSceneFromGLTF(std::string_view filename, Scene& outScene, LoadStats* stats)
+{
+    return GetDefaultLoader().Load(filename, outScene, stats);
+}
+
+bool SharedImageCache::Find(size_t hash, Image& image)
+{
+    std::lock_guard<std::mutex> lock(Mutex);
+
+    auto itr = Images.find(hash);
+    if (itr == Images.end())
+        return false;
+
+    image = ImageCopy(itr->second);
+    return true;
+}
+
+void SharedImageCache::Add(size_t hash, const Image& image)
+{
+    // copy outside the lock, losing the race to another load only costs the copy
+    Image copy = ImageCopy(image);
+
+    std::lock_guard<std::mutex> lock(Mutex);
+    if (!Images.try_emplace(hash, copy).second)
+        UnloadImage(copy);
+}
+
+void SharedImageCache::Clear()
+{
+    std::lock_guard<std::mutex> lock(Mutex);
+
+    for (auto& [hash, image] : Images)
+        UnloadImage(image);
+
+    Images.clear();
+}
+
+size_t SharedImageCache::GetCount() const
+{
+    std::lock_guard<std::mutex> lock(Mutex);
+    return Images.size();
+}
@@ -0,0 +1,548 @@
+#include "scene_lod.h"
+#include "mesh_utils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+namespace
+{
+    // symmetric 4x4 plane quadric, stored as the upper triangle plus the accumulated weight
+    struct Quadric
+    {
+        double a2 = 0, ab = 0, ac = 0, ad = 0;
+        double b2 = 0, bc = 0, bd = 0;
+        double c2 = 0, cd = 0;
+        double d2 = 0;
+        double w = 0;
+
+        void AddPlane(double a, double b, double c, double d, double weight)
+        {
+            a2 += a * a * weight; ab += a * b * weight; ac += a * c * weight; ad += a * d * weight;
+            b2 += b * b * weight; bc += b * c * weight; bd += b * d * weight;
+            c2 += c * c * weight; cd += c * d * weight;
+            d2 += d * d * weight;
+            w += weight;
+        }
+
+        void Add(const Quadric& q)
+        {
+            a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+            b2 += q.b2; bc += q.bc; bd += q.bd;
+            c2 += q.c2; cd += q.cd;
+            d2 += q.d2;
+            w += q.w;
+        }
+
+        // weighted mean squared distance of the point to the accumulated planes
+        double Error(const Vector3& p) const
+        {
+            double x = p.x, y = p.y, z = p.z;
+            double e = a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+                + b2 * y * y + 2 * bc * y * z + 2 * bd * y
+                + c2 * z * z + 2 * cd * z
+                + d2;
+
+            return w > 0 ? fabs(e) / w : 0;
+        }
+    };
+
+    struct Collapse
+    {
+        uint32_t From = 0;
+        uint32_t To = 0;
+        double Error = 0;
+    };
+
+    class Simplifier
+    {
+    public:
+        Simplifier(const Mesh& mesh, const std::vector<uint32_t>& indices, bool lockSeams)
+            : SourceMesh(mesh), SourceIndices(indices)
+        {
+            size_t uniquePositions = 0;
+            PositionRemap = GenerateVertexRemap(mesh, true, uniquePositions);
+
+            BuildWedges();
+            BuildLocks(lockSeams);
+        }
+
+        std::vector<uint32_t> Simplify(size_t targetIndexCount, double maxError, double& resultError)
+        {
+            std::vector<uint32_t> indices = SourceIndices;
+
+            BuildQuadrics(indices);
+
+            std::vector<uint32_t> collapsed(size_t(SourceMesh.vertexCount));
+            for (uint32_t i = 0; i < uint32_t(collapsed.size()); i++)
+                collapsed[i] = i;
+
+            double maxErrorSq = maxError * maxError;
+            double resultErrorSq = 0;
+
+            while (indices.size() > targetIndexCount)
+            {
+                std::vector<Collapse> candidates = GatherCollapses(indices, maxErrorSq);
+                if (candidates.empty())
+                    break;
+
+                std::sort(candidates.begin(), candidates.end(), [](const Collapse& a, const Collapse& b) { return a.Error < b.Error; });
+
+                BuildAdjacency(indices);
+
+                size_t trianglesToRemove = (indices.size() - targetIndexCount) / 3;
+                size_t trianglesRemoved = 0;
+                size_t collapseCount = 0;
+
+                std::vector<uint8_t> touched(size_t(SourceMesh.vertexCount), 0);
+
+                for (const Collapse& collapse : candidates)
+                {
+                    if (collapseCount > 0 && trianglesRemoved >= trianglesToRemove)
+                        break;
+
+                    if (touched[collapse.From] || touched[collapse.To])
+                        continue;
+
+                    if (FlipsTriangles(collapse, indices, collapsed))
+                        continue;
+
+                    collapsed[collapse.From] = collapse.To;
+                    Quadrics[collapse.To].Add(Quadrics[collapse.From]);
+
+                    touched[collapse.From] = 1;
+                    touched[collapse.To] = 1;
+
+                    trianglesRemoved += SharedTriangleCount(collapse, indices);
+                    resultErrorSq = std::max(resultErrorSq, collapse.Error);
+                    collapseCount++;
+                }
+
+                if (collapseCount == 0)
+                    break;
+
+                ApplyCollapses(indices, collapsed);
+            }
+
+            resultError = sqrt(resultErrorSq);
+            return indices;
+        }
+
+    private:
+        const Mesh& SourceMesh;
+        const std::vector<uint32_t>& SourceIndices;
+
+        std::vector<uint32_t> PositionRemap;        // vertex -> first vertex with the same position
+        std::vector<uint32_t> WedgeOffsets;         // position -> first entry in Wedges
+        std::vector<uint32_t> Wedges;               // vertices that share a position
+        std::vector<uint8_t> Locked;
+        std::vector<Quadric> Quadrics;
+
+        std::vector<uint32_t> AdjacencyOffsets;     // position -> first entry in Adjacency
+        std::vector<uint32_t> Adjacency;            // triangles around a position
+
+        Vector3 GetPosition(uint32_t vertex) const
+        {
+            const float* v = SourceMesh.vertices + size_t(vertex) * 3;
+            return Vector3{ v[0], v[1], v[2] };
+        }
+
+        void BuildWedges()
+        {
+            size_t count = size_t(SourceMesh.vertexCount);
+
+            std::vector<uint8_t> used(count, 0);
+            for (uint32_t index : SourceIndices)
+                used[index] = 1;
+
+            WedgeOffsets.assign(count + 1, 0);
+            for (size_t v = 0; v < count; v++)
+            {
+                if (used[v])
+                    WedgeOffsets[PositionRemap[v] + 1]++;
+            }
+
+            for (size_t p = 0; p < count; p++)
+                WedgeOffsets[p + 1] += WedgeOffsets[p];
+
+            Wedges.resize(WedgeOffsets[count]);
+            std::vector<uint32_t> fill(WedgeOffsets.begin(), WedgeOffsets.end() - 1);
+            for (size_t v = 0; v < count; v++)
+            {
+                if (used[v])
+                    Wedges[fill[PositionRemap[v]]++] = uint32_t(v);
+            }
+        }
+
+        void BuildLocks(bool lockSeams)
+        {
+            Locked.assign(size_t(SourceMesh.vertexCount), 0);
+
+            // edges that are used by anything but two triangles are borders or non manifold, keep them in place
+            std::unordered_map<uint64_t, int> edgeUse;
+            edgeUse.reserve(SourceIndices.size());
+
+            for (size_t i = 0; i < SourceIndices.size(); i += 3)
+            {
+                for (int e = 0; e < 3; e++)
+                {
+                    uint32_t a = PositionRemap[SourceIndices[i + e]];
+                    uint32_t b = PositionRemap[SourceIndices[i + (e + 1) % 3]];
+                    edgeUse[(uint64_t(std::min(a, b)) << 32) | std::max(a, b)]++;
+                }
+            }
+
+            for (auto& [edge, count] : edgeUse)
+            {
+                if (count != 2)
+                {
+                    Locked[uint32_t(edge >> 32)] = 1;
+                    Locked[uint32_t(edge & 0xffffffff)] = 1;
+                }
+            }
+
+            if (lockSeams)
+            {
+                for (size_t p = 0; p + 1 < WedgeOffsets.size(); p++)
+                {
+                    if (WedgeOffsets[p + 1] - WedgeOffsets[p] > 1)
+                        Locked[p] = 1;
+                }
+            }
+        }
+
+        void BuildQuadrics(const std::vector<uint32_t>& indices)
+        {
+            Quadrics.assign(size_t(SourceMesh.vertexCount), Quadric());
+
+            for (size_t i = 0; i < indices.size(); i += 3)
+            {
+                uint32_t p0 = PositionRemap[indices[i + 0]];
+                uint32_t p1 = PositionRemap[indices[i + 1]];
+                uint32_t p2 = PositionRemap[indices[i + 2]];
+
+                Vector3 v0 = GetPosition(p0);
+                Vector3 normal = Vector3CrossProduct(Vector3Subtract(GetPosition(p1), v0), Vector3Subtract(GetPosition(p2), v0));
+                float length = Vector3Length(normal);
+                if (length <= 0)
+                    continue;
+
+                normal = Vector3Scale(normal, 1.0f / length);
+                double d = -Vector3DotProduct(normal, v0);
+                double area = length * 0.5;
+
+                Quadrics[p0].AddPlane(normal.x, normal.y, normal.z, d, area);
+                Quadrics[p1].AddPlane(normal.x, normal.y, normal.z, d, area);
+                Quadrics[p2].AddPlane(normal.x, normal.y, normal.z, d, area);
+            }
+        }
+
+        void BuildAdjacency(const std::vector<uint32_t>& indices)
+        {
+            size_t count = size_t(SourceMesh.vertexCount);
+            AdjacencyOffsets.assign(count + 1, 0);
+
+            for (uint32_t index : indices)
+                AdjacencyOffsets[PositionRemap[index] + 1]++;
+
+            for (size_t p = 0; p < count; p++)
+                AdjacencyOffsets[p + 1] += AdjacencyOffsets[p];
+
+            Adjacency.resize(indices.size());
+            std::vector<uint32_t> fill(AdjacencyOffsets.begin(), AdjacencyOffsets.end() - 1);
+            for (size_t i = 0; i < indices.size(); i++)
+                Adjacency[fill[PositionRemap[indices[i]]]++] = uint32_t(i / 3);
+        }
+
+        std::vector<Collapse> GatherCollapses(const std::vector<uint32_t>& indices, double maxErrorSq) const
+        {
+            std::vector<uint64_t> edges;
+            edges.reserve(indices.size());
+
+            for (size_t i = 0; i < indices.size(); i += 3)
+            {
+                for (int e = 0; e < 3; e++)
+                {
+                    uint32_t a = PositionRemap[indices[i + e]];
+                    uint32_t b = PositionRemap[indices[i + (e + 1) % 3]];
+                    edges.push_back((uint64_t(std::min(a, b)) << 32) | std::max(a, b));
+                }
+            }
+
+            std::sort(edges.begin(), edges.end());
+            edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+            std::vector<Collapse> candidates;
+            candidates.reserve(edges.size());
+
+            for (uint64_t edge : edges)
+            {
+                uint32_t a = uint32_t(edge >> 32);
+                uint32_t b = uint32_t(edge & 0xffffffff);
+
+                Quadric merged = Quadrics[a];
+                merged.Add(Quadrics[b]);
+
+                Collapse best;
+                best.Error = -1;
+
+                if (!Locked[a])
+                    best = Collapse{ a, b, merged.Error(GetPosition(b)) };
+
+                if (!Locked[b])
+                {
+                    double error = merged.Error(GetPosition(a));
+                    if (best.Error < 0 || error < best.Error)
+                        best = Collapse{ b, a, error };
+                }
+
+                if (best.Error >= 0 && best.Error <= maxErrorSq)
+                    candidates.push_back(best);
+            }
+
+            return candidates;
+        }
+
+        bool FlipsTriangles(const Collapse& collapse, const std::vector<uint32_t>& indices, const std::vector<uint32_t>& collapsed) const
+        {
+            Vector3 target = GetPosition(collapse.To);
+
+            for (uint32_t a = AdjacencyOffsets[collapse.From]; a < AdjacencyOffsets[collapse.From + 1]; a++)
+            {
+                const uint32_t* tri = &indices[size_t(Adjacency[a]) * 3];
+
+                Vector3 before[3];
+                Vector3 after[3];
+                bool degenerate = false;
+
+                for (int c = 0; c < 3; c++)
+                {
+                    uint32_t p = PositionRemap[tri[c]];
+                    if (p == collapse.To)
+                        degenerate = true;
+
+                    before[c] = GetPosition(collapsed[p]);
+                    after[c] = (p == collapse.From) ? target : before[c];
+                }
+
+                // triangles on the collapsed edge go away
+                if (degenerate)
+                    continue;
+
+                Vector3 n0 = Vector3CrossProduct(Vector3Subtract(before[1], before[0]), Vector3Subtract(before[2], before[0]));
+                Vector3 n1 = Vector3CrossProduct(Vector3Subtract(after[1], after[0]), Vector3Subtract(after[2], after[0]));
+
+                if (Vector3DotProduct(n0, n1) <= 1e-2f * Vector3Length(n0) * Vector3Length(n1))
+                    return true;
+            }
+
+            return false;
+        }
+
+        size_t SharedTriangleCount(const Collapse& collapse, const std::vector<uint32_t>& indices) const
+        {
+            size_t count = 0;
+            for (uint32_t a = AdjacencyOffsets[collapse.From]; a < AdjacencyOffsets[collapse.From + 1]; a++)
+            {
+                const uint32_t* tri = &indices[size_t(Adjacency[a]) * 3];
+                for (int c = 0; c < 3; c++)
+                {
+                    if (PositionRemap[tri[c]] == collapse.To)
+                    {
+                        count++;
+                        break;
+                    }
+                }
+            }
+            return count;
+        }
+
+        // finds the vertex at the target position whose attributes best match the collapsed vertex
+        uint32_t PickWedge(uint32_t vertex, uint32_t targetPosition) const
+        {
+            uint32_t first = WedgeOffsets[targetPosition];
+            uint32_t last = WedgeOffsets[targetPosition + 1];
+
+            if (last - first == 1)
+                return Wedges[first];
+
+            uint32_t best = Wedges[first];
+            float bestScore = INFINITY;
+
+            for (uint32_t w = first; w < last; w++)
+            {
+                uint32_t candidate = Wedges[w];
+                float score = 0;
+
+                if (SourceMesh.normals)
+                {
+                    const float* n0 = SourceMesh.normals + size_t(vertex) * 3;
+                    const float* n1 = SourceMesh.normals + size_t(candidate) * 3;
+                    score += 1.0f - (n0[0] * n1[0] + n0[1] * n1[1] + n0[2] * n1[2]);
+                }
+
+                if (SourceMesh.texcoords)
+                {
+                    const float* t0 = SourceMesh.texcoords + size_t(vertex) * 2;
+                    const float* t1 = SourceMesh.texcoords + size_t(candidate) * 2;
+                    score += (t0[0] - t1[0]) * (t0[0] - t1[0]) + (t0[1] - t1[1]) * (t0[1] - t1[1]);
+                }
+
+                if (score < bestScore)
+                {
+                    bestScore = score;
+                    best = candidate;
+                }
+            }
+
+            return best;
+        }
+
+        void ApplyCollapses(std::vector<uint32_t>& indices, const std::vector<uint32_t>& collapsed) const
+        {
+            size_t write = 0;
+            for (size_t i = 0; i < indices.size(); i += 3)
+            {
+                uint32_t tri[3];
+                uint32_t positions[3];
+
+                for (int c = 0; c < 3; c++)
+                {
+                    uint32_t p = PositionRemap[indices[i + c]];
+                    if (collapsed[p] != p)
+                    {
+                        tri[c] = PickWedge(indices[i + c], collapsed[p]);
+                        positions[c] = collapsed[p];
+                    }
+                    else
+                    {
+                        tri[c] = indices[i + c];
+                        positions[c] = p;
+                    }
+                }
+
+                if (positions[0] == positions[1] || positions[1] == positions[2] || positions[0] == positions[2])
+                    continue;
+
+                indices[write++] = tri[0];
+                indices[write++] = tri[1];
+                indices[write++] = tri[2];
+            }
+            indices.resize(write);
+        }
+    };
+}
+
+std::vector<MeshLOD> GenerateMeshLODs(const Mesh& mesh, const LODSettings& settings)
+{
+    std::vector<MeshLOD> lods;
+
+    if (!mesh.vertices || mesh.vertexCount == 0)
+        return lods;
+
+    // weld exact duplicates so that triangle soups and split exports share edges
+    size_t uniqueVertices = 0;
+    std::vector<uint32_t> weldRemap = GenerateVertexRemap(mesh, false, uniqueVertices);
+
+    std::vector<uint32_t> indices = GetMeshIndices(mesh);
+    for (uint32_t& index : indices)
+        index = weldRemap[index];
+
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount < settings.MinTriangles)
+        return lods;
+
+    double maxError = double(settings.MaxError) * GetMeshExtent(mesh);
+
+    Simplifier simplifier(mesh, indices, settings.LockSeams);
+
+    size_t previousIndexCount = indices.size();
+    for (size_t i = 0; i < settings.TargetRatios.size(); i++)
+    {
+        size_t targetIndexCount = size_t(triangleCount * settings.TargetRatios[i]) * 3;
+
+        double error = 0;
+        std::vector<uint32_t> lodIndices = simplifier.Simplify(targetIndexCount, maxError, error);
+
+        // stop once the error bound prevents any meaningful reduction
+        if (lodIndices.empty() || lodIndices.size() > previousIndexCount * 9 / 10)
+            break;
+
+        // a level that still needs 32 bit indices is left out, a coarser one may fit
+        std::shared_ptr<Mesh> lodMesh = BuildMeshFromIndices(mesh, lodIndices);
+        if (!lodMesh)
+            continue;
+
+        previousIndexCount = lodIndices.size();
+
+        MeshLOD lod;
+        lod.MeshData = lodMesh;
+        lod.Error = float(error);
+        lod.ScreenError = i < settings.ScreenErrors.size() ? settings.ScreenErrors[i] : settings.PixelError;
+        lods.push_back(lod);
+    }
+
+    return lods;
+}
+
+void GenerateSceneLODs(Scene& scene, const LODSettings& settings)
+{
+    for (auto& [hash, mesh] : scene.MeshCache)
+    {
+        if (scene.MeshLODs.find(hash) != scene.MeshLODs.end())
+            continue;
+
+        std::vector<MeshLOD> lods = GenerateMeshLODs(*mesh, settings);
+        if (!lods.empty())
+            scene.MeshLODs[hash] = std::move(lods);
+    }
+}
+
+int SelectLODIndex(const std::vector<MeshLOD>& lods, float distance, float worldScale, float pixelsPerUnit)
+{
+    distance = fmaxf(distance, 0.0001f);
+
+    int selected = 0;
+    for (size_t i = 0; i < lods.size(); i++)
+    {
+        float pixels = lods[i].Error * worldScale / distance * pixelsPerUnit;
+        if (pixels > lods[i].ScreenError)
+            break;
+
+        selected = int(i + 1);
+    }
+    return selected;
+}
+
+const Mesh& SelectMeshLOD(const Scene& scene, const MeshSceneObject& node, size_t meshIndex, const Camera3D& camera, float screenHeight)
+{
+    const MeshSceneObject::MeshInstanceData& instance = node.Meshes[meshIndex];
+
+    auto itr = scene.MeshLODs.find(instance.MeshHash);
+    if (itr == scene.MeshLODs.end())
+        return *instance.MeshData;
+
+    const Matrix& world = node.WorldMatrix;
+    float worldScale = fmaxf(Vector3Length(Vector3{ world.m0, world.m1, world.m2 }),
+        fmaxf(Vector3Length(Vector3{ world.m4, world.m5, world.m6 }), Vector3Length(Vector3{ world.m8, world.m9, world.m10 })));
+
+    float distance = 1.0f;
+    float pixelsPerUnit = 0;
+
+    if (camera.projection == CAMERA_ORTHOGRAPHIC)
+    {
+        pixelsPerUnit = screenHeight / fmaxf(camera.fovy, 0.0001f);
+    }
+    else
+    {
+        Vector3 center = Vector3Scale(Vector3Add(node.Bounds.min, node.Bounds.max), 0.5f);
+        distance = Vector3Distance(camera.position, Vector3Transform(center, world));
+        pixelsPerUnit = screenHeight / (2.0f * tanf(camera.fovy * DEG2RAD * 0.5f));
+    }
+
+    int lod = SelectLODIndex(itr->second, distance, worldScale, pixelsPerUnit);
+    if (lod == 0)
+        return *instance.MeshData;
+
+    return *itr->second[lod - 1].MeshData;
+}
@@ -0,0 +1,416 @@
+#include "scene_mesh_optimizer.h"
+#include "mesh_utils.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    // FIFO cache simulation, returns the number of misses for the triangle
+    struct FifoCache
+    {
+        std::vector<uint32_t> Timestamps;
+        uint32_t Time;
+        uint32_t Size;
+
+        FifoCache(size_t vertexCount, uint32_t size)
+            : Timestamps(vertexCount, 0), Time(size + 1), Size(size)
+        {
+        }
+
+        int Add(const uint32_t* tri)
+        {
+            int misses = 0;
+            for (int c = 0; c < 3; c++)
+            {
+                if (Time - Timestamps[tri[c]] > Size)
+                {
+                    Timestamps[tri[c]] = Time++;
+                    misses++;
+                }
+            }
+            return misses;
+        }
+
+        // invalidates every cached vertex without touching the timestamps
+        void Flush()
+        {
+            Time += Size + 1;
+        }
+    };
+
+    struct TriangleAdjacency
+    {
+        std::vector<uint32_t> Counts;
+        std::vector<uint32_t> Offsets;
+        std::vector<uint32_t> Triangles;
+
+        TriangleAdjacency(const std::vector<uint32_t>& indices, size_t vertexCount)
+            : Counts(vertexCount, 0), Offsets(vertexCount + 1, 0), Triangles(indices.size())
+        {
+            for (uint32_t index : indices)
+                Counts[index]++;
+
+            for (size_t v = 0; v < vertexCount; v++)
+                Offsets[v + 1] = Offsets[v] + Counts[v];
+
+            std::vector<uint32_t> fill(Offsets.begin(), Offsets.end() - 1);
+            for (size_t i = 0; i < indices.size(); i++)
+                Triangles[fill[indices[i]]++] = uint32_t(i / 3);
+        }
+    };
+
+    VertexCacheStats AnalyzeIndices(const std::vector<uint32_t>& indices, size_t vertexCount, unsigned int cacheSize)
+    {
+        VertexCacheStats stats;
+        stats.TriangleCount = indices.size() / 3;
+
+        FifoCache cache(vertexCount, cacheSize);
+        std::vector<uint8_t> used(vertexCount, 0);
+
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            stats.TransformedVertices += cache.Add(&indices[i]);
+
+            for (int c = 0; c < 3; c++)
+            {
+                if (!used[indices[i + c]])
+                {
+                    used[indices[i + c]] = 1;
+                    stats.VertexCount++;
+                }
+            }
+        }
+
+        if (stats.TriangleCount > 0)
+            stats.ACMR = float(stats.TransformedVertices) / float(stats.TriangleCount);
+        if (stats.VertexCount > 0)
+            stats.ATVR = float(stats.TransformedVertices) / float(stats.VertexCount);
+
+        return stats;
+    }
+
+    void AccumulateStats(VertexCacheStats& total, const VertexCacheStats& stats)
+    {
+        total.TriangleCount += stats.TriangleCount;
+        total.VertexCount += stats.VertexCount;
+        total.TransformedVertices += stats.TransformedVertices;
+
+        if (total.TriangleCount > 0)
+            total.ACMR = float(total.TransformedVertices) / float(total.TriangleCount);
+        if (total.VertexCount > 0)
+            total.ATVR = float(total.TransformedVertices) / float(total.VertexCount);
+    }
+
+    // Tipsify: Sander, Nehab, Barczak, "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw"
+    std::vector<uint32_t> OptimizeVertexCacheTipsify(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize)
+    {
+        TriangleAdjacency adjacency(indices, vertexCount);
+
+        std::vector<uint32_t> live = adjacency.Counts;
+        std::vector<uint32_t> timestamps(vertexCount, 0);
+        std::vector<uint8_t> emitted(indices.size() / 3, 0);
+
+        std::vector<uint32_t> deadEnd;
+        deadEnd.reserve(indices.size());
+
+        std::vector<uint32_t> candidates;
+        candidates.reserve(64);
+
+        std::vector<uint32_t> result;
+        result.reserve(indices.size());
+
+        uint32_t time = cacheSize + 1;
+        size_t cursor = 0;
+
+        int64_t fanning = vertexCount > 0 ? 0 : -1;
+        while (fanning >= 0)
+        {
+            candidates.clear();
+
+            uint32_t f = uint32_t(fanning);
+            for (uint32_t a = adjacency.Offsets[f]; a < adjacency.Offsets[f + 1]; a++)
+            {
+                uint32_t triangle = adjacency.Triangles[a];
+                if (emitted[triangle])
+                    continue;
+
+                for (int c = 0; c < 3; c++)
+                {
+                    uint32_t v = indices[size_t(triangle) * 3 + c];
+                    result.push_back(v);
+                    deadEnd.push_back(v);
+                    candidates.push_back(v);
+                    live[v]--;
+
+                    if (time - timestamps[v] > cacheSize)
+                        timestamps[v] = time++;
+                }
+                emitted[triangle] = 1;
+            }
+
+            // pick the candidate that will still be in the cache and has the fewest live triangles
+            fanning = -1;
+            int64_t bestPriority = -1;
+            for (uint32_t v : candidates)
+            {
+                if (live[v] == 0)
+                    continue;
+
+                int64_t priority = 0;
+                if (int64_t(time) - timestamps[v] + 2 * int64_t(live[v]) <= int64_t(cacheSize))
+                    priority = int64_t(time) - timestamps[v];
+
+                if (priority > bestPriority)
+                {
+                    bestPriority = priority;
+                    fanning = v;
+                }
+            }
+
+            if (fanning >= 0)
+                continue;
+
+            // dead end, back track through recently emitted vertices
+            while (!deadEnd.empty())
+            {
+                uint32_t v = deadEnd.back();
+                deadEnd.pop_back();
+                if (live[v] > 0)
+                {
+                    fanning = v;
+                    break;
+                }
+            }
+
+            if (fanning >= 0)
+                continue;
+
+            // nothing local is left, continue with the next vertex in input order
+            while (cursor < vertexCount)
+            {
+                if (live[cursor] > 0)
+                {
+                    fanning = int64_t(cursor);
+                    break;
+                }
+                cursor++;
+            }
+        }
+
+        return result;
+    }
+
+    // splits the cache optimized order into clusters and sorts them so that outward facing clusters draw first
+    std::vector<uint32_t> OptimizeOverdraw(const std::vector<uint32_t>& indices, const float* positions, size_t vertexCount, uint32_t cacheSize, float threshold)
+    {
+        size_t triangleCount = indices.size() / 3;
+        if (triangleCount == 0)
+            return indices;
+
+        // hard boundaries are where the cache got flushed, splitting there costs nothing
+        std::vector<size_t> hardBoundaries;
+        {
+            FifoCache cache(vertexCount, cacheSize);
+            for (size_t t = 0; t < triangleCount; t++)
+            {
+                if (cache.Add(&indices[t * 3]) == 3 || t == 0)
+                    hardBoundaries.push_back(t);
+            }
+        }
+        hardBoundaries.push_back(triangleCount);
+
+        // soft boundaries split hard clusters wherever the local ACMR is still within the threshold
+        std::vector<size_t> clusters;
+        FifoCache cache(vertexCount, cacheSize);
+        for (size_t h = 0; h + 1 < hardBoundaries.size(); h++)
+        {
+            size_t start = hardBoundaries[h];
+            size_t end = hardBoundaries[h + 1];
+
+            cache.Flush();
+            size_t clusterMisses = 0;
+            for (size_t t = start; t < end; t++)
+                clusterMisses += cache.Add(&indices[t * 3]);
+
+            float clusterThreshold = threshold * float(clusterMisses) / float(end - start);
+
+            cache.Flush();
+            size_t subStart = start;
+            size_t subMisses = 0;
+
+            clusters.push_back(start);
+            for (size_t t = start; t < end; t++)
+            {
+                subMisses += cache.Add(&indices[t * 3]);
+
+                size_t subSize = t + 1 - subStart;
+                if (t + 1 < end && subSize >= 8 && float(subMisses) / float(subSize) <= clusterThreshold)
+                {
+                    clusters.push_back(t + 1);
+                    subStart = t + 1;
+                    subMisses = 0;
+                    cache.Flush();
+                }
+            }
+        }
+        clusters.push_back(triangleCount);
+
+        // mesh centroid, area weighted
+        Vector3 meshCentroid = Vector3Zeros;
+        float meshArea = 0;
+
+        struct ClusterInfo
+        {
+            size_t Start = 0;
+            size_t End = 0;
+            float SortKey = 0;
+        };
+        std::vector<ClusterInfo> clusterInfo(clusters.size() - 1);
+
+        std::vector<Vector3> clusterCentroids(clusterInfo.size(), Vector3Zeros);
+        std::vector<Vector3> clusterNormals(clusterInfo.size(), Vector3Zeros);
+
+        for (size_t c = 0; c < clusterInfo.size(); c++)
+        {
+            clusterInfo[c].Start = clusters[c];
+            clusterInfo[c].End = clusters[c + 1];
+
+            float clusterArea = 0;
+            for (size_t t = clusters[c]; t < clusters[c + 1]; t++)
+            {
+                const float* p0 = positions + size_t(indices[t * 3 + 0]) * 3;
+                const float* p1 = positions + size_t(indices[t * 3 + 1]) * 3;
+                const float* p2 = positions + size_t(indices[t * 3 + 2]) * 3;
+
+                Vector3 v0 = { p0[0], p0[1], p0[2] };
+                Vector3 v1 = { p1[0], p1[1], p1[2] };
+                Vector3 v2 = { p2[0], p2[1], p2[2] };
+
+                Vector3 normal = Vector3CrossProduct(Vector3Subtract(v1, v0), Vector3Subtract(v2, v0));
+                float area = Vector3Length(normal);
+
+                Vector3 center = Vector3Scale(Vector3Add(Vector3Add(v0, v1), v2), area / 3.0f);
+                clusterCentroids[c] = Vector3Add(clusterCentroids[c], center);
+                clusterNormals[c] = Vector3Add(clusterNormals[c], normal);
+                clusterArea += area;
+
+                meshCentroid = Vector3Add(meshCentroid, center);
+                meshArea += area;
+            }
+
+            if (clusterArea > 0)
+                clusterCentroids[c] = Vector3Scale(clusterCentroids[c], 1.0f / clusterArea);
+        }
+
+        if (meshArea > 0)
+            meshCentroid = Vector3Scale(meshCentroid, 1.0f / meshArea);
+
+        for (size_t c = 0; c < clusterInfo.size(); c++)
+            clusterInfo[c].SortKey = Vector3DotProduct(Vector3Subtract(clusterCentroids[c], meshCentroid), Vector3Normalize(clusterNormals[c]));
+
+        std::stable_sort(clusterInfo.begin(), clusterInfo.end(), [](const ClusterInfo& a, const ClusterInfo& b) { return a.SortKey > b.SortKey; });
+
+        std::vector<uint32_t> result;
+        result.reserve(indices.size());
+        for (const ClusterInfo& cluster : clusterInfo)
+            result.insert(result.end(), indices.begin() + cluster.Start * 3, indices.begin() + cluster.End * 3);
+
+        return result;
+    }
+
+    template<class T>
+    void RemapAttribute(T* data, int components, const std::vector<uint32_t>& order, std::vector<T>& scratch)
+    {
+        if (!data)
+            return;
+
+        scratch.assign(data, data + order.size() * components);
+        for (size_t v = 0; v < order.size(); v++)
+        {
+            if (order[v] != UINT32_MAX)
+                memcpy(data + size_t(order[v]) * components, scratch.data() + v * components, components * sizeof(T));
+        }
+    }
+
+    // reorders vertices in place in order of first use, unused vertices end up past the new vertex count
+    void OptimizeVertexFetch(Mesh& mesh, std::vector<uint32_t>& indices)
+    {
+        std::vector<uint32_t> order(size_t(mesh.vertexCount), UINT32_MAX);
+        uint32_t next = 0;
+
+        for (uint32_t& index : indices)
+        {
+            if (order[index] == UINT32_MAX)
+                order[index] = next++;
+            index = order[index];
+        }
+
+        // unreferenced vertices go to the end so the arrays stay permutations of themselves
+        for (uint32_t& slot : order)
+        {
+            if (slot == UINT32_MAX)
+                slot = next++;
+        }
+
+        std::vector<float> floatScratch;
+        std::vector<unsigned char> byteScratch;
+
+        RemapAttribute(mesh.vertices, 3, order, floatScratch);
+        RemapAttribute(mesh.normals, 3, order, floatScratch);
+        RemapAttribute(mesh.texcoords, 2, order, floatScratch);
+        RemapAttribute(mesh.texcoords2, 2, order, floatScratch);
+        RemapAttribute(mesh.tangents, 4, order, floatScratch);
+        RemapAttribute(mesh.colors, 4, order, byteScratch);
+    }
+}
+
+VertexCacheStats AnalyzeVertexCache(const Mesh& mesh, unsigned int cacheSize)
+{
+    return AnalyzeIndices(GetMeshIndices(mesh), size_t(mesh.vertexCount), cacheSize);
+}
+
+void OptimizeMesh(Mesh& mesh, const MeshOptimizeSettings& settings, MeshOptimizeStats* stats)
+{
+    if (!mesh.indices || !mesh.vertices || mesh.triangleCount == 0)
+        return;
+
+    std::vector<uint32_t> indices = GetMeshIndices(mesh);
+    size_t vertexCount = size_t(mesh.vertexCount);
+
+    if (stats)
+        AccumulateStats(stats->Before, AnalyzeIndices(indices, vertexCount, settings.CacheSize));
+
+    if (settings.OptimizeVertexCache)
+        indices = OptimizeVertexCacheTipsify(indices, vertexCount, settings.CacheSize);
+
+    if (settings.OptimizeOverdraw)
+        indices = OptimizeOverdraw(indices, mesh.vertices, vertexCount, settings.CacheSize, settings.OverdrawThreshold);
+
+    if (settings.OptimizeVertexFetch)
+        OptimizeVertexFetch(mesh, indices);
+
+    for (size_t i = 0; i < indices.size(); i++)
+        mesh.indices[i] = (unsigned short)indices[i];
+
+    if (stats)
+    {
+        AccumulateStats(stats->After, AnalyzeIndices(indices, vertexCount, settings.CacheSize));
+        stats->MeshCount++;
+    }
+}
+
+void OptimizeSceneMeshes(Scene& scene, const MeshOptimizeSettings& settings, MeshOptimizeStats* stats)
+{
+    for (auto& [hash, mesh] : scene.MeshCache)
+        OptimizeMesh(*mesh, settings, stats);
+
+    for (auto& [hash, lods] : scene.MeshLODs)
+    {
+        for (auto& lod : lods)
+            OptimizeMesh(*lod.MeshData, settings, stats);
+    }
+
+    if (settings.OptimizeVertexFetch)
+        UpdateInterleavedVertices(scene);
+}
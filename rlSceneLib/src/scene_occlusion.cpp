@@ -0,0 +1,574 @@
+#include "scene_occlusion.h"
+#include "mesh_utils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace
+{
+    // same clip planes raylib uses for BeginMode3D
+    constexpr float OcclusionNear = 0.01f;
+    constexpr float OcclusionFar = 1000.0f;
+
+    constexpr int BandHeight = 16;
+
+    // projected triangles of one worker, stored as separate arrays so the setup loop runs over plain floats
+    struct TriangleVerts
+    {
+        std::vector<float> X[3];
+        std::vector<float> Y[3];
+        std::vector<float> Depth[3];
+
+        size_t Size() const { return X[0].size(); }
+    };
+
+    // edge functions and depth plane of a triangle in pixel space
+    struct ScreenTriangle
+    {
+        float EdgeA[3];
+        float EdgeB[3];
+        float EdgeC[3];
+
+        float DepthX;
+        float DepthY;
+        float DepthBase;
+        float MinDepth;
+
+        int MinX, MaxX, MinY, MaxY;
+    };
+
+    Vector4 TransformPoint(const Vector3& v, const Matrix& m)
+    {
+        return Vector4{ m.m0 * v.x + m.m4 * v.y + m.m8 * v.z + m.m12,
+                        m.m1 * v.x + m.m5 * v.y + m.m9 * v.z + m.m13,
+                        m.m2 * v.x + m.m6 * v.y + m.m10 * v.z + m.m14,
+                        m.m3 * v.x + m.m7 * v.y + m.m11 * v.z + m.m15 };
+    }
+
+    // outside bits for the left, right, bottom, top and near planes, the far plane is ignored
+    int GetOutCode(const Vector4& v)
+    {
+        return (v.x < -v.w ? 1 : 0) | (v.x > v.w ? 2 : 0) | (v.y < -v.w ? 4 : 0) | (v.y > v.w ? 8 : 0) | (v.z < -v.w ? 16 : 0);
+    }
+
+    Vector4 LerpClip(const Vector4& a, const Vector4& b, float t)
+    {
+        return Vector4{ a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, a.z + (b.z - a.z) * t, a.w + (b.w - a.w) * t };
+    }
+
+    // clips a polygon against the near plane, z >= -w, returns the new vertex count
+    int ClipNear(const Vector4* input, int count, Vector4* output)
+    {
+        int outCount = 0;
+        for (int i = 0; i < count; i++)
+        {
+            const Vector4& a = input[i];
+            const Vector4& b = input[(i + 1) % count];
+
+            float distanceA = a.z + a.w;
+            float distanceB = b.z + b.w;
+
+            if (distanceA >= 0)
+                output[outCount++] = a;
+
+            if ((distanceA >= 0) != (distanceB >= 0))
+                output[outCount++] = LerpClip(a, b, distanceA / (distanceA - distanceB));
+        }
+        return outCount;
+    }
+
+    // projects a clipped polygon to pixels and keeps the front facing triangles of its fan
+    void EmitPolygon(const Vector4* polygon, int count, int width, int height, TriangleVerts& out)
+    {
+        float x[4], y[4], depth[4];
+        for (int i = 0; i < count; i++)
+        {
+            float invW = 1.0f / polygon[i].w;
+            x[i] = (polygon[i].x * invW * 0.5f + 0.5f) * float(width);
+            y[i] = (polygon[i].y * invW * 0.5f + 0.5f) * float(height);
+            depth[i] = 0.5f - 0.5f * polygon[i].z * invW;
+        }
+
+        for (int i = 1; i + 1 < count; i++)
+        {
+            float area = (x[i] - x[0]) * (y[i + 1] - y[0]) - (x[i + 1] - x[0]) * (y[i] - y[0]);
+            if (area <= 0)
+                continue;
+
+            int corners[3] = { 0, i, i + 1 };
+            for (int c = 0; c < 3; c++)
+            {
+                out.X[c].push_back(x[corners[c]]);
+                out.Y[c].push_back(y[corners[c]]);
+                out.Depth[c].push_back(depth[corners[c]]);
+            }
+        }
+    }
+
+    void ProjectOccluder(const Occluder& occluder, const Matrix& viewProjection, int width, int height, std::vector<Vector4>& clip, TriangleVerts& out)
+    {
+        const OccluderMesh& geometry = *occluder.Geometry;
+        Matrix transform = MatrixMultiply(occluder.Node->WorldMatrix, viewProjection);
+
+        clip.resize(geometry.Vertices.size());
+        for (size_t v = 0; v < geometry.Vertices.size(); v++)
+            clip[v] = TransformPoint(geometry.Vertices[v], transform);
+
+        for (size_t i = 0; i + 2 < geometry.Indices.size(); i += 3)
+        {
+            Vector4 triangle[3] = { clip[geometry.Indices[i]], clip[geometry.Indices[i + 1]], clip[geometry.Indices[i + 2]] };
+
+            int codes[3] = { GetOutCode(triangle[0]), GetOutCode(triangle[1]), GetOutCode(triangle[2]) };
+            if (codes[0] & codes[1] & codes[2])
+                continue;
+
+            if ((codes[0] | codes[1] | codes[2]) & 16)
+            {
+                Vector4 clipped[4];
+                int count = ClipNear(triangle, 3, clipped);
+                if (count >= 3)
+                    EmitPolygon(clipped, count, width, height, out);
+            }
+            else
+            {
+                EmitPolygon(triangle, 3, width, height, out);
+            }
+        }
+    }
+
+    // edge and depth plane setup for all triangles at once
+    void SetupTriangles(const TriangleVerts& verts, int width, int height, std::vector<ScreenTriangle>& triangles)
+    {
+        size_t start = triangles.size();
+        size_t count = verts.Size();
+        triangles.resize(start + count);
+
+        const float* x0 = verts.X[0].data();
+        const float* x1 = verts.X[1].data();
+        const float* x2 = verts.X[2].data();
+        const float* y0 = verts.Y[0].data();
+        const float* y1 = verts.Y[1].data();
+        const float* y2 = verts.Y[2].data();
+        const float* d0 = verts.Depth[0].data();
+        const float* d1 = verts.Depth[1].data();
+        const float* d2 = verts.Depth[2].data();
+
+        for (size_t i = 0; i < count; i++)
+        {
+            ScreenTriangle& t = triangles[start + i];
+
+            t.EdgeA[0] = y0[i] - y1[i];
+            t.EdgeB[0] = x1[i] - x0[i];
+            t.EdgeA[1] = y1[i] - y2[i];
+            t.EdgeB[1] = x2[i] - x1[i];
+            t.EdgeA[2] = y2[i] - y0[i];
+            t.EdgeB[2] = x0[i] - x2[i];
+
+            t.EdgeC[0] = -(t.EdgeA[0] * x0[i] + t.EdgeB[0] * y0[i]);
+            t.EdgeC[1] = -(t.EdgeA[1] * x1[i] + t.EdgeB[1] * y1[i]);
+            t.EdgeC[2] = -(t.EdgeA[2] * x2[i] + t.EdgeB[2] * y2[i]);
+
+            float invArea = 1.0f / ((x1[i] - x0[i]) * (y2[i] - y0[i]) - (x2[i] - x0[i]) * (y1[i] - y0[i]));
+            t.DepthX = ((d1[i] - d0[i]) * (y2[i] - y0[i]) - (d2[i] - d0[i]) * (y1[i] - y0[i])) * invArea;
+            t.DepthY = ((x1[i] - x0[i]) * (d2[i] - d0[i]) - (x2[i] - x0[i]) * (d1[i] - d0[i])) * invArea;
+            t.DepthBase = d0[i] - t.DepthX * x0[i] - t.DepthY * y0[i];
+            t.MinDepth = std::min(d0[i], std::min(d1[i], d2[i]));
+
+            t.MinX = std::max(0, int(floorf(std::min(x0[i], std::min(x1[i], x2[i])))));
+            t.MaxX = std::min(width - 1, int(ceilf(std::max(x0[i], std::max(x1[i], x2[i])))));
+            t.MinY = std::max(0, int(floorf(std::min(y0[i], std::min(y1[i], y2[i])))));
+            t.MaxY = std::min(height - 1, int(ceilf(std::max(y0[i], std::max(y1[i], y2[i])))));
+        }
+    }
+
+    // draws the triangles into the rows of one band, pixels keep the closest value
+    void RasterizeBand(const std::vector<ScreenTriangle>& triangles, const std::vector<uint32_t>& bin, int bandStart, int bandEnd, int width, float* depth)
+    {
+        for (uint32_t index : bin)
+        {
+            const ScreenTriangle& t = triangles[index];
+
+            int minY = std::max(t.MinY, bandStart);
+            int maxY = std::min(t.MaxY, bandEnd - 1);
+
+            // the depth written is the farthest the plane gets inside the pixel, so occluders never get closer than they are
+            float slack = 0.5f * (fabsf(t.DepthX) + fabsf(t.DepthY));
+
+            for (int y = minY; y <= maxY; y++)
+            {
+                float py = float(y) + 0.5f;
+
+                // the covered pixel centers of a row are one span, solve each edge for where it starts or ends
+                int spanStart = t.MinX;
+                int spanEnd = t.MaxX;
+                for (int e = 0; e < 3; e++)
+                {
+                    float rowValue = t.EdgeB[e] * py + t.EdgeC[e];
+                    if (t.EdgeA[e] > 0)
+                        spanStart = std::max(spanStart, int(ceilf(-rowValue / t.EdgeA[e] - 0.5f)));
+                    else if (t.EdgeA[e] < 0)
+                        spanEnd = std::min(spanEnd, int(floorf(-rowValue / t.EdgeA[e] - 0.5f)));
+                    else if (rowValue < 0)
+                        spanEnd = spanStart - 1;
+                }
+
+                float* row = depth + size_t(y) * width;
+                float rowDepth = t.DepthY * py + t.DepthBase - slack + t.DepthX * 0.5f;
+
+                // plain loop over the span so the compiler can run it several pixels at a time
+                for (int x = spanStart; x <= spanEnd; x++)
+                    row[x] = std::max(row[x], std::max(rowDepth + t.DepthX * float(x), t.MinDepth));
+            }
+        }
+    }
+
+    void BuildPyramid(OcclusionCuller& culler)
+    {
+        size_t levels = 1;
+        for (int w = culler.Settings.Width, h = culler.Settings.Height; w > 1 || h > 1; w = (w + 1) / 2, h = (h + 1) / 2)
+            levels++;
+
+        culler.Pyramid.resize(levels);
+        culler.PyramidWidths.resize(levels);
+        culler.PyramidHeights.resize(levels);
+        culler.PyramidWidths[0] = culler.Settings.Width;
+        culler.PyramidHeights[0] = culler.Settings.Height;
+
+        for (size_t level = 1; level < levels; level++)
+        {
+            int sourceWidth = culler.PyramidWidths[level - 1];
+            int sourceHeight = culler.PyramidHeights[level - 1];
+            int w = (sourceWidth + 1) / 2;
+            int h = (sourceHeight + 1) / 2;
+
+            culler.PyramidWidths[level] = w;
+            culler.PyramidHeights[level] = h;
+
+            const std::vector<float>& source = culler.Pyramid[level - 1];
+            std::vector<float>& target = culler.Pyramid[level];
+            target.resize(size_t(w) * h);
+
+            for (int y = 0; y < h; y++)
+            {
+                const float* row0 = source.data() + size_t(y * 2) * sourceWidth;
+                const float* row1 = source.data() + size_t(std::min(y * 2 + 1, sourceHeight - 1)) * sourceWidth;
+
+                for (int x = 0; x < w; x++)
+                {
+                    int x0 = x * 2;
+                    int x1 = std::min(x * 2 + 1, sourceWidth - 1);
+                    target[size_t(y) * w + x] = std::min(std::min(row0[x0], row0[x1]), std::min(row1[x0], row1[x1]));
+                }
+            }
+        }
+    }
+
+    enum class BoxResult
+    {
+        Visible,
+        OutsideFrustum,
+        Occluded
+    };
+
+    BoxResult TestBox(const OcclusionCuller& culler, const BoundingBox& bounds, const Matrix& transform)
+    {
+        Vector4 corners[8];
+        int allCodes = 0x1F;
+        int anyCodes = 0;
+
+        for (int i = 0; i < 8; i++)
+        {
+            Vector3 corner = { (i & 1) ? bounds.max.x : bounds.min.x, (i & 2) ? bounds.max.y : bounds.min.y, (i & 4) ? bounds.max.z : bounds.min.z };
+            corners[i] = TransformPoint(corner, transform);
+
+            int code = GetOutCode(corners[i]);
+            allCodes &= code;
+            anyCodes |= code;
+        }
+
+        if (allCodes)
+            return BoxResult::OutsideFrustum;
+
+        // boxes that reach the camera can not be hidden
+        if ((anyCodes & 16) || culler.Pyramid.empty())
+            return BoxResult::Visible;
+
+        int width = culler.Settings.Width;
+        int height = culler.Settings.Height;
+
+        float minX = 1e30f, minY = 1e30f, maxX = -1e30f, maxY = -1e30f;
+        float closest = 0;
+        for (const Vector4& corner : corners)
+        {
+            float invW = 1.0f / corner.w;
+            float x = (corner.x * invW * 0.5f + 0.5f) * float(width);
+            float y = (corner.y * invW * 0.5f + 0.5f) * float(height);
+
+            minX = std::min(minX, x);
+            maxX = std::max(maxX, x);
+            minY = std::min(minY, y);
+            maxY = std::max(maxY, y);
+            closest = std::max(closest, 0.5f - 0.5f * corner.z * invW);
+        }
+
+        int x0 = std::clamp(int(floorf(minX)), 0, width - 1);
+        int x1 = std::clamp(int(floorf(maxX)), 0, width - 1);
+        int y0 = std::clamp(int(floorf(minY)), 0, height - 1);
+        int y1 = std::clamp(int(floorf(maxY)), 0, height - 1);
+
+        // the level where the box covers at most 2x2 texels
+        size_t level = 0;
+        while (level + 1 < culler.Pyramid.size() && std::max(x1 - x0, y1 - y0) > 1)
+        {
+            x0 >>= 1;
+            x1 >>= 1;
+            y0 >>= 1;
+            y1 >>= 1;
+            level++;
+        }
+
+        const std::vector<float>& depth = culler.Pyramid[level];
+        int levelWidth = culler.PyramidWidths[level];
+
+        float farthest = 1.0f;
+        for (int y = y0; y <= y1; y++)
+        {
+            for (int x = x0; x <= x1; x++)
+                farthest = std::min(farthest, depth[size_t(y) * levelWidth + x]);
+        }
+
+        return closest < farthest ? BoxResult::Occluded : BoxResult::Visible;
+    }
+
+    std::shared_ptr<OccluderMesh> CopyOccluderMesh(const Mesh& mesh)
+    {
+        auto geometry = std::make_shared<OccluderMesh>();
+        geometry->Vertices.resize(mesh.vertexCount);
+        for (int v = 0; v < mesh.vertexCount; v++)
+            geometry->Vertices[v] = Vector3{ mesh.vertices[v * 3 + 0], mesh.vertices[v * 3 + 1], mesh.vertices[v * 3 + 2] };
+
+        geometry->Indices = GetMeshIndices(mesh);
+
+        for (size_t v = 0; v < geometry->Vertices.size(); v++)
+        {
+            geometry->Bounds.min = v == 0 ? geometry->Vertices[v] : Vector3Min(geometry->Bounds.min, geometry->Vertices[v]);
+            geometry->Bounds.max = v == 0 ? geometry->Vertices[v] : Vector3Max(geometry->Bounds.max, geometry->Vertices[v]);
+        }
+
+        return geometry;
+    }
+
+    // the mesh itself when it is small enough, otherwise the finest LOD that fits the triangle budget
+    const Mesh* GetOccluderSource(const Scene& scene, const MeshSceneObject::MeshInstanceData& instance, int maxTriangles)
+    {
+        if (instance.MeshData && instance.MeshData->vertices && instance.MeshData->triangleCount <= maxTriangles)
+            return instance.MeshData.get();
+
+        auto itr = scene.MeshLODs.find(instance.MeshHash);
+        if (itr == scene.MeshLODs.end())
+            return nullptr;
+
+        for (const MeshLOD& lod : itr->second)
+        {
+            if (lod.MeshData && lod.MeshData->vertices && lod.MeshData->triangleCount <= maxTriangles)
+                return lod.MeshData.get();
+        }
+
+        return nullptr;
+    }
+}
+
+void SelectOccluders(OcclusionCuller& culler, const Scene& scene)
+{
+    std::unordered_set<const MeshSceneObject*> existing;
+    for (const Occluder& occluder : culler.Occluders)
+        existing.insert(occluder.Node);
+
+    // meshes shared by several nodes are only copied once
+    std::unordered_map<const Mesh*, std::shared_ptr<OccluderMesh>> copies;
+
+    for (const MeshSceneObject* node : scene.Meshes)
+    {
+        if (existing.contains(node))
+            continue;
+
+        BoundingBox bounds = node->BoundsDirty ? TransformBoundingBox(node->Bounds, node->WorldMatrix) : node->WorldBounds;
+        if (Vector3Length(Vector3Subtract(bounds.max, bounds.min)) < culler.Settings.MinOccluderSize)
+            continue;
+
+        for (const auto& instance : node->Meshes)
+        {
+            const Mesh* source = GetOccluderSource(scene, instance, culler.Settings.MaxOccluderTriangles);
+            if (!source)
+                continue;
+
+            auto& geometry = copies[source];
+            if (!geometry)
+                geometry = CopyOccluderMesh(*source);
+
+            culler.Occluders.push_back(Occluder{ node, geometry });
+        }
+    }
+}
+
+void AddOccluder(OcclusionCuller& culler, const MeshSceneObject& node, const Mesh& occluderMesh)
+{
+    if (!occluderMesh.vertices)
+    {
+        TraceLog(LOG_WARNING, "OCCLUSION: occluder mesh for %s has no CPU vertex data", std::string(node.Name).c_str());
+        return;
+    }
+
+    culler.Occluders.push_back(Occluder{ &node, CopyOccluderMesh(occluderMesh) });
+}
+
+void RenderOccluders(OcclusionCuller& culler, const Camera3D& camera, float aspect)
+{
+    OcclusionSettings& settings = culler.Settings;
+    settings.Width = std::max(1, settings.Width);
+    settings.Height = std::max(1, settings.Height);
+
+    Matrix view = MatrixLookAt(camera.position, camera.target, camera.up);
+    Matrix projection;
+    if (camera.projection == CAMERA_ORTHOGRAPHIC)
+    {
+        float top = camera.fovy * 0.5f;
+        float right = top * aspect;
+        projection = MatrixOrtho(-right, right, -top, top, OcclusionNear, OcclusionFar);
+    }
+    else
+    {
+        projection = MatrixPerspective(camera.fovy * DEG2RAD, aspect, OcclusionNear, OcclusionFar);
+    }
+
+    culler.ViewProjection = MatrixMultiply(view, projection);
+    culler.Stats = OcclusionStats();
+
+    int threadCount = settings.ThreadCount > 0 ? settings.ThreadCount : int(std::max(1u, std::thread::hardware_concurrency()));
+    int bandCount = (settings.Height + BandHeight - 1) / BandHeight;
+
+    auto runParallel = [threadCount](int count, auto&& work)
+        {
+            std::atomic<int> next = 0;
+            auto worker = [&](int thread)
+                {
+                    for (int item = next++; item < count; item = next++)
+                        work(item, thread);
+                };
+
+            int threads = std::min(threadCount, count);
+
+            std::vector<std::thread> workers;
+            for (int i = 1; i < threads; i++)
+                workers.emplace_back(worker, i);
+            worker(0);
+
+            for (auto& thread : workers)
+                thread.join();
+        };
+
+    // the occluders in view that cover the most of it, by surface area over squared distance
+    culler.Pyramid.clear();
+
+    std::vector<std::pair<float, const Occluder*>> ranked;
+    for (const Occluder& occluder : culler.Occluders)
+    {
+        const Matrix& world = occluder.Node->WorldMatrix;
+        if (TestBox(culler, occluder.Geometry->Bounds, MatrixMultiply(world, culler.ViewProjection)) == BoxResult::OutsideFrustum)
+            continue;
+
+        BoundingBox bounds = TransformBoundingBox(occluder.Geometry->Bounds, world);
+        Vector3 size = Vector3Subtract(bounds.max, bounds.min);
+        Vector3 closest = Vector3Clamp(camera.position, bounds.min, bounds.max);
+
+        float area = size.x * size.y + size.y * size.z + size.z * size.x;
+        ranked.emplace_back(area / std::max(Vector3DistanceSqr(camera.position, closest), 1.0f), &occluder);
+    }
+
+    if (int(ranked.size()) > settings.MaxOccluders)
+    {
+        std::nth_element(ranked.begin(), ranked.begin() + settings.MaxOccluders, ranked.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+        ranked.resize(settings.MaxOccluders);
+    }
+
+    culler.Stats.OccludersDrawn = ranked.size();
+
+    // transform, clip and project the occluders, every thread fills its own list
+    std::vector<TriangleVerts> projected(threadCount);
+    std::vector<std::vector<Vector4>> clipScratch(threadCount);
+
+    runParallel(int(ranked.size()), [&](int index, int thread)
+        {
+            ProjectOccluder(*ranked[index].second, culler.ViewProjection, settings.Width, settings.Height, clipScratch[thread], projected[thread]);
+        });
+
+    std::vector<ScreenTriangle> triangles;
+    for (const TriangleVerts& verts : projected)
+        SetupTriangles(verts, settings.Width, settings.Height, triangles);
+
+    culler.Stats.OccluderTriangles = triangles.size();
+
+    std::vector<std::vector<uint32_t>> bins(bandCount);
+    for (uint32_t i = 0; i < uint32_t(triangles.size()); i++)
+    {
+        const ScreenTriangle& t = triangles[i];
+        if (t.MinX > t.MaxX || t.MinY > t.MaxY)
+            continue;
+
+        for (int band = t.MinY / BandHeight; band <= t.MaxY / BandHeight; band++)
+            bins[band].push_back(i);
+    }
+
+    culler.Pyramid.resize(1);
+    std::vector<float>& depth = culler.Pyramid[0];
+    depth.assign(size_t(settings.Width) * settings.Height, 0.0f);
+
+    // bands do not share rows, so they can be drawn at the same time
+    runParallel(bandCount, [&](int band, int)
+        {
+            int start = band * BandHeight;
+            int end = std::min(settings.Height, start + BandHeight);
+            RasterizeBand(triangles, bins[band], start, end, settings.Width, depth.data());
+        });
+
+    BuildPyramid(culler);
+}
+
+bool IsBoxVisible(const OcclusionCuller& culler, const BoundingBox& worldBounds)
+{
+    return TestBox(culler, worldBounds, culler.ViewProjection) == BoxResult::Visible;
+}
+
+void CullSceneMeshes(OcclusionCuller& culler, const Scene& scene, std::vector<MeshSceneObject*>& visible)
+{
+    visible.clear();
+
+    culler.Stats.Tested = 0;
+    culler.Stats.FrustumCulled = 0;
+    culler.Stats.OcclusionCulled = 0;
+
+    for (MeshSceneObject* node : scene.Meshes)
+    {
+        // the local bounds go through the full transform, which is tighter than the world axis aligned box
+        switch (TestBox(culler, node->Bounds, MatrixMultiply(node->WorldMatrix, culler.ViewProjection)))
+        {
+        case BoxResult::OutsideFrustum:
+            culler.Stats.FrustumCulled++;
+            break;
+
+        case BoxResult::Occluded:
+            culler.Stats.Tested++;
+            culler.Stats.OcclusionCulled++;
+            break;
+
+        default:
+            culler.Stats.Tested++;
+            visible.push_back(node);
+            break;
+        }
+    }
+}
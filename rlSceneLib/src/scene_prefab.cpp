@@ -0,0 +1,226 @@
+#include "scene_prefab.h"
+#include "scene_loader.h"
+#include "mesh_utils.h"
+
+#include <cstring>
+#include <string>
+
+namespace
+{
+    // the instances of a prefab share the maps of this copy, so the source node can be destroyed
+    Material CloneMaterial(const Material& source)
+    {
+        Material material = LoadMaterialDefault();
+        material.shader = source.shader;
+        memcpy(material.maps, source.maps, sizeof(MaterialMap) * MAX_MATERIAL_MAPS);
+        memcpy(material.params, source.params, sizeof(material.params));
+        return material;
+    }
+
+    void AddPrefabNode(Scene& scene, const SceneObject& object, int parent, Prefab& prefab)
+    {
+        PrefabNode node;
+        node.Type = object.GetType();
+        node.Parent = parent;
+        node.ChildCount = int(object.Children.size());
+        node.Name = object.Name;
+        node.Transform = object.Transform;
+
+        if (parent >= 0)
+        {
+            const SceneObject& parentObject = *object.Parent;
+            node.LocalMatrix = MatrixMultiply(object.WorldMatrix, MatrixInvert(parentObject.WorldMatrix));
+            node.Path = scene.Strings.Intern(JoinScenePath(prefab.Nodes[parent].Path, object.Name));
+        }
+        else
+        {
+            node.Path = object.Name;
+        }
+
+        switch (object.GetType())
+        {
+        case SceneObjectType::MeshObject:
+        {
+            const MeshSceneObject& mesh = static_cast<const MeshSceneObject&>(object);
+            node.Bounds = mesh.Bounds;
+            node.Sphere = mesh.Sphere;
+            node.FirstMesh = scene.PrefabMeshes.size();
+            node.MeshCount = mesh.Meshes.size();
+
+            for (auto& instance : mesh.Meshes)
+            {
+                MeshSceneObject::MeshInstanceData prefabMesh = instance;
+                prefabMesh.MaterialData = CloneMaterial(instance.MaterialData);
+                prefabMesh.SharedMaterial = false;
+                scene.PrefabMeshes.push_back(prefabMesh);
+            }
+            break;
+        }
+
+        case SceneObjectType::LightObject:
+        {
+            const LightSceneObject& light = static_cast<const LightSceneObject&>(object);
+            node.EmissiveColor = light.EmissiveColor;
+            node.Intensity = light.Intensity;
+            node.Range = light.Range;
+            node.MinCone = light.MinCone;
+            node.MaxCone = light.MaxCone;
+            node.LightType = light.LightType;
+            break;
+        }
+
+        case SceneObjectType::CameraObject:
+            node.FOV = static_cast<const CameraSceneObject&>(object).FOV;
+            break;
+
+        default:
+            break;
+        }
+
+        int index = int(prefab.Nodes.size());
+        prefab.Nodes.push_back(node);
+
+        for (auto& child : object.Children)
+            AddPrefabNode(scene, *child, index, prefab);
+    }
+
+    std::unique_ptr<SceneObject> CreateInstanceNode(Scene& scene, const PrefabNode& node)
+    {
+        switch (node.Type)
+        {
+        case SceneObjectType::MeshObject:
+        {
+            auto mesh = std::make_unique<MeshSceneObject>();
+            mesh->Bounds = node.Bounds;
+            mesh->Sphere = node.Sphere;
+            mesh->Meshes.assign(scene.PrefabMeshes.begin() + node.FirstMesh, scene.PrefabMeshes.begin() + node.FirstMesh + node.MeshCount);
+
+            for (auto& instance : mesh->Meshes)
+                instance.SharedMaterial = true;
+
+            scene.Meshes.push_back(mesh.get());
+            return mesh;
+        }
+
+        case SceneObjectType::LightObject:
+        {
+            auto light = std::make_unique<LightSceneObject>();
+            light->EmissiveColor = node.EmissiveColor;
+            light->Intensity = node.Intensity;
+            light->Range = node.Range;
+            light->MinCone = node.MinCone;
+            light->MaxCone = node.MaxCone;
+            light->LightType = node.LightType;
+
+            scene.Lights.push_back(light.get());
+            return light;
+        }
+
+        case SceneObjectType::CameraObject:
+        {
+            auto camera = std::make_unique<CameraSceneObject>();
+            camera->FOV = node.FOV;
+
+            scene.Cameras.push_back(camera.get());
+            return camera;
+        }
+
+        default:
+            return std::make_unique<SceneObject>();
+        }
+    }
+}
+
+void CreatePrefab(Scene& scene, const SceneObject& root, Prefab& outPrefab)
+{
+    outPrefab.Owner = &scene;
+    outPrefab.Nodes.clear();
+
+    AddPrefabNode(scene, root, -1, outPrefab);
+}
+
+bool LoadPrefabFromGLTF(std::string_view filename, Scene& scene, Prefab& outPrefab)
+{
+    size_t firstRoot = scene.RootObjects.size();
+
+    if (!LoadSceneFromGLTF(filename, scene) || scene.RootObjects.size() == firstRoot)
+    {
+        TraceLog(LOG_WARNING, "PREFAB: unable to load %s", std::string(filename).c_str());
+        return false;
+    }
+
+    // several roots are gathered under one generic node so the prefab has a single root
+    if (scene.RootObjects.size() - firstRoot > 1)
+    {
+        auto root = std::make_unique<SceneObject>();
+        root->Name = scene.Strings.Intern(GetFileNameWithoutExt(std::string(filename).c_str()));
+        root->WorldMatrix = MatrixIdentity();
+
+        for (size_t i = firstRoot; i < scene.RootObjects.size(); i++)
+        {
+            scene.RootObjects[i]->Parent = root.get();
+            root->Children.push_back(std::move(scene.RootObjects[i]));
+        }
+
+        scene.RootObjects.resize(firstRoot);
+        scene.RootObjects.push_back(std::move(root));
+    }
+
+    SceneObject* root = scene.RootObjects.back().get();
+    CreatePrefab(scene, *root, outPrefab);
+
+    // the loaded nodes were only needed to build the prefab
+    DestroySceneObject(scene, root);
+    BuildSceneNameIndex(scene);
+
+    return true;
+}
+
+SceneObject* Instantiate(const Prefab& prefab, SceneObject* parent, const PQSTransform& transform)
+{
+    if (!prefab.Owner || prefab.Nodes.empty())
+        return nullptr;
+
+    Scene& scene = *prefab.Owner;
+
+    // nodes are created in table order, so a parent always exists before its children
+    static thread_local std::vector<SceneObject*> created;
+    created.resize(prefab.Nodes.size());
+
+    std::string parentPath = parent ? GetSceneObjectPath(*parent) : std::string();
+
+    for (size_t i = 0; i < prefab.Nodes.size(); i++)
+    {
+        const PrefabNode& node = prefab.Nodes[i];
+
+        std::unique_ptr<SceneObject> object = CreateInstanceNode(scene, node);
+        object->Name = node.Name;
+        object->Parent = node.Parent >= 0 ? created[node.Parent] : parent;
+        object->Children.reserve(node.ChildCount);
+
+        Matrix localMatrix = node.LocalMatrix;
+        if (node.Parent < 0)
+        {
+            object->Transform = transform;
+            PQSTransformToMatrix(transform, localMatrix);
+        }
+        else
+        {
+            object->Transform = node.Transform;
+        }
+
+        object->WorldMatrix = object->Parent ? MatrixMultiply(localMatrix, object->Parent->WorldMatrix) : localMatrix;
+
+        scene.NameIndex.emplace(object->Name, object.get());
+        scene.PathIndex.emplace(parentPath.empty() ? node.Path : scene.Paths.Intern(JoinScenePath(parentPath, node.Path)), object.get());
+
+        created[i] = object.get();
+
+        if (SceneObject* objectParent = object->Parent)
+            objectParent->Children.push_back(std::move(object));
+        else
+            scene.RootObjects.push_back(std::move(object));
+    }
+
+    return created[0];
+}
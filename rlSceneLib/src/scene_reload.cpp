@@ -0,0 +1,390 @@
+#include "scene_reload.h"
+#include "scene_loader.h"
+
+#include <chrono>
+#include <cstring>
+#include <unordered_set>
+#include <vector>
+
+namespace
+{
+    struct ReloadContext
+    {
+        Scene& Live;
+
+        std::unordered_map<std::string, std::vector<SceneObject*>> LiveNodes;      // by path, in tree order
+        std::unordered_set<SceneObject*> Matched;
+        std::unordered_set<SceneObject*> Adopted;                                   // fresh mesh nodes that moved into the live scene
+
+        ReloadStats Stats;
+    };
+
+    void CollectLiveNodes(SceneObject* object, const std::string& parentPath, ReloadContext& context)
+    {
+        std::string path = JoinScenePath(parentPath, object->Name);
+        context.LiveNodes[path].push_back(object);
+
+        for (auto& child : object->Children)
+            CollectLiveNodes(child.get(), path, context);
+    }
+
+    bool SameColor(const Color& a, const Color& b)
+    {
+        return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+    }
+
+    bool SameInstances(const MeshSceneObject& live, const MeshSceneObject& fresh)
+    {
+        if (live.Meshes.size() != fresh.Meshes.size())
+            return false;
+
+        for (size_t i = 0; i < live.Meshes.size(); i++)
+        {
+            const auto& a = live.Meshes[i];
+            const auto& b = fresh.Meshes[i];
+
+            if (a.MeshHash != b.MeshHash || a.TextureHash != b.TextureHash)
+                return false;
+
+            if (!SameColor(a.MaterialData.maps[MATERIAL_MAP_ALBEDO].color, b.MaterialData.maps[MATERIAL_MAP_ALBEDO].color))
+                return false;
+        }
+
+        return true;
+    }
+
+    bool UpdateMeshNode(MeshSceneObject& live, MeshSceneObject& fresh)
+    {
+        if (SameInstances(live, fresh))
+            return false;
+
+        for (size_t i = 0; i < fresh.Meshes.size(); i++)
+        {
+            auto& instance = fresh.Meshes[i];
+
+            // keep shaders the application assigned
+            if (i < live.Meshes.size() && instance.MaterialData.shader.id == 0)
+                instance.MaterialData.shader = live.Meshes[i].MaterialData.shader;
+        }
+
+        // the old instances end up in the fresh node and are freed with it
+        // reused meshes got their bounds from the seeded MeshBoundsCache, so the fresh bounds are complete
+        std::swap(live.Meshes, fresh.Meshes);
+        live.Bounds = fresh.Bounds;
+        live.Sphere = fresh.Sphere;
+        live.BoundsDirty = true;
+        return true;
+    }
+
+    bool UpdateLightNode(LightSceneObject& live, const LightSceneObject& fresh)
+    {
+        if (SameColor(live.EmissiveColor, fresh.EmissiveColor) && live.Intensity == fresh.Intensity && live.Range == fresh.Range
+            && live.MinCone == fresh.MinCone && live.MaxCone == fresh.MaxCone && live.LightType == fresh.LightType)
+            return false;
+
+        live.EmissiveColor = fresh.EmissiveColor;
+        live.Intensity = fresh.Intensity;
+        live.Range = fresh.Range;
+        live.MinCone = fresh.MinCone;
+        live.MaxCone = fresh.MaxCone;
+        live.LightType = fresh.LightType;
+        return true;
+    }
+
+    bool UpdateNode(SceneObject& live, SceneObject& fresh)
+    {
+        bool changed = false;
+
+        if (memcmp(&live.WorldMatrix, &fresh.WorldMatrix, sizeof(Matrix)) != 0 || memcmp(&live.Transform, &fresh.Transform, sizeof(PQSTransform)) != 0)
+        {
+            live.Transform = fresh.Transform;
+            live.WorldMatrix = fresh.WorldMatrix;
+            live.BoundsDirty = true;
+            changed = true;
+        }
+
+        switch (live.GetType())
+        {
+        case SceneObjectType::MeshObject:
+            changed |= UpdateMeshNode(static_cast<MeshSceneObject&>(live), static_cast<MeshSceneObject&>(fresh));
+            break;
+
+        case SceneObjectType::LightObject:
+            changed |= UpdateLightNode(static_cast<LightSceneObject&>(live), static_cast<const LightSceneObject&>(fresh));
+            break;
+
+        case SceneObjectType::CameraObject:
+        {
+            auto& camera = static_cast<CameraSceneObject&>(live);
+            float fov = static_cast<const CameraSceneObject&>(fresh).FOV;
+            if (camera.FOV != fov)
+            {
+                camera.FOV = fov;
+                changed = true;
+            }
+            break;
+        }
+
+        default:
+            break;
+        }
+
+        return changed;
+    }
+
+    // moves a subtree that only exists in the file into the live scene, names are interned again since the fresh pool goes away
+    void AdoptNode(SceneObject* object, ReloadContext& context)
+    {
+        object->Name = context.Live.Strings.Intern(object->Name);
+
+        switch (object->GetType())
+        {
+        case SceneObjectType::MeshObject:
+            context.Live.Meshes.push_back(static_cast<MeshSceneObject*>(object));
+            context.Adopted.insert(object);
+            break;
+
+        case SceneObjectType::LightObject:
+            context.Live.Lights.push_back(static_cast<LightSceneObject*>(object));
+            break;
+
+        case SceneObjectType::CameraObject:
+            context.Live.Cameras.push_back(static_cast<CameraSceneObject*>(object));
+            break;
+
+        default:
+            break;
+        }
+
+        context.Stats.NodesAdded++;
+
+        for (auto& child : object->Children)
+            AdoptNode(child.get(), context);
+    }
+
+    SceneObject* FindMatch(ReloadContext& context, const std::string& path, const SceneObject& fresh, SceneObject* liveParent)
+    {
+        auto itr = context.LiveNodes.find(path);
+        if (itr == context.LiveNodes.end())
+            return nullptr;
+
+        // nodes that share a path are matched in tree order
+        for (SceneObject* live : itr->second)
+        {
+            if (live->Parent == liveParent && live->GetType() == fresh.GetType() && !context.Matched.contains(live))
+                return live;
+        }
+
+        return nullptr;
+    }
+
+    void ReloadNode(std::unique_ptr<SceneObject>& fresh, SceneObject* liveParent, const std::string& parentPath, ReloadContext& context)
+    {
+        std::string path = JoinScenePath(parentPath, fresh->Name);
+
+        SceneObject* live = FindMatch(context, path, *fresh, liveParent);
+        if (!live)
+        {
+            AdoptNode(fresh.get(), context);
+
+            fresh->Parent = liveParent;
+            if (liveParent)
+                liveParent->Children.push_back(std::move(fresh));
+            else
+                context.Live.RootObjects.push_back(std::move(fresh));
+            return;
+        }
+
+        context.Matched.insert(live);
+
+        if (UpdateNode(*live, *fresh))
+            context.Stats.NodesUpdated++;
+
+        for (auto& child : fresh->Children)
+            ReloadNode(child, live, path, context);
+    }
+
+    size_t CountNodes(const SceneObject& object)
+    {
+        size_t count = 1;
+        for (auto& child : object.Children)
+            count += CountNodes(*child);
+        return count;
+    }
+}
+
+bool ReloadSceneFromGLTF(std::string_view filename, Scene& scene, ReloadStats* stats)
+{
+    // seeding the caches makes the loader reuse every mesh and texture the scene already has
+    Scene fresh;
+    fresh.MeshCache = scene.MeshCache;
+    fresh.MeshBoundsCache = scene.MeshBoundsCache;
+    fresh.TextureCache = scene.TextureCache;
+    fresh.ImageCache = scene.ImageCache;
+
+    bool loaded = LoadSceneFromGLTF(filename, fresh);
+
+    ReloadContext context{ scene };
+
+    if (loaded)
+    {
+        for (auto& root : scene.RootObjects)
+            CollectLiveNodes(root.get(), std::string(), context);
+
+        for (auto& root : fresh.RootObjects)
+            ReloadNode(root, nullptr, std::string(), context);
+
+        // live nodes without a match are gone from the file, destroying the topmost one takes its children along
+        std::vector<SceneObject*> removed;
+        for (auto& [path, nodes] : context.LiveNodes)
+        {
+            for (SceneObject* node : nodes)
+            {
+                if (!context.Matched.contains(node) && (!node->Parent || context.Matched.contains(node->Parent)))
+                    removed.push_back(node);
+            }
+        }
+
+        for (SceneObject* node : removed)
+        {
+            context.Stats.NodesRemoved += CountNodes(*node);
+            DestroySceneObject(scene, node);
+        }
+
+        // cache entries the scene did not have before are the new meshes and textures
+        for (auto& [hash, mesh] : fresh.MeshCache)
+        {
+            if (scene.MeshCache.contains(hash))
+                continue;
+
+            scene.MeshCache[hash] = mesh;
+
+            auto block = fresh.MeshBlocks.find(hash);
+            if (block != fresh.MeshBlocks.end())
+                scene.MeshBlocks[hash] = block->second;
+
+            auto bounds = fresh.MeshBoundsCache.find(hash);
+            if (bounds != fresh.MeshBoundsCache.end())
+                scene.MeshBoundsCache[hash] = bounds->second;
+
+            context.Stats.MeshesAdded++;
+        }
+
+        for (auto& [hash, texture] : fresh.TextureCache)
+        {
+            if (!scene.TextureCache.contains(hash))
+            {
+                scene.TextureCache[hash] = texture;
+                context.Stats.TexturesAdded++;
+            }
+        }
+
+        for (auto& [hash, image] : fresh.ImageCache)
+        {
+            if (!scene.ImageCache.contains(hash))
+            {
+                scene.ImageCache[hash] = image;
+                context.Stats.TexturesAdded++;
+            }
+        }
+
+        size_t meshCount = scene.MeshCache.size();
+        size_t textureCount = scene.TextureCache.size() + scene.ImageCache.size();
+
+        UnloadUnusedSceneData(scene);
+
+        context.Stats.MeshesRemoved = meshCount - scene.MeshCache.size();
+        context.Stats.TexturesRemoved = textureCount - scene.TextureCache.size() - scene.ImageCache.size();
+
+        BuildSceneNameIndex(scene);
+        UpdateSceneWorldBounds(scene);
+    }
+    else
+    {
+        TraceLog(LOG_WARNING, "RELOAD: unable to load %s, the scene is unchanged", std::string(filename).c_str());
+
+        // whatever the failed load added to the caches is not used by the live scene
+        Scene unused;
+        for (auto& [hash, mesh] : fresh.MeshCache)
+        {
+            if (!scene.MeshCache.contains(hash))
+                unused.MeshCache[hash] = mesh;
+        }
+
+        for (auto& [hash, block] : fresh.MeshBlocks)
+            unused.MeshBlocks[hash] = block;
+
+        for (auto& [hash, texture] : fresh.TextureCache)
+        {
+            if (!scene.TextureCache.contains(hash))
+                unused.TextureCache[hash] = texture;
+        }
+
+        for (auto& [hash, image] : fresh.ImageCache)
+        {
+            if (!scene.ImageCache.contains(hash))
+                unused.ImageCache[hash] = image;
+        }
+
+        UnloadScene(unused);
+    }
+
+    // the material maps of fresh nodes that were not adopted, including the instances swapped out of the live scene
+    for (auto* meshNode : fresh.Meshes)
+    {
+        if (context.Adopted.contains(meshNode))
+            continue;
+
+        for (auto& instance : meshNode->Meshes)
+        {
+            if (!instance.SharedMaterial)
+                MemFree(instance.MaterialData.maps);
+        }
+    }
+
+    if (stats)
+        *stats = context.Stats;
+
+    return loaded;
+}
+
+void SceneFileWatcher::Watch(std::string_view filename, Scene& scene, double pollInterval)
+{
+    FileName = filename;
+    WatchedScene = &scene;
+    PollInterval = pollInterval;
+    NextPoll = 0;
+    LoadedModTime = GetFileModTime(FileName.c_str());
+    PendingModTime = LoadedModTime;
+}
+
+void SceneFileWatcher::Stop()
+{
+    FileName.clear();
+    WatchedScene = nullptr;
+}
+
+bool SceneFileWatcher::Update(ReloadStats* stats)
+{
+    if (!WatchedScene)
+        return false;
+
+    double now = std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    if (now < NextPoll)
+        return false;
+
+    NextPoll = now + PollInterval;
+
+    long modTime = GetFileModTime(FileName.c_str());
+    if (modTime == 0 || modTime == LoadedModTime)
+        return false;
+
+    if (modTime != PendingModTime)
+    {
+        PendingModTime = modTime;
+        return false;
+    }
+
+    LoadedModTime = modTime;
+    return ReloadSceneFromGLTF(FileName, *WatchedScene, stats);
+}
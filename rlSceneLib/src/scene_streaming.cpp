@@ -0,0 +1,511 @@
+#include "scene_streaming.h"
+#include "scene_loader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <unordered_set>
+
+static size_t GetMeshDataBytes(const Mesh& mesh)
+{
+    size_t vertexSize = 3 * sizeof(float);
+    if (mesh.normals)
+        vertexSize += 3 * sizeof(float);
+    if (mesh.texcoords)
+        vertexSize += 2 * sizeof(float);
+    if (mesh.texcoords2)
+        vertexSize += 2 * sizeof(float);
+
+    size_t bytes = size_t(mesh.vertexCount) * vertexSize;
+    if (mesh.indices)
+        bytes += size_t(mesh.triangleCount) * 3 * sizeof(unsigned short);
+
+    return bytes;
+}
+
+// resident meshes have no CPU data left, so the data is only compared while both still have it
+static bool IsSameMesh(const Mesh& a, const Mesh& b)
+{
+    if (a.vertexCount != b.vertexCount || a.triangleCount != b.triangleCount)
+        return false;
+
+    if (a.vertices && b.vertices && memcmp(a.vertices, b.vertices, size_t(a.vertexCount) * 3 * sizeof(float)) != 0)
+        return false;
+
+    if (a.indices && b.indices && memcmp(a.indices, b.indices, size_t(a.triangleCount) * 3 * sizeof(unsigned short)) != 0)
+        return false;
+
+    return true;
+}
+
+static BoundingBox GetNodeWorldBounds(const SceneObject& node)
+{
+    Vector3 origin = Vector3Transform(Vector3Zeros, node.WorldMatrix);
+    BoundingBox bounds = { origin, origin };
+
+    if (node.GetType() != SceneObjectType::MeshObject)
+        return bounds;
+
+    const MeshSceneObject& mesh = static_cast<const MeshSceneObject&>(node);
+    return mesh.BoundsDirty ? TransformBoundingBox(mesh.Bounds, mesh.WorldMatrix) : mesh.WorldBounds;
+}
+
+namespace
+{
+    // a cell scene only borrows meshes, materials and images from the source scene, so it is never unloaded
+    struct CellBuild
+    {
+        Scene CellScene;
+        BoundingBox Bounds = { 0 };
+        bool HasBounds = false;
+        size_t Bytes = 0;
+        std::unordered_set<size_t> CountedMeshes;
+        std::unordered_set<size_t> CountedTextures;
+    };
+
+    void AddTextureToCell(const Scene& scene, CellBuild& cell, size_t hash)
+    {
+        if (hash == 0 || !cell.CountedTextures.insert(hash).second)
+            return;
+
+        auto image = scene.ImageCache.find(hash);
+        if (image != scene.ImageCache.end())
+        {
+            cell.CellScene.ImageCache[hash] = image->second;
+            cell.Bytes += size_t(GetPixelDataSize(image->second.width, image->second.height, image->second.format));
+            return;
+        }
+
+        auto texture = scene.TextureCache.find(hash);
+        if (texture != scene.TextureCache.end())
+        {
+            cell.CellScene.TextureCache[hash] = texture->second;
+            cell.Bytes += size_t(GetPixelDataSize(texture->second.width, texture->second.height, texture->second.format));
+        }
+    }
+
+    void PartitionNode(const Scene& scene, const SceneObject& node, float cellSize, std::map<std::pair<int, int>, CellBuild>& cells)
+    {
+        // unnamed groups only carry transforms, which get baked into their children
+        bool keep = node.GetType() != SceneObjectType::GenericObject || !node.Name.empty();
+
+        if (keep)
+        {
+            BoundingBox bounds = GetNodeWorldBounds(node);
+            Vector3 center = Vector3Lerp(bounds.min, bounds.max, 0.5f);
+
+            CellBuild& cell = cells[std::make_pair(int(floorf(center.x / cellSize)), int(floorf(center.z / cellSize)))];
+            Scene& cellScene = cell.CellScene;
+
+            cell.Bounds.min = cell.HasBounds ? Vector3Min(cell.Bounds.min, bounds.min) : bounds.min;
+            cell.Bounds.max = cell.HasBounds ? Vector3Max(cell.Bounds.max, bounds.max) : bounds.max;
+            cell.HasBounds = true;
+
+            std::unique_ptr<SceneObject> clone;
+            switch (node.GetType())
+            {
+            case SceneObjectType::MeshObject:
+            {
+                const MeshSceneObject& source = static_cast<const MeshSceneObject&>(node);
+
+                auto mesh = std::make_unique<MeshSceneObject>();
+                mesh->Bounds = source.Bounds;
+                mesh->Sphere = source.Sphere;
+                mesh->Meshes = source.Meshes;
+
+                for (auto& instance : source.Meshes)
+                {
+                    if (instance.MeshData && cell.CountedMeshes.insert(instance.MeshHash).second)
+                        cell.Bytes += GetMeshDataBytes(*instance.MeshData);
+
+                    AddTextureToCell(scene, cell, instance.TextureHash);
+                }
+
+                cellScene.Meshes.push_back(mesh.get());
+                clone = std::move(mesh);
+                break;
+            }
+
+            case SceneObjectType::LightObject:
+            {
+                const LightSceneObject& source = static_cast<const LightSceneObject&>(node);
+
+                auto light = std::make_unique<LightSceneObject>();
+                light->EmissiveColor = source.EmissiveColor;
+                light->Intensity = source.Intensity;
+                light->Range = source.Range;
+                light->MinCone = source.MinCone;
+                light->MaxCone = source.MaxCone;
+                light->LightType = source.LightType;
+
+                cellScene.Lights.push_back(light.get());
+                clone = std::move(light);
+                break;
+            }
+
+            case SceneObjectType::CameraObject:
+            {
+                auto camera = std::make_unique<CameraSceneObject>();
+                camera->FOV = static_cast<const CameraSceneObject&>(node).FOV;
+
+                cellScene.Cameras.push_back(camera.get());
+                clone = std::move(camera);
+                break;
+            }
+
+            default:
+                clone = std::make_unique<SceneObject>();
+                break;
+            }
+
+            clone->Name = cellScene.Strings.Intern(node.Name);
+            clone->WorldMatrix = node.WorldMatrix;
+            MatrixDecompose(node.WorldMatrix, &clone->Transform.position, &clone->Transform.rotation, &clone->Transform.scale);
+
+            cellScene.RootObjects.push_back(std::move(clone));
+        }
+
+        for (auto& child : node.Children)
+            PartitionNode(scene, *child, cellSize, cells);
+    }
+
+    float GetCellDistance(const BoundingBox& bounds, Vector3 focus)
+    {
+        float dx = std::max(0.0f, std::max(bounds.min.x - focus.x, focus.x - bounds.max.x));
+        float dz = std::max(0.0f, std::max(bounds.min.z - focus.z, focus.z - bounds.max.z));
+        return sqrtf(dx * dx + dz * dz);
+    }
+}
+
+bool PartitionSceneToCells(const Scene& scene, std::string_view folder, float cellSize, const SceneExportSettings& exportSettings)
+{
+    if (cellSize <= 0)
+        return false;
+
+    std::map<std::pair<int, int>, CellBuild> cells;
+    for (auto& root : scene.RootObjects)
+        PartitionNode(scene, *root, cellSize, cells);
+
+    std::string folderName(folder);
+    MakeDirectory(folderName.c_str());
+
+    std::string manifest = "cell_size " + std::to_string(cellSize) + "\n";
+
+    for (auto& [key, cell] : cells)
+    {
+        char fileName[64];
+        snprintf(fileName, sizeof(fileName), "cell_%d_%d.glb", key.first, key.second);
+
+        if (!ExportSceneToGLB(cell.CellScene, folderName + "/" + fileName, exportSettings))
+            return false;
+
+        char line[512];
+        snprintf(line, sizeof(line), "cell %d %d %.9g %.9g %.9g %.9g %.9g %.9g %zu %s\n", key.first, key.second,
+            cell.Bounds.min.x, cell.Bounds.min.y, cell.Bounds.min.z, cell.Bounds.max.x, cell.Bounds.max.y, cell.Bounds.max.z, cell.Bytes, fileName);
+        manifest += line;
+    }
+
+    return SaveFileText((folderName + "/cells.txt").c_str(), manifest.data());
+}
+
+SceneStreamer::~SceneStreamer()
+{
+    Close();
+}
+
+bool SceneStreamer::Open(std::string_view manifestFile, const StreamingSettings& settings)
+{
+    Close();
+
+    std::string manifestName(manifestFile);
+    char* text = LoadFileText(manifestName.c_str());
+    if (!text)
+        return false;
+
+    Settings = settings;
+    Folder = GetDirectoryPath(manifestName.c_str());
+
+    char* line = text;
+    while (line && *line)
+    {
+        char* next = strchr(line, '\n');
+        if (next)
+            *next++ = '\0';
+
+        StreamingCell cell;
+        char fileName[256] = { 0 };
+        if (sscanf(line, "cell %d %d %f %f %f %f %f %f %zu %255s", &cell.X, &cell.Z,
+            &cell.Bounds.min.x, &cell.Bounds.min.y, &cell.Bounds.min.z, &cell.Bounds.max.x, &cell.Bounds.max.y, &cell.Bounds.max.z,
+            &cell.EstimatedBytes, fileName) == 10)
+        {
+            cell.FileName = Folder + "/" + fileName;
+            Cells.push_back(std::move(cell));
+        }
+
+        line = next;
+    }
+
+    UnloadFileText(text);
+
+    // cells are loaded on worker threads, which must not touch the GPU
+    // decoded images are not cached by the loader, the shared textures already stay resident within the budget
+    Loader.Options.Headless = true;
+    Loader.Options.CacheImages = false;
+
+    return !Cells.empty();
+}
+
+void SceneStreamer::Close()
+{
+    for (auto& cell : Cells)
+    {
+        if (cell.State == CellState::Loading)
+        {
+            std::unique_ptr<Scene> scene = cell.PendingLoad.get();
+            UnloadScene(*scene);
+            cell.State = CellState::Unloaded;
+        }
+        else if (cell.State == CellState::Loaded)
+        {
+            EvictCell(cell);
+        }
+    }
+
+    Cells.clear();
+    Meshes.clear();
+    Textures.clear();
+    ResidentBytes = 0;
+}
+
+void SceneStreamer::Update(Vector3 focus)
+{
+    int finished = 0;
+    for (auto& cell : Cells)
+    {
+        if (cell.State != CellState::Loading || finished >= Settings.MaxCellsPerUpdate)
+            continue;
+
+        if (cell.PendingLoad.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            continue;
+
+        cell.CellScene = cell.PendingLoad.get();
+        cell.State = CellState::Loaded;
+        FinishLoad(cell);
+        finished++;
+    }
+
+    std::vector<std::pair<float, size_t>> order;
+    order.reserve(Cells.size());
+    for (size_t i = 0; i < Cells.size(); i++)
+        order.emplace_back(GetCellDistance(Cells[i].Bounds, focus), i);
+
+    std::sort(order.begin(), order.end());
+
+    // the nearest cells inside the load radius are wanted as long as they fit in the budget
+    std::vector<bool> wanted(Cells.size(), false);
+    size_t plannedBytes = 0;
+    for (auto& [distance, index] : order)
+    {
+        if (distance > Settings.LoadRadius || plannedBytes + Cells[index].EstimatedBytes > Settings.MemoryBudget)
+            break;
+
+        plannedBytes += Cells[index].EstimatedBytes;
+        wanted[index] = true;
+    }
+
+    // evict the farthest cells first, cells inside the unload radius stay unless memory is over budget
+    for (auto itr = order.rbegin(); itr != order.rend(); ++itr)
+    {
+        StreamingCell& cell = Cells[itr->second];
+        if (cell.State != CellState::Loaded || wanted[itr->second])
+            continue;
+
+        if (itr->first > Settings.UnloadRadius || ResidentBytes > Settings.MemoryBudget)
+            EvictCell(cell);
+    }
+
+    int inFlight = 0;
+    for (auto& cell : Cells)
+    {
+        if (cell.State == CellState::Loading)
+            inFlight++;
+    }
+
+    for (auto& [distance, index] : order)
+    {
+        if (inFlight >= Settings.MaxLoadsInFlight)
+            break;
+
+        StreamingCell& cell = Cells[index];
+        if (!wanted[index] || cell.State != CellState::Unloaded)
+            continue;
+
+        std::string fileName = cell.FileName;
+        cell.PendingLoad = std::async(std::launch::async, [this, fileName]()
+            {
+                auto scene = std::make_unique<Scene>();
+                if (!Loader.Load(fileName, *scene))
+                    TraceLog(LOG_WARNING, "STREAMING: unable to load cell %s", fileName.c_str());
+                return scene;
+            });
+
+        cell.State = CellState::Loading;
+        inFlight++;
+    }
+}
+
+std::vector<const Scene*> SceneStreamer::GetLoadedScenes() const
+{
+    std::vector<const Scene*> scenes;
+    for (auto& cell : Cells)
+    {
+        if (cell.State == CellState::Loaded)
+            scenes.push_back(cell.CellScene.get());
+    }
+
+    return scenes;
+}
+
+void SceneStreamer::FinishLoad(StreamingCell& cell)
+{
+    Scene& scene = *cell.CellScene;
+
+    // data that is already resident through another cell is collected here and freed
+    Scene duplicates;
+
+    // newly uploaded meshes, their CPU data is dropped once they are on the GPU
+    Scene uploaded;
+
+    for (auto& [hash, image] : scene.ImageCache)
+    {
+        SharedTexture& shared = Textures[hash];
+        if (shared.RefCount == 0)
+        {
+            shared.TextureData = LoadTextureFromImage(image);
+            shared.Bytes = size_t(GetPixelDataSize(image.width, image.height, image.format));
+            ResidentBytes += shared.Bytes;
+        }
+        shared.RefCount++;
+
+        cell.TextureHashes.push_back(hash);
+        scene.TextureCache[hash] = shared.TextureData;
+    }
+    duplicates.ImageCache = std::move(scene.ImageCache);
+    scene.ImageCache.clear();
+
+    // a resident mesh of another cell with the same hash but different geometry moves this one to the next free hash
+    std::unordered_map<size_t, size_t> movedHashes;
+
+    for (auto& [cellHash, mesh] : scene.MeshCache)
+    {
+        auto block = scene.MeshBlocks.find(cellHash);
+
+        size_t hash = cellHash;
+        for (auto itr = Meshes.find(hash); itr != Meshes.end() && itr->second.RefCount > 0 && !IsSameMesh(*itr->second.MeshData, *mesh); itr = Meshes.find(hash))
+            hash = hash * 0x9E3779B97F4A7C15ull + 1;
+
+        if (hash != cellHash)
+            movedHashes[cellHash] = hash;
+
+        SharedMesh& shared = Meshes[hash];
+        if (shared.RefCount == 0)
+        {
+            shared.MeshData = mesh;
+            shared.Bytes = GetMeshDataBytes(*mesh);
+            ResidentBytes += shared.Bytes;
+
+            if (mesh->vertexCount > 0)
+                UploadMesh(mesh.get(), false);
+
+            uploaded.MeshCache[hash] = mesh;
+            if (block != scene.MeshBlocks.end())
+                uploaded.MeshBlocks[hash] = block->second;
+        }
+        else
+        {
+            duplicates.MeshCache[hash] = mesh;
+            if (block != scene.MeshBlocks.end())
+                duplicates.MeshBlocks[hash] = block->second;
+        }
+        shared.RefCount++;
+
+        cell.MeshHashes.push_back(hash);
+    }
+
+    for (auto* meshNode : scene.Meshes)
+    {
+        for (auto& instance : meshNode->Meshes)
+        {
+            auto moved = movedHashes.find(instance.MeshHash);
+            if (moved != movedHashes.end())
+                instance.MeshHash = moved->second;
+
+            auto shared = Meshes.find(instance.MeshHash);
+            if (shared != Meshes.end())
+                instance.MeshData = shared->second.MeshData;
+        }
+    }
+
+    scene.MeshCache.clear();
+    scene.MeshBlocks.clear();
+
+    UnloadSceneMeshData(uploaded);
+    for (auto& [hash, block] : uploaded.MeshBlocks)
+        Meshes[hash].Block = block;
+
+    // only the materials are left to fix up, meshes and textures are owned by the streamer now
+    UploadScene(scene);
+
+    UnloadScene(duplicates);
+}
+
+void SceneStreamer::EvictCell(StreamingCell& cell)
+{
+    for (size_t hash : cell.MeshHashes)
+        ReleaseMesh(hash);
+
+    for (size_t hash : cell.TextureHashes)
+        ReleaseTexture(hash);
+
+    cell.MeshHashes.clear();
+    cell.TextureHashes.clear();
+
+    if (cell.CellScene)
+    {
+        cell.CellScene->TextureCache.clear();
+        UnloadScene(*cell.CellScene);
+        cell.CellScene.reset();
+    }
+
+    cell.State = CellState::Unloaded;
+}
+
+void SceneStreamer::ReleaseMesh(size_t hash)
+{
+    auto itr = Meshes.find(hash);
+    if (itr == Meshes.end() || --itr->second.RefCount > 0)
+        return;
+
+    Scene released;
+    released.MeshCache[hash] = itr->second.MeshData;
+    if (itr->second.Block.Data)
+        released.MeshBlocks[hash] = itr->second.Block;
+    UnloadScene(released);
+
+    ResidentBytes -= itr->second.Bytes;
+    Meshes.erase(itr);
+}
+
+void SceneStreamer::ReleaseTexture(size_t hash)
+{
+    auto itr = Textures.find(hash);
+    if (itr == Textures.end() || --itr->second.RefCount > 0)
+        return;
+
+    UnloadTexture(itr->second.TextureData);
+
+    ResidentBytes -= itr->second.Bytes;
+    Textures.erase(itr);
+}
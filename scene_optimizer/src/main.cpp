@@ -0,0 +1,323 @@
+#include "raylib.h"
+#include "external/cgltf.h"
+
+#include "scene_loader.h"
+
+#include "scene_pipeline.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Offline scene optimizer
+// loads glTF files with rlSceneLib, optimizes them and writes pre-optimized .glb files
+// inputs whose content and settings did not change since the last run are skipped using a manifest in the output folder
+//
+// usage: scene_optimizer [options] <file or folder>... --out <folder>
+//   --jobs N           number of worker threads, defaults to the number of cores
+//   --force            rebuild everything
+//   --no-mesh-opt      keep the index and vertex order
+//   --no-merge         keep every node
+//   --strip-names      also merge named group nodes, by default they are kept for FindSceneObject lookups
+//   --no-quantize      write normals and texcoords as floats
+//   --no-textures      do not embed textures
+//   --atlas            pack textures up to 256 pixels into shared atlases
+//   --tangents         generate tangents for every mesh without them, not only normal mapped ones
+//   --cells SIZE       split every scene into streaming cells of SIZE units, written into a folder per scene
+
+namespace fs = std::filesystem;
+
+static constexpr char ManifestName[] = "scene_manifest.txt";
+
+enum class JobResult
+{
+    Pending,
+    Optimized,
+    UpToDate,
+    Failed
+};
+
+struct OptimizeJob
+{
+    std::string Input;
+    std::string Output;
+    std::string ManifestKey;                        // output path relative to the output folder
+    uint64_t Hash = 0;
+    JobResult Result = JobResult::Pending;
+};
+
+static uint64_t HashBytes(uint64_t hash, const unsigned char* data, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= data[i];
+        hash *= 1099511628211ULL; // FNV_prime
+    }
+    return hash;
+}
+
+static bool HashFile(uint64_t& hash, const std::string& fileName)
+{
+    int size = 0;
+    unsigned char* data = LoadFileData(fileName.c_str(), &size);
+    if (!data)
+        return false;
+
+    hash = HashBytes(hash, data, size_t(size));
+    UnloadFileData(data);
+    return true;
+}
+
+// hash of the file, the external buffers and images it references, and the settings
+static uint64_t GetInputHash(const std::string& inputFile, uint64_t settingsHash)
+{
+    uint64_t hash = 14695981039346656037ULL; // FNV_offset_basis
+    hash = HashBytes(hash, (const unsigned char*)&settingsHash, sizeof(settingsHash));
+
+    if (!HashFile(hash, inputFile))
+        return 0;
+
+    if (fs::path(inputFile).extension() != ".gltf")
+        return hash;
+
+    cgltf_options options = {};
+    cgltf_data* data = nullptr;
+    if (cgltf_parse_file(&options, inputFile.c_str(), &data) != cgltf_result_success)
+        return hash;
+
+    fs::path folder = fs::path(inputFile).parent_path();
+
+    auto hashReference = [&](const char* uri)
+        {
+            if (uri && strncmp(uri, "data:", 5) != 0)
+                HashFile(hash, (folder / uri).string());
+        };
+
+    for (size_t i = 0; i < data->buffers_count; i++)
+        hashReference(data->buffers[i].uri);
+
+    for (size_t i = 0; i < data->images_count; i++)
+        hashReference(data->images[i].uri);
+
+    cgltf_free(data);
+
+    return hash;
+}
+
+static std::unordered_map<std::string, uint64_t> ReadManifest(const fs::path& fileName)
+{
+    std::unordered_map<std::string, uint64_t> manifest;
+
+    char* text = LoadFileText(fileName.string().c_str());
+    if (!text)
+        return manifest;
+
+    char* line = text;
+    while (line && *line)
+    {
+        char* next = strchr(line, '\n');
+        if (next)
+            *next++ = '\0';
+
+        // <hash> <output path>
+        char* path = strchr(line, ' ');
+        if (path)
+        {
+            *path++ = '\0';
+            size_t length = strlen(path);
+            if (length > 0 && path[length - 1] == '\r')
+                path[length - 1] = '\0';
+
+            manifest[path] = strtoull(line, nullptr, 16);
+        }
+
+        line = next;
+    }
+
+    UnloadFileText(text);
+    return manifest;
+}
+
+static void WriteManifest(const fs::path& fileName, const std::unordered_map<std::string, uint64_t>& manifest)
+{
+    std::vector<std::string> keys;
+    for (auto& [key, hash] : manifest)
+        keys.push_back(key);
+    std::sort(keys.begin(), keys.end());
+
+    std::string text;
+    for (auto& key : keys)
+    {
+        char hash[32];
+        snprintf(hash, sizeof(hash), "%016llx ", (unsigned long long)manifest.at(key));
+        text += hash + key + "\n";
+    }
+
+    SaveFileText(fileName.string().c_str(), text.data());
+}
+
+static bool IsSceneFile(const fs::path& path)
+{
+    return path.extension() == ".glb" || path.extension() == ".gltf";
+}
+
+static void AddJob(std::vector<OptimizeJob>& jobs, const fs::path& input, const fs::path& relative, const fs::path& outputFolder, bool cells)
+{
+    OptimizeJob job;
+    job.Input = input.string();
+    job.ManifestKey = fs::path(relative).replace_extension(cells ? "" : ".glb").generic_string();
+    job.Output = (outputFolder / job.ManifestKey).string();
+    jobs.push_back(job);
+}
+
+int main(int argc, char* argv[])
+{
+    PipelineSettings settings;
+    std::vector<std::string> inputs;
+    std::string outputFolder;
+    int jobCount = int(std::thread::hardware_concurrency());
+    bool force = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char* arg = argv[i];
+
+        if ((strcmp(arg, "--out") == 0 || strcmp(arg, "-o") == 0) && i + 1 < argc)
+            outputFolder = argv[++i];
+        else if (strcmp(arg, "--jobs") == 0 && i + 1 < argc)
+            jobCount = atoi(argv[++i]);
+        else if (strcmp(arg, "--force") == 0)
+            force = true;
+        else if (strcmp(arg, "--no-mesh-opt") == 0)
+            settings.OptimizeMeshes = false;
+        else if (strcmp(arg, "--no-merge") == 0)
+            settings.MergeNodes = false;
+        else if (strcmp(arg, "--strip-names") == 0)
+            settings.KeepNamedNodes = false;
+        else if (strcmp(arg, "--no-quantize") == 0)
+            settings.Export.QuantizeNormals = settings.Export.QuantizeTexcoords = false;
+        else if (strcmp(arg, "--no-textures") == 0)
+            settings.Export.EmbedTextures = false;
+        else if (strcmp(arg, "--atlas") == 0)
+            settings.AtlasTextures = true;
+        else if (strcmp(arg, "--tangents") == 0)
+            settings.GenerateTangents = true;
+        else if (strcmp(arg, "--cells") == 0 && i + 1 < argc)
+            settings.CellSize = float(atof(argv[++i]));
+        else
+            inputs.push_back(arg);
+    }
+
+    if (inputs.empty() || outputFolder.empty())
+    {
+        printf("usage: scene_optimizer [--jobs N] [--force] [--no-mesh-opt] [--no-merge] [--strip-names] [--no-quantize] [--no-textures] [--atlas] [--tangents] [--cells SIZE] <file or folder>... --out <folder>\n");
+        return 1;
+    }
+
+    jobCount = std::max(1, jobCount);
+
+    SetTraceLogLevel(LOG_WARNING);
+    SetHeadlessLoading(true);
+
+    std::vector<OptimizeJob> jobs;
+    for (const std::string& input : inputs)
+    {
+        fs::path inputPath(input);
+        if (fs::is_directory(inputPath))
+        {
+            for (const auto& entry : fs::recursive_directory_iterator(inputPath))
+            {
+                if (entry.is_regular_file() && IsSceneFile(entry.path()))
+                    AddJob(jobs, entry.path(), fs::relative(entry.path(), inputPath), outputFolder, settings.CellSize > 0);
+            }
+        }
+        else if (fs::is_regular_file(inputPath) && IsSceneFile(inputPath))
+        {
+            AddJob(jobs, inputPath, inputPath.filename(), outputFolder, settings.CellSize > 0);
+        }
+        else
+        {
+            TraceLog(LOG_WARNING, "OPTIMIZER: %s is not a glTF file or folder", input.c_str());
+        }
+    }
+
+    fs::path manifestFile = fs::path(outputFolder) / ManifestName;
+    std::unordered_map<std::string, uint64_t> manifest = ReadManifest(manifestFile);
+
+    uint64_t settingsHash = GetPipelineSettingsHash(settings);
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::atomic<size_t> nextJob = 0;
+    auto worker = [&]()
+        {
+            for (size_t index = nextJob++; index < jobs.size(); index = nextJob++)
+            {
+                OptimizeJob& job = jobs[index];
+                job.Hash = GetInputHash(job.Input, settingsHash);
+
+                auto previous = manifest.find(job.ManifestKey);
+                if (!force && job.Hash != 0 && previous != manifest.end() && previous->second == job.Hash && fs::exists(job.Output))
+                {
+                    job.Result = JobResult::UpToDate;
+                    continue;
+                }
+
+                std::error_code error;
+                fs::create_directories(fs::path(job.Output).parent_path(), error);
+
+                job.Result = OptimizeSceneFile(job.Input, job.Output, settings) ? JobResult::Optimized : JobResult::Failed;
+            }
+        };
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < std::min(jobCount, int(jobs.size())); i++)
+        threads.emplace_back(worker);
+    worker();
+
+    for (auto& thread : threads)
+        thread.join();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    int optimized = 0;
+    int upToDate = 0;
+    int failed = 0;
+
+    for (const OptimizeJob& job : jobs)
+    {
+        switch (job.Result)
+        {
+        case JobResult::Optimized:
+            printf("optimized %s -> %s\n", job.Input.c_str(), job.Output.c_str());
+            manifest[job.ManifestKey] = job.Hash;
+            optimized++;
+            break;
+
+        case JobResult::UpToDate:
+            upToDate++;
+            break;
+
+        default:
+            printf("failed    %s\n", job.Input.c_str());
+            manifest.erase(job.ManifestKey);
+            failed++;
+            break;
+        }
+    }
+
+    if (optimized > 0 || failed > 0)
+        WriteManifest(manifestFile, manifest);
+
+    printf("%d optimized, %d up to date, %d failed in %.2fs using %d threads\n", optimized, upToDate, failed, seconds, std::min(jobCount, std::max(1, int(jobs.size()))));
+
+    return failed > 0 ? 1 : 0;
+}
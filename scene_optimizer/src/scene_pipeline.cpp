@@ -0,0 +1,170 @@
+#include "scene_pipeline.h"
+
+#include "scene_loader.h"
+#include "scene_mesh_optimizer.h"
+#include "scene_streaming.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// nodes authored with a matrix can have an identity PQS, so the test is on the local matrix the world matrix came from
+static bool IsIdentityTransform(const SceneObject& node)
+{
+    constexpr float epsilon = 1e-5f;
+
+    Matrix local = node.Parent ? MatrixMultiply(node.WorldMatrix, MatrixInvert(node.Parent->WorldMatrix)) : node.WorldMatrix;
+    float16 values = MatrixToFloatV(local);
+    float16 identity = MatrixToFloatV(MatrixIdentity());
+
+    for (int i = 0; i < 16; i++)
+    {
+        if (fabsf(values.v[i] - identity.v[i]) >= epsilon)
+            return false;
+    }
+
+    return true;
+}
+
+// group nodes with nothing under them are dropped, identity groups hand their children to the parent
+// only generic nodes are touched, so the mesh, light and camera lists of the scene stay valid
+static void MergeRedundantNodes(std::vector<std::unique_ptr<SceneObject>>& nodes, SceneObject* parent, bool keepNamed)
+{
+    std::vector<std::unique_ptr<SceneObject>> merged;
+    merged.reserve(nodes.size());
+
+    for (auto& node : nodes)
+    {
+        MergeRedundantNodes(node->Children, node.get(), keepNamed);
+
+        bool redundant = node->GetType() == SceneObjectType::GenericObject && !(keepNamed && !node->Name.empty());
+        if (redundant && node->Children.empty())
+            continue;
+
+        if (redundant && IsIdentityTransform(*node))
+        {
+            for (auto& child : node->Children)
+            {
+                child->Parent = parent;
+                merged.push_back(std::move(child));
+            }
+            continue;
+        }
+
+        merged.push_back(std::move(node));
+    }
+
+    nodes = std::move(merged);
+}
+
+// glTF uris are percent encoded, "my%20texture.png" is a file with a space in its name
+static std::string DecodeUri(std::string_view uri)
+{
+    std::string path;
+    for (size_t i = 0; i < uri.size(); i++)
+    {
+        if (uri[i] == '%' && i + 2 < uri.size() && isxdigit((unsigned char)uri[i + 1]) && isxdigit((unsigned char)uri[i + 2]))
+        {
+            path += char(strtol(std::string(uri.substr(i + 1, 2)).c_str(), nullptr, 16));
+            i += 2;
+        }
+        else
+        {
+            path += uri[i];
+        }
+    }
+    return path;
+}
+
+bool OptimizeSceneFile(const std::string& inputFile, const std::string& outputFile, const PipelineSettings& settings)
+{
+    // files are optimized in parallel already, so the tangents of one file are generated on its own thread
+    SceneLoaderOptions loaderOptions;
+    loaderOptions.Headless = true;
+    loaderOptions.CacheImages = false;
+    loaderOptions.ThreadCount = 1;
+    loaderOptions.Content.Tangents = settings.GenerateTangents ? TangentGeneration::All : TangentGeneration::NormalMapped;
+
+    // images next to a .gltf file are embedded, an output that silently lost a texture is worse than no output
+    bool missingImages = false;
+    loaderOptions.TextureResolver = [&missingImages](std::string_view scenePath, std::string_view imageURL, size_t& hash)
+        {
+            std::string path = std::string(GetDirectoryPath(std::string(scenePath).c_str())) + "/" + DecodeUri(imageURL);
+
+            Image image = LoadImage(path.c_str());
+            if (image.data == nullptr)
+            {
+                TraceLog(LOG_WARNING, "OPTIMIZER: unable to load image %s", path.c_str());
+                missingImages = true;
+            }
+            return image;
+        };
+
+    SceneLoader loader(loaderOptions);
+
+    Scene scene;
+    if (!loader.Load(inputFile, scene) || missingImages)
+    {
+        TraceLog(LOG_WARNING, "OPTIMIZER: unable to load %s", inputFile.c_str());
+        UnloadScene(scene);
+        return false;
+    }
+
+    if (settings.OptimizeMeshes)
+        OptimizeSceneMeshes(scene);
+
+    // before the mesh data is written, the exporter embeds the atlases instead of the packed images
+    if (settings.AtlasTextures)
+        AtlasSceneTextures(scene, settings.Atlas);
+
+    if (settings.MergeNodes)
+    {
+        MergeRedundantNodes(scene.RootObjects, nullptr, settings.KeepNamedNodes);
+        BuildSceneNameIndex(scene);
+    }
+
+    bool result = false;
+    if (settings.CellSize > 0)
+        result = PartitionSceneToCells(scene, outputFile, settings.CellSize, settings.Export);
+    else
+        result = ExportSceneToGLB(scene, outputFile, settings.Export);
+
+    UnloadScene(scene);
+
+    return result;
+}
+
+uint64_t GetPipelineSettingsHash(const PipelineSettings& settings)
+{
+    // bump the version when the pipeline output changes so old outputs are rebuilt
+    constexpr uint64_t pipelineVersion = 3;
+
+    bool flags[] = {
+        settings.OptimizeMeshes,
+        settings.MergeNodes,
+        settings.KeepNamedNodes,
+        settings.AtlasTextures,
+        settings.GenerateTangents,
+        settings.Export.QuantizeNormals,
+        settings.Export.QuantizeTexcoords,
+        settings.Export.EmbedTextures
+    };
+
+    uint64_t hash = pipelineVersion;
+    for (bool flag : flags)
+        hash = (hash << 1) | (flag ? 1 : 0);
+
+    uint32_t cellSize = 0;
+    memcpy(&cellSize, &settings.CellSize, sizeof(cellSize));
+    hash = hash * 31 + cellSize;
+
+    if (settings.AtlasTextures)
+    {
+        int atlasSettings[] = { settings.Atlas.MaxTextureSize, settings.Atlas.AtlasSize, settings.Atlas.Padding, settings.Atlas.Mipmaps ? 1 : 0 };
+        for (int value : atlasSettings)
+            hash = hash * 31 + uint64_t(value);
+    }
+
+    return hash;
+}
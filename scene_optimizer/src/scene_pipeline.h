@@ -0,0 +1,25 @@
+#pragma once
+
+#include "scene_atlas.h"
+#include "scene_exporter.h"
+
+#include <string>
+
+struct PipelineSettings
+{
+    bool OptimizeMeshes = true;                     // vertex cache, overdraw and vertex fetch order
+    bool MergeNodes = true;                         // drop empty group nodes and fold identity groups into their parent
+    bool KeepNamedNodes = true;                     // named group nodes such as spawn points and sockets are never merged
+    bool AtlasTextures = false;                     // pack small textures into atlases and remap the texcoords
+    TextureAtlasSettings Atlas;
+    bool GenerateTangents = false;                  // bake tangents for every mesh that has none, not only normal mapped ones
+    float CellSize = 0;                             // when set the output is a folder of streaming cells instead of one .glb
+    SceneExportSettings Export;
+};
+
+// loads a glTF file, optimizes it and writes it out as a .glb, or as a folder of cells when CellSize is set
+// safe to call from several threads at once, every call loads with its own headless loader
+bool OptimizeSceneFile(const std::string& inputFile, const std::string& outputFile, const PipelineSettings& settings);
+
+// hash of every setting that changes the output, part of the manifest so changed settings force a rebuild
+uint64_t GetPipelineSettingsHash(const PipelineSettings& settings);